@@ -2,52 +2,374 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+
 #include "physics/physics.h"
-#include "event_handler/event_handler.h"
-#include "camera/camera.h"
 
-void Animation::updateBones(Scene &scene)
+// Same order as YachtBone
+const std::vector<std::string> Animation::yachtBoneNames = {"Armature_Body", "Armature_Fork", "Armature_Wheel_Front", "Armature_Wheel_Left",
+                                                            "Armature_Wheel_Right", "Armature_Mast", "Armature_Boom", "Armature_Sail", "Armature_Cam"};
+
+PoseArena Animation::poses;
+SailCloth Animation::sails;
+std::vector<PoseState> Animation::poseStates;
+std::array<int, 3> Animation::poseIntervals = {1, 2, 4};
+std::vector<int> Animation::posing;
+std::vector<int> Animation::copying;
+std::vector<int> Animation::clipModels;
+std::vector<float> Animation::clipTimes, Animation::clipWeights, Animation::clipRotations, Animation::clipTranslations;
+
+void Animation::setup(Scene &scene)
+{
+    // Same slices as scene, in same order
+    poses.clear();
+    for (ModelData &ModelData : scene.structModels)
+    {
+        if (ModelData.poseStart >= 0)
+        {
+            poses.add(ModelData.model->skeleton);
+        }
+    }
+
+    // Same cloth instances as scene, at rest
+    sails.clear();
+    for (ModelData &ModelData : scene.structModels)
+    {
+        if (ModelData.clothInstance >= 0)
+        {
+            sails.add(ModelData.model->sail);
+        }
+    }
+
+    // Every yacht posed on first step
+    poseStates.assign(scene.structModels.size(), PoseState());
+}
+
+void Animation::copyState(const Scene &scene, const FrameState &from, FrameState &to)
 {
+    if (to.poses.size() != from.poses.size() || to.poseVersions.size() != from.poseVersions.size())
+    {
+        to.poses = from.poses;
+        to.poseVersions = from.poseVersions;
+    }
+    else
+    {
+        for (int i = 0; i < from.poseVersions.size(); i++)
+        {
+            const ModelData &model = scene.structModels[i];
+            if (model.poseStart < 0 || to.poseVersions[i] == from.poseVersions[i])
+            {
+                continue;
+            }
+            std::copy(from.poses.begin() + model.poseStart, from.poses.begin() + model.poseStart + model.boneCount, to.poses.begin() + model.poseStart);
+            to.poseVersions[i] = from.poseVersions[i];
+        }
+    }
+
+    to.cloth = from.cloth;
+    to.cameraFollow = from.cameraFollow;
+    to.cameraPosition = from.cameraPosition;
+    to.cameraYaw = from.cameraYaw;
+}
+
+bool Animation::inputsChanged(const PoseState &state, const Physics &physics)
+{
+    return !state.posed || state.baseTransform != physics.baseTransform || state.steeringAngle != physics.steeringAngle ||
+           state.wheelAngle != physics.wheelAngle || state.MastAngle != physics.MastAngle || state.BoomAngle != physics.BoomAngle ||
+           state.SailAngle != physics.SailAngle;
+}
+
+void Animation::updateBones(Scene &scene, FrameState &frame)
+{
+    frame.cameraFollow = false;
+    poseStates.resize(scene.structModels.size());
+    int deferred = 0;
+    posing.clear();
+    copying.clear();
+
+    // Frame of another layout holds nothing to keep
+    bool whole = frame.poses.size() != poses.globals.size() || frame.poseVersions.size() != scene.structModels.size();
+    if (whole)
+    {
+        frame.poseVersions.assign(scene.structModels.size(), 0);
+    }
+
     // For every model thats anymated, create bones
-    for (auto ModelData : scene.structModels)
+    for (int i = 0; i < scene.structModels.size(); i++)
     {
-        if (ModelData.animated)
+        ModelData &ModelData = scene.structModels[i];
+        if (!ModelData.animated || ModelData.poseStart < 0)
+        {
+            continue;
+        }
+
+        PoseState &state = poseStates[i];
+        Physics &physics = *ModelData.physics[0];
+        state.age++;
+
+        // Parked yachts keep their pose, unless a clip plays on them. Moving sail cloth only takes a new
+        // version so render picks it up, its bones stay as they are
+        bool clothed = ModelData.clothInstance >= 0 && (clothActive(ModelData) || sails.moving(ModelData.clothInstance));
+        bool moved = ModelData.clip >= 0 || inputsChanged(state, physics);
+        if (moved || clothed)
+        {
+            // Out of view waits until in view, far ones pose less often. Controlled yacht always poses
+            int index = ModelData.fleetIndex;
+            bool tracked = index >= 0 && index < Physics::lod.tiers.size();
+            bool visible = !tracked || Physics::lod.visible[index];
+            int interval = tracked ? poseIntervals[Physics::lod.tiers[index]] : 1;
+
+            if (ModelData.controlled || (visible && state.age >= interval))
+            {
+                if (moved)
+                {
+                    updateYachtBones(ModelData);
+
+                    state.baseTransform = physics.baseTransform;
+                    state.steeringAngle = physics.steeringAngle;
+                    state.wheelAngle = physics.wheelAngle;
+                    state.MastAngle = physics.MastAngle;
+                    state.BoomAngle = physics.BoomAngle;
+                    state.SailAngle = physics.SailAngle;
+                    state.posed = true;
+                    posing.push_back(i);
+                }
+                state.age = 0;
+                state.version++;
+            }
+            else
+            {
+                deferred++;
+            }
+        }
+
+        // Slice frame holds is older than this pose
+        if (whole || frame.poseVersions[i] != state.version)
         {
-            updateYachtBones(ModelData);
-        };
+            copying.push_back(i);
+            frame.poseVersions[i] = state.version;
+        }
+    };
+
+    // Clip layer, then globals of each posed slice in one pass over its skeleton
+    applyClips(scene, posing);
+    for (int i : posing)
+    {
+        poses.pose(scene.structModels[i].model->skeleton, scene.structModels[i].poseStart);
+    }
+
+    // Cloth follows sail bones just posed
+    updateSails(scene, frame);
+
+    for (ModelData &ModelData : scene.structModels)
+    {
+        if (ModelData.controlled && ModelData.poseStart >= 0)
+        {
+            followYacht(ModelData, frame);
+        }
+    }
+
+    // Poses into frame, only slices it lacks
+    if (whole)
+    {
+        frame.poses.assign(poses.globals.begin(), poses.globals.end());
+    }
+    else
+    {
+        for (int i : copying)
+        {
+            const glm::mat4 *slice = poses.globals.data() + scene.structModels[i].poseStart;
+            std::copy(slice, slice + scene.structModels[i].boneCount, frame.poses.data() + scene.structModels[i].poseStart);
+        }
+    }
+
+    if (Physics::debug)
+    {
+        Physics::debugData.posesUpdated = posing.size();
+        Physics::debugData.posesDeferred = deferred;
+    }
+}
+
+void Animation::applyClips(Scene &scene, const std::vector<int> &models)
+{
+    // Clip of a posed model, none if it plays none
+    auto clipOf = [&](int model) -> const AnimationClip *
+    {
+        ModelData &ModelData = scene.structModels[model];
+        return ModelData.clip >= 0 ? &ModelData.model->clips[ModelData.clip] : nullptr;
     };
+
+    for (int first = 0; first < models.size(); first++)
+    {
+        // Each clip once, at first model playing it
+        const AnimationClip *clip = clipOf(models[first]);
+        if (!clip || std::any_of(models.begin(), models.begin() + first, [&](int model)
+                                 { return clipOf(model) == clip; }))
+        {
+            continue;
+        }
+
+        // Every posed instance of clip
+        clipModels.clear();
+        clipTimes.clear();
+        clipWeights.clear();
+        for (int k = first; k < models.size(); k++)
+        {
+            if (clipOf(models[k]) == clip)
+            {
+                clipModels.push_back(models[k]);
+                clipTimes.push_back(Physics::time + 0.618034f * clip->duration * models[k]);
+                clipWeights.push_back(scene.structModels[models[k]].clipWeight);
+            }
+        }
+
+        int count = clipModels.size();
+        clipRotations.resize(clip->tracks() * 4 * count);
+        clipTranslations.resize(clip->tracks() * 3 * count);
+        AnimationClip::sample(*clip, clipTimes.data(), clipWeights.data(), count, clipRotations.data(), clipTranslations.data());
+
+        // Clip moves bones relative to their procedural pose
+        for (int instance = 0; instance < count; instance++)
+        {
+            glm::mat4 *locals = poses.locals.data() + scene.structModels[clipModels[instance]].poseStart;
+            for (int track = 0; track < clip->tracks(); track++)
+            {
+                glm::mat4 &local = locals[clip->bones[track]];
+                local = local * AnimationClip::transform(clipRotations.data(), clipTranslations.data(), count, track, instance);
+            }
+        }
+    }
+}
+
+bool Animation::clothActive(const ModelData &ModelData)
+{
+    // Near yachts in view, and those outside the fleet
+    int index = ModelData.fleetIndex;
+    if (!SailCloth::enabled || ModelData.boneHandles[sailBone] < 0)
+    {
+        return false;
+    }
+    if (index < 0 || index >= Physics::lod.tiers.size())
+    {
+        return true;
+    }
+    return Physics::lod.tiers[index] == nearTier && Physics::lod.visible[index];
+}
+
+void Animation::updateSails(Scene &scene, FrameState &frame)
+{
+    for (ModelData &ModelData : scene.structModels)
+    {
+        int instance = ModelData.clothInstance;
+        if (instance < 0 || instance >= sails.size())
+        {
+            continue;
+        }
+
+        sails.active[instance] = clothActive(ModelData) ? 1.0f : 0.0f;
+        if (sails.active[instance] == 0.0f)
+        {
+            continue;
+        }
+
+        // Wind at yacht less its own motion, in model space like the body pose
+        Physics *physics = ModelData.physics[0];
+        int index = ModelData.fleetIndex;
+        glm::vec3 wind = Physics::windDirection * Physics::windStrength;
+        if (index >= 0 && index < Physics::fleet.size())
+        {
+            wind = glm::vec3(Physics::fleet.windX[index], Physics::fleet.windY[index], 0.0f);
+        }
+        glm::vec3 apparentWind = wind - glm::normalize(glm::vec3(physics->baseTransform[1])) * physics->forwardVelocity;
+
+        // Cloth lives in bind space of sail bone, turn wind and gravity back into it
+        int bone = ModelData.boneHandles[sailBone];
+        glm::mat3 toBind = glm::inverse(glm::mat3(poses.globals[ModelData.poseStart + bone] * ModelData.model->skeleton.inverseOffsets[bone]));
+        glm::vec3 windBind = toBind * apparentWind;
+        glm::vec3 gravityBind = toBind * glm::vec3(0.0f, 0.0f, -Physics::g);
+
+        sails.windX[instance] = windBind.x;
+        sails.windY[instance] = windBind.y;
+        sails.windZ[instance] = windBind.z;
+        sails.gravityX[instance] = gravityBind.x;
+        sails.gravityY[instance] = gravityBind.y;
+        sails.gravityZ[instance] = gravityBind.z;
+    }
+
+    sails.step(Physics::deltaTime, Physics::time);
+
+    // All instances' offsets into frame at once
+    frame.cloth.resize(sails.size() * SailCloth::particles);
+    for (int instance = 0; instance < sails.size(); instance++)
+    {
+        sails.offsets(instance, frame.cloth.data() + instance * SailCloth::particles);
+    }
+
+    if (Physics::debug)
+    {
+        Physics::debugData.sailsSimulated = sails.stepped;
+    }
+}
+
+std::vector<int> Animation::resolveBones(const Skeleton &skeleton)
+{
+    std::vector<int> handles;
+    for (const std::string &name : yachtBoneNames)
+    {
+        handles.push_back(skeleton.find(name));
+    }
+    return handles;
 }
 
 void Animation::updateYachtBones(ModelData &ModelData)
 {
     // Abreviations
-    Model *model = ModelData.model;
     Physics *physics = ModelData.physics[0];
+    const std::vector<int> &bones = ModelData.boneHandles;
+    glm::mat4 *locals = poses.locals.data() + ModelData.poseStart;
+
+    // Bones without a procedural driver start from bind pose, clips go on top
+    std::fill(locals, locals + ModelData.boneCount, glm::mat4(1.0f));
+
+    // Local transform of a bone, skipped if model lacks it
+    auto setLocal = [&](YachtBone bone, const glm::mat4 &transform)
+    {
+        if (bones[bone] >= 0)
+        {
+            locals[bones[bone]] = transform;
+        }
+    };
 
     // Body Transform
-    model->boneHierarchy["Armature_Body"]->transform = physics->baseTransform;
+    setLocal(bodyBone, physics->baseTransform);
 
     // Wheel transforms
-    model->boneHierarchy["Armature_Fork"]->transform = glm::rotate(glm::mat4(1.0f), glm::radians(physics->steeringAngle * 2), glm::vec3(0.0f, -1.0f, 0.0f));
-    model->boneHierarchy["Armature_Wheel_Front"]->transform = glm::rotate(glm::mat4(1.0f), glm::radians(physics->wheelAngle), glm::vec3(0.0f, 1.0f, 0.0f));
-    model->boneHierarchy["Armature_Wheel_Left"]->transform = glm::rotate(glm::mat4(1.0f), glm::radians(physics->wheelAngle), glm::vec3(0.0f, 1.0f, 0.0f));
-    model->boneHierarchy["Armature_Wheel_Right"]->transform = glm::rotate(glm::mat4(1.0f), glm::radians(-physics->wheelAngle), glm::vec3(0.0f, 1.0f, 0.0f));
+    setLocal(forkBone, glm::rotate(glm::mat4(1.0f), glm::radians(physics->steeringAngle * 2), glm::vec3(0.0f, -1.0f, 0.0f)));
+    setLocal(wheelFrontBone, glm::rotate(glm::mat4(1.0f), glm::radians(physics->wheelAngle), glm::vec3(0.0f, 1.0f, 0.0f)));
+    setLocal(wheelLeftBone, glm::rotate(glm::mat4(1.0f), glm::radians(physics->wheelAngle), glm::vec3(0.0f, 1.0f, 0.0f)));
+    setLocal(wheelRightBone, glm::rotate(glm::mat4(1.0f), glm::radians(-physics->wheelAngle), glm::vec3(0.0f, 1.0f, 0.0f)));
 
     // Sail setup transform
-    model->boneHierarchy["Armature_Mast"]->transform = glm::rotate(glm::mat4(1.0f), physics->MastAngle, glm::vec3(0.0f, -1.0f, 0.0f));
-    model->boneHierarchy["Armature_Boom"]->transform = glm::rotate(glm::rotate(
-                                                                       glm::mat4(1.0f), abs(physics->SailAngle - physics->BoomAngle) / 2.0f,
-                                                                       glm::vec3(1.0f, 0.0f, 0.0f)),
-                                                                   physics->BoomAngle - physics->MastAngle, glm::vec3(0.0f, 0.0f, -1.0f));
-    model->boneHierarchy["Armature_Sail"]->transform = glm::rotate(glm::mat4(1.0f), physics->SailAngle - physics->MastAngle, glm::vec3(0.0f, 0.0f, -1.0f));
+    setLocal(mastBone, glm::rotate(glm::mat4(1.0f), physics->MastAngle, glm::vec3(0.0f, -1.0f, 0.0f)));
+    setLocal(boomBone, glm::rotate(glm::rotate(
+                                       glm::mat4(1.0f), abs(physics->SailAngle - physics->BoomAngle) / 2.0f,
+                                       glm::vec3(1.0f, 0.0f, 0.0f)),
+                                   physics->BoomAngle - physics->MastAngle, glm::vec3(0.0f, 0.0f, -1.0f)));
+    setLocal(sailBone, glm::rotate(glm::mat4(1.0f), physics->SailAngle - physics->MastAngle, glm::vec3(0.0f, 0.0f, -1.0f)));
+
+}
 
-    // Push updates to children
-    model->updateBoneTransforms();
+void Animation::followYacht(ModelData &ModelData, FrameState &frame)
+{
+    Physics *physics = ModelData.physics[0];
+    const std::vector<int> &bones = ModelData.boneHandles;
+    const glm::mat4 *globals = poses.globals.data() + ModelData.poseStart;
 
-    // If controlled, make camera follow
-    if (ModelData.controlled)
+    // Camera follows cam bone of controlled yacht
+    if (bones[camBone] >= 0)
     {
-        Camera::cameraPosition = (ModelData.u_model * model->boneTransforms[model->boneHierarchy["Armature_Cam"]->index]) * glm::vec4(0, 0, 0, 1);
-        Camera::yaw = atan2(physics->baseTransform[0][1], physics->baseTransform[1][1]) + M_PI;
+        frame.cameraFollow = true;
+        frame.cameraPosition = (ModelData.u_model * globals[bones[camBone]]) * glm::vec4(0, 0, 0, 1);
+        frame.cameraYaw = atan2(physics->baseTransform[0][1], physics->baseTransform[1][1]) + M_PI;
     }
 };
\ No newline at end of file
@@ -1,17 +1,89 @@
 #ifndef ANIMATION_H
 #define ANIMATION_H
 
-#include <unordered_map>
-#include <iostream>
+#include <array>
+#include <string>
+#include <vector>
 
 #include "scene/scene.h"
+#include "frame/frame.h"
+#include "pose_arena/pose_arena.h"
+#include "sail_cloth/sail_cloth.h"
+
+// Bones of a yacht that animation drives, handles are in ModelData::boneHandles in this order
+enum YachtBone
+{
+    bodyBone,
+    forkBone,
+    wheelFrontBone,
+    wheelLeftBone,
+    wheelRightBone,
+    mastBone,
+    boomBone,
+    sailBone,
+    camBone,
+    yachtBoneCount
+};
+
+// Values a yacht pose is made from, and when it was last made
+struct PoseState
+{
+    glm::mat4 baseTransform = glm::mat4(1.0f);
+    float steeringAngle = 0.0f;
+    float wheelAngle = 0.0f;
+    float MastAngle = 0.0f;
+    float BoomAngle = 0.0f;
+    float SailAngle = 0.0f;
+
+    bool posed = false;
+    int age = 0;
+    unsigned int version = 1;
+};
 
 class Animation
 {
 public:
-    static void updateBones(Scene &scene);
+    // Poses simulation writes, sliced as in Scene::poses. Laid out again on simulation thread for each new scene
+    static PoseArena poses;
+    static void setup(Scene &scene);
+
+    // Steps between poses per simulation tier. Poses are only made when their inputs changed,
+    // and for yachts out of view not until they are in view again
+    static std::array<int, 3> poseIntervals;
+
+    // Pose yachts of scene, and write slices frame does not hold yet into it
+    static void updateBones(Scene &scene, FrameState &frame);
+
+    // Copy state between frames, pose slices only where versions differ. Frames rotate through the
+    // mailbox, so each one still holds what did not change since it was last written
+    static void copyState(const Scene &scene, const FrameState &from, FrameState &to);
     static void updateYachtBones(ModelData &ModelData);
-    static std::unordered_map<std::string, std::map<std::string, int>> yachtBoneMap;
+    static void followYacht(ModelData &ModelData, FrameState &frame);
+
+    // Sail cloth of every yacht with one, same instances as Scene::cloth. Simulated for near yachts in view,
+    // others ease back to the rigid sail bone
+    static SailCloth sails;
+    static void updateSails(Scene &scene, FrameState &frame);
+    static bool clothActive(const ModelData &ModelData);
+
+    // Baked clips on top of procedural locals of models posed this step, all instances of a clip
+    // sampled in one call. Instances play with a phase offset so fleets do not move in step
+    static void applyClips(Scene &scene, const std::vector<int> &models);
+
+    // Names of yacht bones, and their handles in a skeleton, -1 for those it does not have
+    static const std::vector<std::string> yachtBoneNames;
+    static std::vector<int> resolveBones(const Skeleton &skeleton);
+
+private:
+    // Per scene model, same order
+    static std::vector<PoseState> poseStates;
+    static bool inputsChanged(const PoseState &state, const Physics &physics);
+
+    // Models posed this step, models whose slice frame lacks, and clip sampling buffers, kept to not allocate per step
+    static std::vector<int> posing;
+    static std::vector<int> copying;
+    static std::vector<int> clipModels;
+    static std::vector<float> clipTimes, clipWeights, clipRotations, clipTranslations;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "animation_clip/animation_clip.h"
+
+#include <assimp/scene.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "lanes/lanes.h"
+
+// Kernel is written once for lane types, instantiated for SIMD and scalar
+using namespace lanes;
+
+namespace
+{
+    // Index of key before tick, keys are sorted by time
+    template <typename Key>
+    unsigned int keyBefore(const Key *keys, unsigned int count, double tick)
+    {
+        unsigned int index = 0;
+        while (index + 1 < count && keys[index + 1].mTime <= tick)
+        {
+            index++;
+        }
+        return index;
+    }
+
+    // Node transform of channel at tick, between its keys
+    glm::mat4 channelTransform(const aiNodeAnim *channel, double tick)
+    {
+        glm::vec3 position(0.0f), scale(1.0f);
+        glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+
+        if (channel->mNumPositionKeys > 0)
+        {
+            unsigned int i = keyBefore(channel->mPositionKeys, channel->mNumPositionKeys, tick);
+            unsigned int j = std::min(i + 1, channel->mNumPositionKeys - 1);
+            const aiVectorKey &a = channel->mPositionKeys[i], &b = channel->mPositionKeys[j];
+            float t = b.mTime > a.mTime ? std::clamp((float)((tick - a.mTime) / (b.mTime - a.mTime)), 0.0f, 1.0f) : 0.0f;
+            position = glm::mix(glm::vec3(a.mValue.x, a.mValue.y, a.mValue.z), glm::vec3(b.mValue.x, b.mValue.y, b.mValue.z), t);
+        }
+
+        if (channel->mNumRotationKeys > 0)
+        {
+            unsigned int i = keyBefore(channel->mRotationKeys, channel->mNumRotationKeys, tick);
+            unsigned int j = std::min(i + 1, channel->mNumRotationKeys - 1);
+            const aiQuatKey &a = channel->mRotationKeys[i], &b = channel->mRotationKeys[j];
+            float t = b.mTime > a.mTime ? std::clamp((float)((tick - a.mTime) / (b.mTime - a.mTime)), 0.0f, 1.0f) : 0.0f;
+            rotation = glm::slerp(glm::quat(a.mValue.w, a.mValue.x, a.mValue.y, a.mValue.z), glm::quat(b.mValue.w, b.mValue.x, b.mValue.y, b.mValue.z), t);
+        }
+
+        if (channel->mNumScalingKeys > 0)
+        {
+            unsigned int i = keyBefore(channel->mScalingKeys, channel->mNumScalingKeys, tick);
+            unsigned int j = std::min(i + 1, channel->mNumScalingKeys - 1);
+            const aiVectorKey &a = channel->mScalingKeys[i], &b = channel->mScalingKeys[j];
+            float t = b.mTime > a.mTime ? std::clamp((float)((tick - a.mTime) / (b.mTime - a.mTime)), 0.0f, 1.0f) : 0.0f;
+            scale = glm::mix(glm::vec3(a.mValue.x, a.mValue.y, a.mValue.z), glm::vec3(b.mValue.x, b.mValue.y, b.mValue.z), t);
+        }
+
+        return glm::scale(glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation), scale);
+    }
+
+    // Sample clip for L::width instances starting at i, into track major rows of count values
+    template <typename L>
+    void sampleLanes(const AnimationClip &clip, const float *times, const float *weights, int i, int count, float *rotations, float *translations)
+    {
+        int tracks = clip.tracks();
+
+        // Frame before each instance's time in looped clip, and how far past it
+        L duration(clip.duration);
+        L time = L::load(times + i);
+        time = time - floor(time / duration) * duration;
+        L key = time * clip.keyRate;
+        L frame = min(floor(key), L((float)(clip.frameCount - 2)));
+        L t = key - frame;
+        L weight = L::load(weights + i);
+
+        float frames[8];
+        frame.store(frames);
+
+        for (int track = 0; track < tracks; track++)
+        {
+            // Quantized rotations of both frames per lane, neighbouring keys share a hemisphere
+            float a[4][8], b[4][8];
+            for (int lane = 0; lane < L::width; lane++)
+            {
+                const int16_t *keyA = &clip.rotations[((int)frames[lane] * tracks + track) * 4];
+                const int16_t *keyB = keyA + tracks * 4;
+                for (int c = 0; c < 4; c++)
+                {
+                    a[c][lane] = keyA[c];
+                    b[c][lane] = keyB[c];
+                }
+            }
+
+            // Normalized lerp between frames
+            L q[4];
+            for (int c = 0; c < 4; c++)
+            {
+                L qa = L::load(a[c]), qb = L::load(b[c]);
+                q[c] = qa + (qb - qa) * t;
+            }
+
+            // Blend from identity by weight, the short way round
+            L flip = select(q[3] < 0.0f, L(-1.0f), L(1.0f));
+            L x = q[0] * flip, y = q[1] * flip, z = q[2] * flip, w = q[3] * flip;
+            L length = sqrt(x * x + y * y + z * z + w * w);
+            L scale = weight / max(length, L(1e-6f));
+            x = x * scale;
+            y = y * scale;
+            z = z * scale;
+            w = w * scale + (L(1.0f) - weight);
+            L inverse = L(1.0f) / max(sqrt(x * x + y * y + z * z + w * w), L(1e-6f));
+
+            float *rotationRows = rotations + track * 4 * count;
+            (x * inverse).store(rotationRows + i);
+            (y * inverse).store(rotationRows + count + i);
+            (z * inverse).store(rotationRows + 2 * count + i);
+            (w * inverse).store(rotationRows + 3 * count + i);
+
+            // Translations per frame are tracks * 3 apart
+            float *translationRows = translations + track * 3 * count;
+            L index = frame * (float)(tracks * 3) + (float)(track * 3);
+            for (int c = 0; c < 3; c++)
+            {
+                L ta = gather(clip.translations.data(), index + (float)c);
+                L tb = gather(clip.translations.data(), index + (float)(tracks * 3 + c));
+                ((ta + (tb - ta) * t) * weight).store(translationRows + c * count + i);
+            }
+        }
+    }
+}
+
+bool AnimationClip::bake(const aiAnimation *animation, const aiNode *root, const Skeleton &skeleton, float rate)
+{
+    double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+    name = animation->mName.C_Str();
+    duration = animation->mDuration / ticksPerSecond;
+    keyRate = rate;
+    bones.clear();
+    rotations.clear();
+    translations.clear();
+
+    if (duration <= 0.0f || keyRate <= 0.0f)
+    {
+        return false;
+    }
+
+    // Last frame is at duration, so a looped sample never reads past the end. Rate is evened out so
+    // frames are spaced alike up to it, sampling assumes 1 / keyRate between all of them
+    frameCount = std::max(2, (int)std::ceil(duration * keyRate) + 1);
+    keyRate = (frameCount - 1) / duration;
+
+    // Track per channel of a skeleton bone, locals are relative to bind transform of its node
+    std::vector<const aiNodeAnim *> channels;
+    std::vector<glm::mat4> inverseBinds;
+    for (unsigned int i = 0; i < animation->mNumChannels; i++)
+    {
+        const aiNodeAnim *channel = animation->mChannels[i];
+        int bone = skeleton.find(channel->mNodeName.C_Str());
+        const aiNode *node = root->FindNode(channel->mNodeName);
+        if (bone < 0 || !node)
+        {
+            continue;
+        }
+
+        bones.push_back(bone);
+        channels.push_back(channel);
+        inverseBinds.push_back(glm::inverse(glm::transpose(glm::make_mat4(&node->mTransformation.a1))));
+    }
+
+    if (bones.empty())
+    {
+        return false;
+    }
+
+    int trackCount = tracks();
+    rotations.resize(frameCount * trackCount * 4);
+    translations.resize(frameCount * trackCount * 3);
+    std::vector<glm::quat> previous(trackCount);
+
+    for (int frame = 0; frame < frameCount; frame++)
+    {
+        double tick = std::min((double)frame / keyRate, (double)duration) * ticksPerSecond;
+
+        for (int track = 0; track < trackCount; track++)
+        {
+            glm::mat4 local = inverseBinds[track] * channelTransform(channels[track], tick);
+            glm::mat3 rotationMatrix(glm::normalize(glm::vec3(local[0])), glm::normalize(glm::vec3(local[1])), glm::normalize(glm::vec3(local[2])));
+            glm::quat rotation = glm::normalize(glm::quat_cast(rotationMatrix));
+
+            // Same hemisphere as key before, so frames blend the short way
+            if (frame > 0 && glm::dot(rotation, previous[track]) < 0.0f)
+            {
+                rotation = -rotation;
+            }
+            previous[track] = rotation;
+
+            int16_t *rotationKey = &rotations[(frame * trackCount + track) * 4];
+            float components[4] = {rotation.x, rotation.y, rotation.z, rotation.w};
+            for (int c = 0; c < 4; c++)
+            {
+                rotationKey[c] = (int16_t)std::lround(std::clamp(components[c], -1.0f, 1.0f) * quantizeScale);
+            }
+
+            float *translationKey = &translations[(frame * trackCount + track) * 3];
+            translationKey[0] = local[3][0];
+            translationKey[1] = local[3][1];
+            translationKey[2] = local[3][2];
+        }
+    }
+
+    return true;
+}
+
+void AnimationClip::sample(const AnimationClip &clip, const float *times, const float *weights, int count, float *rotations, float *translations)
+{
+    int i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; i + SimdLanes::width <= count; i += SimdLanes::width)
+    {
+        sampleLanes<SimdLanes>(clip, times, weights, i, count, rotations, translations);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        sampleLanes<ScalarLanes>(clip, times, weights, i, count, rotations, translations);
+    }
+}
+
+glm::mat4 AnimationClip::transform(const float *rotations, const float *translations, int count, int track, int instance)
+{
+    const float *rotationRows = rotations + track * 4 * count + instance;
+    const float *translationRows = translations + track * 3 * count + instance;
+
+    glm::mat4 result = glm::mat4_cast(glm::quat(rotationRows[3 * count], rotationRows[0], rotationRows[count], rotationRows[2 * count]));
+    result[3] = glm::vec4(translationRows[0], translationRows[count], translationRows[2 * count], 1.0f);
+    return result;
+}
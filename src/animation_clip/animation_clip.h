@@ -0,0 +1,50 @@
+#ifndef ANIMATION_CLIP_H
+#define ANIMATION_CLIP_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "skeleton/skeleton.h"
+
+struct aiAnimation;
+struct aiNode;
+
+// Imported animation baked at a fixed key rate, for a skeleton. Keys are frame major, all tracks of a
+// frame back to back, so sampling a frame reads two short blocks. Rotations are quantized to 16 bits
+// per component, scale keys are dropped as yacht rigs have none
+class AnimationClip
+{
+public:
+    std::string name;
+    float duration = 0.0f;
+    float keyRate = 30.0f;
+    int frameCount = 0;
+
+    // Skeleton bone each track drives
+    std::vector<int> bones;
+    int tracks() const { return bones.size(); }
+
+    // Per frame and track, rotation x y z w over quantizeScale, and translation. Relative to bind pose
+    // like the locals of PoseArena
+    std::vector<int16_t> rotations;
+    std::vector<float> translations;
+
+    static constexpr float quantizeScale = 32767.0f;
+
+    // Bake Assimp animation at keys spaced evenly from 0 to duration, at least keyRate per second. Rate of
+    // clip is that spacing. Channels of nodes skeleton lacks are dropped, false if no channel drives a bone
+    bool bake(const aiAnimation *animation, const aiNode *root, const Skeleton &skeleton, float keyRate);
+
+    // Sample clip for count instances in one pass, SIMD across instances. Clip loops, and each instance
+    // is blended from bind pose by its weight. Output is per track four rotation rows x y z w and three
+    // translation rows, count values each
+    static void sample(const AnimationClip &clip, const float *times, const float *weights, int count, float *rotations, float *translations);
+
+    // Local transform of track for instance, from sampled rows
+    static glm::mat4 transform(const float *rotations, const float *translations, int count, int track, int instance);
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "autopilot/autopilot.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "fleet/fleet.h"
+#include "lanes/lanes.h"
+#include "snapshot/snapshot.h"
+
+using namespace lanes;
+
+namespace
+{
+    // Inputs for L::width yachts starting at index i
+    template <typename L>
+    void steerLanes(Fleet &f, const Autopilot &pilot, const float *toTargetX, const float *toTargetY, float *tack, int i)
+    {
+        L headingX = L::load(&f.headingX[i]), headingY = L::load(&f.headingY[i]);
+        L targetX = L::load(&toTargetX[i]), targetY = L::load(&toTargetY[i]);
+
+        // Upwind, against local wind
+        L windX = L::load(&f.windX[i]), windY = L::load(&f.windY[i]);
+        L inverseWind = L(1.0f) / max(sqrt(windX * windX + windY * windY), L(1e-30f));
+        L upX = -windX * inverseWind, upY = -windY * inverseWind;
+
+        // Angles from upwind, counterclockwise positive
+        L targetAngle = arcTangent2(upX * targetY - upY * targetX, upX * targetX + upY * targetY);
+        L headingAngle = arcTangent2(upX * headingY - upY * headingX, upX * headingX + upY * headingY);
+
+        // Beat at no go angle on one side, tack once waypoint is past the wind by margin
+        L side = L::load(&tack[i]);
+        typename L::Mask beating = abs(targetAngle) < pilot.noGoAngle;
+        L swapped = select(targetAngle * side < -pilot.tackMargin, -side, side);
+        side = select(beating, swapped, select(targetAngle < 0.0f, L(-1.0f), L(1.0f)));
+        side.store(&tack[i]);
+
+        // Steer towards course, positive steer input turns heading clockwise
+        L course = select(beating, side * pilot.noGoAngle, targetAngle);
+        L error = course - headingAngle;
+        error = error - round(error * (0.5f / pi)) * (2.0f * pi);
+        clamp(-error * pilot.steerGain, L(-1.0f), L(1.0f)).store(&f.steer[i]);
+
+        // Sail control that puts sail at optimal angle to apparent wind, boom follows control times angle to wind
+        L angleToWind = abs(L::load(&f.angleToWind[i]));
+        L angleToApparentWind = abs(L::load(&f.angleToApparentWind[i]));
+        L trim = clamp((angleToApparentWind - L::load(&f.optimalAngle[i])) / max(angleToWind, L(0.1f)), L(0.2f), L(1.0f));
+        L control = L::load(&f.sailControl[i]);
+        clamp((trim - control) * pilot.trimGain, L(0.0f), L(1.0f)).store(&f.sheetIn[i]);
+        clamp((control - trim) * pilot.trimGain, L(0.0f), L(1.0f)).store(&f.sheetOut[i]);
+
+        // Push off when nearly stopped
+        select(L::load(&f.velocity[i]) < pilot.pushVelocity, L(1.0f), L(0.0f)).store(&f.push[i]);
+    }
+}
+
+int Autopilot::add()
+{
+    toTargetX.push_back(0.0f);
+    toTargetY.push_back(0.0f);
+    tack.push_back(1.0f);
+    targets.push_back(0);
+
+    return toTargetX.size() - 1;
+}
+
+void Autopilot::clear()
+{
+    for (std::vector<float> *array : {&toTargetX, &toTargetY, &tack})
+    {
+        array->clear();
+    }
+    targets.clear();
+    waypoints.clear();
+}
+
+void Autopilot::setCourse(const std::vector<glm::vec2> &waypoints)
+{
+    this->waypoints = waypoints;
+    std::fill(targets.begin(), targets.end(), 0);
+}
+
+void Autopilot::save(Snapshot &snapshot) const
+{
+    snapshot.write(targets);
+    snapshot.write(tack);
+}
+
+bool Autopilot::restore(Snapshot &snapshot)
+{
+    return snapshot.read(targets) && snapshot.read(tack);
+}
+
+void Autopilot::steer(Fleet &fleet)
+{
+    int count = std::min((int)toTargetX.size(), fleet.size());
+
+    // No inputs at all when switched off
+    if (!enabled)
+    {
+        for (std::vector<float> *array : {&fleet.sheetIn, &fleet.sheetOut, &fleet.steer, &fleet.push})
+        {
+            std::fill(array->begin(), array->begin() + count, 0.0f);
+        }
+        return;
+    }
+
+    // Way to next waypoint in each yacht's placement, moving on when reached
+    for (int i = 0; i < count; i++)
+    {
+        float c = fleet.originCos[i], s = fleet.originSin[i];
+        glm::vec2 toTarget = glm::vec2(fleet.headingX[i], fleet.headingY[i]) * 100.0f;
+
+        if (!waypoints.empty())
+        {
+            glm::vec2 position = glm::vec2(fleet.originX[i] + c * fleet.positionX[i] - s * fleet.positionY[i],
+                                           fleet.originY[i] + s * fleet.positionX[i] + c * fleet.positionY[i]);
+            if (glm::length(waypoints[targets[i]] - position) < arriveRadius)
+            {
+                targets[i] = (targets[i] + 1) % waypoints.size();
+            }
+
+            glm::vec2 world = waypoints[targets[i]] - position;
+            toTarget = glm::vec2(c * world.x + s * world.y, -s * world.x + c * world.y);
+        }
+
+        toTargetX[i] = toTarget.x;
+        toTargetY[i] = toTarget.y;
+    }
+
+    int i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // Full SIMD batches
+    for (; i + SimdLanes::width <= count; i += SimdLanes::width)
+    {
+        steerLanes<SimdLanes>(fleet, *this, toTargetX.data(), toTargetY.data(), tack.data(), i);
+    }
+#endif
+
+    // Remaining yachts
+    for (; i < count; i++)
+    {
+        steerLanes<ScalarLanes>(fleet, *this, toTargetX.data(), toTargetY.data(), tack.data(), i);
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class Fleet;
+class Snapshot;
+
+// Sails every fleet yacht around a course of waypoints, with the same inputs the player has. Steers
+// for the next waypoint, beats upwind in tacks when it lies too close to the wind, and trims the sail
+// to keep it at its optimal angle to the apparent wind
+class Autopilot
+{
+public:
+    // Add yacht, returns its index, same order as fleet which has its placement
+    int add();
+    void clear();
+
+    // Waypoints in world XY, sailed in order and around again, yachts hold course without any
+    void setCourse(const std::vector<glm::vec2> &waypoints);
+
+    // Inputs of every yacht from its state of last step
+    void steer(Fleet &fleet);
+
+    // Waypoint and tack of every yacht to snapshot, and back
+    void save(Snapshot &snapshot) const;
+    bool restore(Snapshot &snapshot);
+
+    // Yachts sail, or sit still with no inputs
+    bool enabled = true;
+
+    // Distance at which a waypoint counts as reached
+    float arriveRadius = 15.0f;
+
+    // Steer input per radian off course, and sheet input per unit of sail control off trim
+    float steerGain = 2.0f;
+    float trimGain = 4.0f;
+
+    // Closest course to the wind, and how far a waypoint goes past the wind before tacking
+    float noGoAngle = glm::radians(45.0f);
+    float tackMargin = glm::radians(10.0f);
+
+    // Push off below this velocity
+    float pushVelocity = 1.0f;
+
+    // Index of next waypoint per yacht
+    std::vector<int> targets;
+
+private:
+    // Way to next waypoint per yacht in its placement, and side of the wind it beats on, 1 or -1
+    std::vector<float> toTargetX, toTargetY, tack;
+
+    std::vector<glm::vec2> waypoints;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "bone_palette/bone_palette.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+
+int BonePalette::vectorsPerBone(PaletteEncoding encoding)
+{
+    switch (encoding)
+    {
+    case affinePalette:
+        return 3;
+    case dualQuaternionPalette:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+int BonePalette::maxBones(PaletteEncoding encoding)
+{
+    return maxVectors / vectorsPerBone(encoding);
+}
+
+bool BonePalette::parse(const std::string &name, PaletteEncoding &encoding)
+{
+    if (name == "matrix")
+    {
+        encoding = matrixPalette;
+    }
+    else if (name == "affine")
+    {
+        encoding = affinePalette;
+    }
+    else if (name == "dualQuaternion")
+    {
+        encoding = dualQuaternionPalette;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+PaletteEncoding BonePalette::choose(PaletteEncoding requested, const Skeleton &skeleton)
+{
+    // Matrix and affine hold the same transform, dual quaternions are the last resort
+    if (skeleton.size() <= maxBones(requested))
+    {
+        return requested;
+    }
+    if (skeleton.size() <= maxBones(affinePalette))
+    {
+        return affinePalette;
+    }
+    return dualQuaternionPalette;
+}
+
+void BonePalette::encode(PaletteEncoding encoding, const glm::mat4 *globals, const std::vector<glm::mat4> &inverseOffsets, int count,
+                         std::vector<glm::vec4> &palette)
+{
+    int stride = vectorsPerBone(encoding);
+    count = std::min(count, maxBones(encoding));
+    palette.resize(count * stride);
+
+    for (int i = 0; i < count; i++)
+    {
+        glm::mat4 skin = globals[i] * inverseOffsets[i];
+        glm::vec4 *out = palette.data() + i * stride;
+
+        if (encoding == matrixPalette)
+        {
+            out[0] = skin[0];
+            out[1] = skin[1];
+            out[2] = skin[2];
+            out[3] = skin[3];
+        }
+        else if (encoding == affinePalette)
+        {
+            // Bottom row is always 0 0 0 1
+            out[0] = glm::vec4(skin[0][0], skin[1][0], skin[2][0], skin[3][0]);
+            out[1] = glm::vec4(skin[0][1], skin[1][1], skin[2][1], skin[3][1]);
+            out[2] = glm::vec4(skin[0][2], skin[1][2], skin[2][2], skin[3][2]);
+        }
+        else
+        {
+            // Rotation without scale, translation as dual part 0.5 * t * rotation
+            glm::mat3 rotation(glm::normalize(glm::vec3(skin[0])), glm::normalize(glm::vec3(skin[1])), glm::normalize(glm::vec3(skin[2])));
+            glm::quat real = glm::normalize(glm::quat_cast(rotation));
+            glm::quat dual = glm::quat(0.0f, skin[3][0], skin[3][1], skin[3][2]) * real * 0.5f;
+
+            out[0] = glm::vec4(real.x, real.y, real.z, real.w);
+            out[1] = glm::vec4(dual.x, dual.y, dual.z, dual.w);
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef BONE_PALETTE_H
+#define BONE_PALETTE_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "skeleton/skeleton.h"
+
+// How skinning transforms go to vertex shaders, same values as paletteEncoding there
+enum PaletteEncoding
+{
+    matrixPalette,
+    affinePalette,
+    dualQuaternionPalette
+};
+
+// Skinning transform per bone, global pose times inverse bind offset, packed in vec4s for u_bonePalette.
+// Matrix is four columns, affine the three top rows, dual quaternion a rotation and a translation part.
+// Dual quaternions keep rigid bones rigid when blended but drop scale, which yacht bones do not have
+class BonePalette
+{
+public:
+    // Vec4s in u_bonePalette of default and toon shaders
+    static const int maxVectors = 200;
+
+    static int vectorsPerBone(PaletteEncoding encoding);
+    static int maxBones(PaletteEncoding encoding);
+
+    // Encoding by name as in scene files, false for unknown names
+    static bool parse(const std::string &name, PaletteEncoding &encoding);
+
+    // Requested encoding, or a more compact one if skeleton does not fit it
+    static PaletteEncoding choose(PaletteEncoding requested, const Skeleton &skeleton);
+
+    // Palette of count bones from their globals
+    static void encode(PaletteEncoding encoding, const glm::mat4 *globals, const std::vector<glm::mat4> &inverseOffsets, int count,
+                       std::vector<glm::vec4> &palette);
+};
+
+#endif
@@ -23,6 +23,9 @@ float Camera::yawOffset, Camera::pitchOffset, Camera::rollOffset;
 // Camera related transformation matrices
 glm::mat4 Camera::u_view, Camera::u_projection, Camera::u_camXY;
 
+// Frustum planes of current view
+std::array<glm::vec4, 6> Camera::frustumPlanes;
+
 // Booleans for tracking cam state
 bool Camera::cameraMoved;
 bool Camera::freeCam;
@@ -100,6 +103,50 @@ void Camera::genViewMatrix(glm::vec3 position)
                          position + cameraViewDirection, // Target Position
                          cameraUp                        // Up vector
     );
+
+    // Keep frustum in sync with view, also for mirrored water passes
+    genFrustumPlanes();
+}
+
+// Extract frustum planes from view projection matrix
+void Camera::genFrustumPlanes()
+{
+    glm::mat4 viewProjection = u_projection * u_view;
+
+    // Rows of the view projection matrix
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+    {
+        row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    // Left, right, bottom, top, near, far
+    frustumPlanes[0] = row[3] + row[0];
+    frustumPlanes[1] = row[3] - row[0];
+    frustumPlanes[2] = row[3] + row[1];
+    frustumPlanes[3] = row[3] - row[1];
+    frustumPlanes[4] = row[3] + row[2];
+    frustumPlanes[5] = row[3] - row[2];
+}
+
+// Check if axis aligned box is (partially) inside frustum
+bool Camera::boxInFrustum(const glm::vec3 &boxMin, const glm::vec3 &boxMax)
+{
+    for (const glm::vec4 &plane : frustumPlanes)
+    {
+        // Corner of box furthest along plane normal
+        glm::vec3 positive(plane.x > 0 ? boxMax.x : boxMin.x,
+                           plane.y > 0 ? boxMax.y : boxMin.y,
+                           plane.z > 0 ? boxMax.z : boxMin.z);
+
+        // If furthest corner is behind plane, box is outside
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
 // Get camera position
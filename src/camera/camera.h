@@ -3,6 +3,8 @@
 
 #include <glm/glm.hpp>
 
+#include <array>
+
 class Camera
 {
 public:
@@ -23,6 +25,9 @@ public:
     // Camera related transformation matrices
     static glm::mat4 u_view, u_projection, u_camXY;
 
+    // Frustum planes of current view, normals pointing inward
+    static std::array<glm::vec4, 6> frustumPlanes;
+
     // Booleans for tracking cam state
     static bool cameraMoved, freeCam;
 
@@ -31,7 +36,9 @@ public:
     static void setCamDirection(glm::vec3 rotation);
     static void genViewMatrix(glm::vec3 position);
     static void genProjectionMatrix();
-    
+    static void genFrustumPlanes();
+    static bool boxInFrustum(const glm::vec3 &boxMin, const glm::vec3 &boxMax);
+
     static glm::vec3 getPosition();
     static glm::vec3 getRotation();
 };
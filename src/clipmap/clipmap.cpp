@@ -0,0 +1,249 @@
+#include "clipmap/clipmap.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "shader/shader.h"
+#include "camera/camera.h"
+
+// Clipmap Constructor
+Clipmap::Clipmap(int gridSize, int levels, float spacing)
+{
+    // Level is 4 blocks wide, block positions must fit in a byte
+    this->blockSize = std::clamp(gridSize / 4, 4, 63);
+    this->levels = std::max(levels, 1);
+    this->spacing = spacing;
+
+    // Morph odd vertices onto coarser grid near outer edge of level
+    int levelSize = 4 * blockSize - 1;
+    morphWidth = std::max(2.0f, levelSize / 10.0f);
+    morphStart = 2 * blockSize - 2 - morphWidth;
+
+    // Generate shared pieces, sizes in vertices
+    int m = blockSize;
+    block = genPiece(m, m);
+    fixupHorizontal = genPiece(m, 3);
+    fixupVertical = genPiece(3, m);
+    trimHorizontal = genPiece(2 * m, 2);
+    trimVertical = genPiece(2, 2 * m + 1);
+    center = genPiece(3, 3);
+}
+
+ClipmapPiece Clipmap::genPiece(int sizeX, int sizeY)
+{
+    ClipmapPiece piece;
+    piece.size = glm::ivec2(sizeX, sizeY);
+
+    // Make vertices
+    for (int y = 0; y < sizeY; y++)
+    {
+        for (int x = 0; x < sizeX; x++)
+        {
+            piece.positions.push_back(x);
+            piece.positions.push_back(y);
+        }
+    }
+
+    // Make faces from vertices
+    for (int y = 0; y < sizeY - 1; y++)
+    {
+        for (int x = 0; x < sizeX - 1; x++)
+        {
+            int start = y * sizeX + x;
+
+            piece.indices.push_back(start);
+            piece.indices.push_back(start + 1);
+            piece.indices.push_back(start + sizeX);
+
+            piece.indices.push_back(start + 1);
+            piece.indices.push_back(start + sizeX + 1);
+            piece.indices.push_back(start + sizeX);
+        }
+    }
+
+    return piece;
+}
+
+std::array<ClipmapPiece *, 6> Clipmap::pieces()
+{
+    return {&block, &fixupHorizontal, &fixupVertical, &trimHorizontal, &trimVertical, &center};
+}
+
+void Clipmap::uploadToGPU()
+{
+    for (ClipmapPiece *piece : pieces())
+    {
+        // Generate empty buffer data
+        glGenVertexArrays(1, &piece->VAO);
+        glGenBuffers(1, &piece->VBO);
+        glGenBuffers(1, &piece->EBO);
+        glGenBuffers(1, &piece->instanceVBO);
+
+        // Bind Vertex Array Object
+        glBindVertexArray(piece->VAO);
+
+        // Send vertices of piece to GPU
+        glBindBuffer(GL_ARRAY_BUFFER, piece->VBO);
+        glBufferData(GL_ARRAY_BUFFER, piece->positions.size() * sizeof(unsigned char), &piece->positions[0], GL_STATIC_DRAW);
+
+        // Send element indices to GPU
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, piece->EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, piece->indices.size() * sizeof(unsigned int), &piece->indices[0], GL_STATIC_DRAW);
+
+        // Vertex positions, 2 bytes per vertex
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_UNSIGNED_BYTE, GL_FALSE, 2 * sizeof(unsigned char), (void *)0);
+
+        // Per tile origin, spacing and level
+        glBindBuffer(GL_ARRAY_BUFFER, piece->instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_STREAM_DRAW);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void *)0);
+        glVertexAttribDivisor(1, 1);
+
+        // Unbind vertex array
+        glBindVertexArray(0);
+    }
+}
+
+void Clipmap::unload()
+{
+    for (ClipmapPiece *piece : pieces())
+    {
+        if (piece->VAO == 0)
+        {
+            continue;
+        }
+
+        // Release piece from GPU
+        glDeleteBuffers(1, &piece->VBO);
+        glDeleteBuffers(1, &piece->EBO);
+        glDeleteBuffers(1, &piece->instanceVBO);
+        glDeleteVertexArrays(1, &piece->VAO);
+        piece->VAO = 0;
+    }
+}
+
+void Clipmap::addTile(ClipmapPiece &piece, glm::vec2 origin, int offsetX, int offsetY, float spacing, int level)
+{
+    piece.tiles.push_back(glm::vec4(origin.x + offsetX * spacing, origin.y + offsetY * spacing, spacing, level));
+}
+
+void Clipmap::update(glm::vec2 cameraXY)
+{
+    for (ClipmapPiece *piece : pieces())
+    {
+        piece->tiles.clear();
+    }
+
+    // Block offsets within a level, gap between 2nd and 3rd block is filled by fixups
+    int m = blockSize;
+    const int offsets[4] = {0, m - 1, 2 * m, 3 * m - 1};
+
+    glm::ivec2 lastSnap;
+
+    for (int level = 0; level < levels; level++)
+    {
+        float levelSpacing = spacing * std::pow(2.0f, level);
+
+        // Snap level to grid of next coarser level, so it lines up with its vertices
+        glm::ivec2 snap(std::floor(cameraXY.x / (2 * levelSpacing)), std::floor(cameraXY.y / (2 * levelSpacing)));
+        glm::vec2 origin = glm::vec2(2 * snap.x - (2 * m - 2), 2 * snap.y - (2 * m - 2)) * levelSpacing;
+
+        // Ring of blocks, finest level also fills center
+        for (int by = 0; by < 4; by++)
+        {
+            for (int bx = 0; bx < 4; bx++)
+            {
+                if (level > 0 && (bx == 1 || bx == 2) && (by == 1 || by == 2))
+                {
+                    continue;
+                }
+                addTile(block, origin, offsets[bx], offsets[by], levelSpacing, level);
+            }
+        }
+
+        // Ring fixups between 2nd and 3rd block on each side
+        addTile(fixupVertical, origin, 2 * m - 2, 0, levelSpacing, level);
+        addTile(fixupVertical, origin, 2 * m - 2, 3 * m - 1, levelSpacing, level);
+        addTile(fixupHorizontal, origin, 0, 2 * m - 2, levelSpacing, level);
+        addTile(fixupHorizontal, origin, 3 * m - 1, 2 * m - 2, levelSpacing, level);
+
+        if (level == 0)
+        {
+            // Fill center cross of finest level
+            addTile(fixupVertical, origin, 2 * m - 2, m - 1, levelSpacing, level);
+            addTile(fixupVertical, origin, 2 * m - 2, 2 * m, levelSpacing, level);
+            addTile(fixupHorizontal, origin, m - 1, 2 * m - 2, levelSpacing, level);
+            addTile(fixupHorizontal, origin, 2 * m, 2 * m - 2, levelSpacing, level);
+            addTile(center, origin, 2 * m - 2, 2 * m - 2, levelSpacing, level);
+        }
+        else
+        {
+            // Finer level covers all but one row and column of the hole, fill those with L-shaped trim
+            glm::ivec2 fineOffset(lastSnap.x - 2 * snap.x, lastSnap.y - 2 * snap.y);
+            int trimX = fineOffset.x == 0 ? 2 * m - 1 : 0;
+            int trimY = fineOffset.y == 0 ? 2 * m - 1 : 0;
+
+            addTile(trimVertical, origin, m - 1 + trimX, m - 1, levelSpacing, level);
+            addTile(trimHorizontal, origin, m - 1 + (trimX == 0 ? 1 : 0), m - 1 + trimY, levelSpacing, level);
+        }
+
+        lastSnap = snap;
+    }
+
+    // Collect covered area of all tiles
+    tileRects.clear();
+    tileSpacings.clear();
+    for (ClipmapPiece *piece : pieces())
+    {
+        for (const glm::vec4 &tile : piece->tiles)
+        {
+            tileRects.push_back(glm::vec4(tile.x, tile.y, tile.x + (piece->size.x - 1) * tile.z, tile.y + (piece->size.y - 1) * tile.z));
+            tileSpacings.push_back(tile.z);
+        }
+    }
+}
+
+void Clipmap::render(const glm::mat4 &u_model)
+{
+    drawnTiles = 0;
+    culledTiles = 0;
+
+    // Clipmap is axis aligned, only translation applies
+    glm::vec3 offset = glm::vec3(u_model[3]);
+
+    for (ClipmapPiece *piece : pieces())
+    {
+        // Cull tiles outside of view, morphing can shift vertices by one spacing
+        piece->visibleTiles.clear();
+        for (const glm::vec4 &tile : piece->tiles)
+        {
+            glm::vec3 boxMin = offset + glm::vec3(tile.x - tile.z, tile.y - tile.z, 0.0f);
+            glm::vec3 boxMax = offset + glm::vec3(tile.x + (piece->size.x - 1) * tile.z, tile.y + (piece->size.y - 1) * tile.z, heightScale);
+
+            if (Camera::boxInFrustum(boxMin, boxMax))
+            {
+                piece->visibleTiles.push_back(tile);
+            }
+        }
+
+        drawnTiles += piece->visibleTiles.size();
+        culledTiles += piece->tiles.size() - piece->visibleTiles.size();
+
+        if (piece->visibleTiles.empty())
+        {
+            continue;
+        }
+
+        // Stream visible tiles to instance buffer
+        glBindBuffer(GL_ARRAY_BUFFER, piece->instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, piece->visibleTiles.size() * sizeof(glm::vec4), &piece->visibleTiles[0], GL_STREAM_DRAW);
+
+        // Draw all tiles of piece at once
+        glBindVertexArray(piece->VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, piece->indices.size(), GL_UNSIGNED_INT, 0, piece->visibleTiles.size());
+    }
+
+    glBindVertexArray(0);
+}
@@ -0,0 +1,76 @@
+#ifndef CLIPMAP_H
+#define CLIPMAP_H
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <vector>
+
+// Shared tile mesh of the clipmap, drawn instanced for every tile using it
+struct ClipmapPiece
+{
+    // Size in vertices
+    glm::ivec2 size;
+
+    // Small integer vertex positions and indices
+    std::vector<unsigned char> positions;
+    std::vector<unsigned int> indices;
+
+    // Tiles (origin xy, spacing, level) for the current camera position
+    std::vector<glm::vec4> tiles;
+    std::vector<glm::vec4> visibleTiles;
+
+    unsigned int VAO = 0, VBO = 0, EBO = 0, instanceVBO = 0;
+};
+
+class Clipmap
+{
+public:
+    // Default empty constructor
+    Clipmap() {};
+
+    // Actual constructor
+    Clipmap(int gridSize, int levels, float spacing);
+
+    // Local clipmap data
+    int blockSize = 0;
+    int levels = 0;
+    float spacing = 0;
+    float heightScale = 3.0f;
+
+    // Morph region at the outer edge of each level, in quads
+    float morphStart = 0;
+    float morphWidth = 0;
+
+    // Send meshes to gpu, release them again
+    void uploadToGPU();
+    void unload();
+
+    // Snap tiles to camera, cull and draw them
+    void update(glm::vec2 cameraXY);
+    void render(const glm::mat4 &u_model);
+
+    // Area of every tile (min xy, max xy) and its vertex spacing for the current camera position
+    std::vector<glm::vec4> tileRects;
+    std::vector<float> tileSpacings;
+
+    // Stats of last render
+    int drawnTiles = 0;
+    int culledTiles = 0;
+
+private:
+    // Pieces of a level ring
+    ClipmapPiece block;
+    ClipmapPiece fixupHorizontal;
+    ClipmapPiece fixupVertical;
+    ClipmapPiece trimHorizontal;
+    ClipmapPiece trimVertical;
+    ClipmapPiece center;
+
+    std::array<ClipmapPiece *, 6> pieces();
+
+    static ClipmapPiece genPiece(int sizeX, int sizeY);
+    static void addTile(ClipmapPiece &piece, glm::vec2 origin, int offsetX, int offsetY, float spacing, int level);
+};
+
+#endif
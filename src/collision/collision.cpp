@@ -0,0 +1,232 @@
+#include "collision/collision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "fleet/fleet.h"
+#include "snapshot/snapshot.h"
+
+int Collision::add(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4 &placement)
+{
+    // Placement itself is kept by fleet, its scale goes into footprint
+    float scaleX = glm::length(glm::vec3(placement[0]));
+    float scaleY = glm::length(glm::vec3(placement[1]));
+
+    centerX.push_back(0.5f * (boundsMin.x + boundsMax.x) * scaleX);
+    centerY.push_back(0.5f * (boundsMin.y + boundsMax.y) * scaleY);
+    halfWidth.push_back(0.5f * (boundsMax.x - boundsMin.x) * scaleX);
+    halfLength.push_back(0.5f * (boundsMax.y - boundsMin.y) * scaleY);
+
+    int index = centerX.size() - 1;
+    for (std::vector<float> *array : {&boxX, &boxY, &forwardX, &forwardY, &minX, &maxX, &minY, &maxY})
+    {
+        array->resize(index + 1, 0.0f);
+    }
+
+    // New ends go last, sort moves them in place
+    endpoints.push_back({0.0f, index, true});
+    endpoints.push_back({0.0f, index, false});
+    pickAxis = true;
+
+    return index;
+}
+
+void Collision::clear()
+{
+    for (std::vector<float> *array : {&centerX, &centerY, &halfWidth, &halfLength,
+                                      &boxX, &boxY, &forwardX, &forwardY, &minX, &maxX, &minY, &maxY})
+    {
+        array->clear();
+    }
+    endpoints.clear();
+    active.clear();
+    pickAxis = true;
+}
+
+void Collision::save(Snapshot &snapshot) const
+{
+    // Values are refreshed every step, order is all that carries over
+    std::vector<int> order(endpoints.size());
+    for (int i = 0; i < endpoints.size(); i++)
+    {
+        order[i] = 2 * endpoints[i].body + (endpoints[i].start ? 1 : 0);
+    }
+
+    snapshot.write(sweepAxis);
+    snapshot.write((uint8_t)pickAxis);
+    snapshot.write(order);
+}
+
+bool Collision::restore(Snapshot &snapshot)
+{
+    uint8_t savedPickAxis;
+    std::vector<int> order(endpoints.size());
+    if (!snapshot.read(sweepAxis) || !snapshot.read(savedPickAxis) || !snapshot.read(order))
+    {
+        return false;
+    }
+
+    pickAxis = savedPickAxis;
+    for (int i = 0; i < endpoints.size(); i++)
+    {
+        endpoints[i].body = order[i] / 2;
+        endpoints[i].start = order[i] % 2 == 1;
+    }
+    return true;
+}
+
+void Collision::step(Fleet &fleet)
+{
+    int count = std::min((int)centerX.size(), fleet.size());
+    candidatePairs = 0;
+    contacts = 0;
+
+    // World boxes, right of hull is (forward.y, -forward.x)
+    for (int i = 0; i < count; i++)
+    {
+        float c = fleet.originCos[i], s = fleet.originSin[i];
+        float hx = fleet.headingX[i], hy = fleet.headingY[i];
+
+        float localX = fleet.positionX[i] + hy * centerX[i] + hx * centerY[i];
+        float localY = fleet.positionY[i] - hx * centerX[i] + hy * centerY[i];
+        boxX[i] = fleet.originX[i] + c * localX - s * localY;
+        boxY[i] = fleet.originY[i] + s * localX + c * localY;
+        forwardX[i] = c * hx - s * hy;
+        forwardY[i] = s * hx + c * hy;
+
+        float extentX = std::fabs(forwardY[i]) * halfWidth[i] + std::fabs(forwardX[i]) * halfLength[i];
+        float extentY = std::fabs(forwardX[i]) * halfWidth[i] + std::fabs(forwardY[i]) * halfLength[i];
+        minX[i] = boxX[i] - extentX;
+        maxX[i] = boxX[i] + extentX;
+        minY[i] = boxY[i] - extentY;
+        maxY[i] = boxY[i] + extentY;
+    }
+
+    // A start line across the sweep axis would put every yacht in one overlap run
+    if (pickAxis && count > 0)
+    {
+        glm::vec2 mean(0.0f), spread(0.0f);
+        for (int i = 0; i < count; i++)
+        {
+            mean += glm::vec2(boxX[i], boxY[i]) / (float)count;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            glm::vec2 d = glm::vec2(boxX[i], boxY[i]) - mean;
+            spread += d * d;
+        }
+        sweepAxis = spread.y > spread.x ? 1 : 0;
+        pickAxis = false;
+    }
+
+    const std::vector<float> &sweepMin = sweepAxis == 0 ? minX : minY;
+    const std::vector<float> &sweepMax = sweepAxis == 0 ? maxX : maxY;
+    const std::vector<float> &crossMin = sweepAxis == 0 ? minY : minX;
+    const std::vector<float> &crossMax = sweepAxis == 0 ? maxY : maxX;
+
+    // Yachts barely move per step, so ends are nearly sorted and insertion sort is close to linear
+    for (Endpoint &endpoint : endpoints)
+    {
+        endpoint.value = endpoint.start ? sweepMin[endpoint.body] : sweepMax[endpoint.body];
+    }
+    for (int i = 1; i < endpoints.size(); i++)
+    {
+        Endpoint endpoint = endpoints[i];
+        int j = i - 1;
+
+        // Starts go before ends at the same value, so touching boxes count
+        while (j >= 0 && (endpoints[j].value > endpoint.value || (endpoints[j].value == endpoint.value && !endpoints[j].start && endpoint.start)))
+        {
+            endpoints[j + 1] = endpoints[j];
+            j--;
+        }
+        endpoints[j + 1] = endpoint;
+    }
+
+    // Sweep, yachts overlapping on both axes go to narrowphase
+    active.clear();
+    for (const Endpoint &endpoint : endpoints)
+    {
+        int body = endpoint.body;
+        if (endpoint.start)
+        {
+            for (int other : active)
+            {
+                if (crossMin[body] <= crossMax[other] && crossMin[other] <= crossMax[body])
+                {
+                    candidatePairs++;
+                    resolve(fleet, other, body);
+                }
+            }
+            active.push_back(body);
+        }
+        else
+        {
+            auto it = std::find(active.begin(), active.end(), body);
+            *it = active.back();
+            active.pop_back();
+        }
+    }
+}
+
+void Collision::resolve(Fleet &fleet, int a, int b)
+{
+    // Separating axes, forward and right of both boxes
+    glm::vec2 axes[4] = {glm::vec2(forwardX[a], forwardY[a]), glm::vec2(forwardY[a], -forwardX[a]),
+                         glm::vec2(forwardX[b], forwardY[b]), glm::vec2(forwardY[b], -forwardX[b])};
+    glm::vec2 offset = glm::vec2(boxX[b] - boxX[a], boxY[b] - boxY[a]);
+
+    // Axis of least overlap is contact normal
+    float depth = INFINITY;
+    glm::vec2 normal(0.0f);
+    for (const glm::vec2 &axis : axes)
+    {
+        float reachA = halfLength[a] * std::fabs(glm::dot(axes[0], axis)) + halfWidth[a] * std::fabs(glm::dot(axes[1], axis));
+        float reachB = halfLength[b] * std::fabs(glm::dot(axes[2], axis)) + halfWidth[b] * std::fabs(glm::dot(axes[3], axis));
+        float distance = glm::dot(offset, axis);
+        float overlap = reachA + reachB - std::fabs(distance);
+
+        if (overlap <= 0.0f)
+        {
+            return;
+        }
+        if (overlap < depth)
+        {
+            depth = overlap;
+            normal = distance < 0.0f ? -axis : axis;
+        }
+    }
+
+    contacts++;
+
+    // Yachts run on their heading only, so impulse acts through heading share of normal
+    float shareA = glm::dot(axes[0], normal);
+    float shareB = glm::dot(axes[2], normal);
+    float inverseMassA = 1.0f / fleet.mass[a];
+    float inverseMassB = 1.0f / fleet.mass[b];
+
+    float closing = fleet.velocity[b] * shareB - fleet.velocity[a] * shareA;
+    float effectiveInverseMass = shareA * shareA * inverseMassA + shareB * shareB * inverseMassB;
+    if (closing < 0.0f && effectiveInverseMass > 1e-6f)
+    {
+        float impulse = -(1.0f + restitution) * closing / effectiveInverseMass;
+        fleet.velocity[a] = std::max(fleet.velocity[a] - impulse * shareA * inverseMassA, 0.0f);
+        fleet.velocity[b] = std::max(fleet.velocity[b] + impulse * shareB * inverseMassB, 0.0f);
+    }
+
+    // Push apart by overlap, lighter yacht moves more
+    float push = std::max(depth - slop, 0.0f) / (inverseMassA + inverseMassB);
+    glm::vec2 pushA = -normal * push * inverseMassA;
+    glm::vec2 pushB = normal * push * inverseMassB;
+
+    // Back from world to each yacht's placement
+    fleet.positionX[a] += fleet.originCos[a] * pushA.x + fleet.originSin[a] * pushA.y;
+    fleet.positionY[a] += -fleet.originSin[a] * pushA.x + fleet.originCos[a] * pushA.y;
+    fleet.positionX[b] += fleet.originCos[b] * pushB.x + fleet.originSin[b] * pushB.y;
+    fleet.positionY[b] += -fleet.originSin[b] * pushB.x + fleet.originCos[b] * pushB.y;
+
+    boxX[a] += pushA.x;
+    boxY[a] += pushA.y;
+    boxX[b] += pushB.x;
+    boxY[b] += pushB.y;
+}
@@ -0,0 +1,62 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class Fleet;
+class Snapshot;
+
+// Hull footprints of fleet yachts as oriented boxes in the XY plane. Box ends along the sweep
+// axis stay sorted between steps, so the broadphase is an insertion sort over an almost sorted list
+class Collision
+{
+public:
+    // Add footprint from model bounds and scene placement, returns its index, same order as fleet
+    int add(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4 &placement);
+    void clear();
+
+    // Find touching yachts, bounce them along their heading and push them apart
+    void step(Fleet &fleet);
+
+    // Order of box ends to snapshot, and back, sweeps after a restore find pairs in the same order
+    void save(Snapshot &snapshot) const;
+    bool restore(Snapshot &snapshot);
+
+    // Share of closing speed kept after contact, and overlap left alone
+    float restitution = 0.2f;
+    float slop = 0.01f;
+
+    // Stats of last step
+    int candidatePairs = 0;
+    int contacts = 0;
+
+private:
+    // Footprint centre and half size in model space, X is across and Y along the hull
+    std::vector<float> centerX, centerY, halfWidth, halfLength;
+
+    // World box per yacht this step, centre, forward axis and bounds
+    std::vector<float> boxX, boxY, forwardX, forwardY;
+    std::vector<float> minX, maxX, minY, maxY;
+
+    // Sweep along X (0) or Y (1), whichever the fleet is spread out more along, picked when yachts are added
+    int sweepAxis = 0;
+    bool pickAxis = true;
+
+    // Box ends along sweep axis, start or end of a yacht
+    struct Endpoint
+    {
+        float value;
+        int body;
+        bool start;
+    };
+    std::vector<Endpoint> endpoints;
+
+    // Yachts whose start was passed in sweep but not their end
+    std::vector<int> active;
+
+    void resolve(Fleet &fleet, int a, int b);
+};
+
+#endif
@@ -1,11 +1,15 @@
 #include "event_handler/event_handler.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <camera/camera.h>
 #include <render/render.h>
 
+#include "input_recorder/input_recorder.h"
 #include "physics/physics.h"
 #include "scene_manager/scene_manager.h"
+#include "skinning/skinning.h"
 
 // Global screen variables
 int EventHandler::xPos, EventHandler::yPos, EventHandler::screenWidth, EventHandler::screenHeight;
@@ -27,10 +31,16 @@ glm::vec3 EventHandler::lightPos(1000.f, -1000.f, 2000.f);
 glm::vec3 EventHandler::lightCol(1, 1, 1);
 float EventHandler::lightInsensity = 2;
 
+// Queued callback events, and keys for simulation in SimulationKey order
+InputQueue EventHandler::events;
+const std::vector<int> EventHandler::simulationKeys = {GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_P,
+                                                       GLFW_KEY_R, GLFW_KEY_B, GLFW_KEY_N};
+
 // Generic EventHandler updates
 void EventHandler::update(GLFWwindow *window)
 {
     time = (float)glfwGetTime();
+    InputRecorder::frame(window, time);
     deltaTime = time - lastTime;
     lastTime = time;
     frame++;
@@ -40,25 +50,94 @@ void EventHandler::update(GLFWwindow *window)
 }
 
 void EventHandler::keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    // Record, or ignore keys while a replay plays
+    if (!InputRecorder::key(key, scancode, action, mods))
+    {
+        return;
+    }
+
+    TimedInput input;
+    input.time = std::chrono::steady_clock::now();
+    input.key = key;
+    input.pressed = action != GLFW_RELEASE;
+    input.repeat = action == GLFW_REPEAT;
+    events.push(input);
+
+    // Simulation keys to simulation thread, off title screen. Releases always go so no key stays held
+    auto simulationKey = std::find(simulationKeys.begin(), simulationKeys.end(), key);
+    if (simulationKey != simulationKeys.end() && (!SceneManager::onTitleScreen || !input.pressed))
+    {
+        input.key = simulationKey - simulationKeys.begin();
+        Physics::inputs.push(input);
+    }
+}
+
+void EventHandler::mouseCallback(GLFWwindow *window, double xPos, double yPos)
+{
+    // Record, or ignore mouse while a replay plays
+    if (!InputRecorder::mouse(xPos, yPos))
+    {
+        return;
+    }
+
+    TimedInput input;
+    input.time = std::chrono::steady_clock::now();
+    input.type = timedMouse;
+    input.x = xPos;
+    input.y = yPos;
+    events.push(input);
+}
+
+void EventHandler::handleEvents(GLFWwindow *window)
+{
+    // Cursor positions count from where it was last put back, so only the newest one matters
+    bool mouseMoved = false;
+    double mouseX = 0.0, mouseY = 0.0;
+
+    TimedInput input;
+    while (events.peek(input))
+    {
+        events.pop();
+
+        if (input.type == timedMouse)
+        {
+            mouseMoved = true;
+            mouseX = input.x;
+            mouseY = input.y;
+        }
+        else if (input.type == timedKey && input.pressed && !input.repeat)
+        {
+            handleKey(window, input.key);
+        }
+    }
+
+    if (mouseMoved)
+    {
+        handleMouse(window, mouseX, mouseY);
+    }
+}
+
+void EventHandler::handleKey(GLFWwindow *window, int key)
 {
     if (SceneManager::onTitleScreen)
     {
         // Close on ESC
-        if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+        if (key == GLFW_KEY_ESCAPE)
         {
             glfwSetWindowShouldClose(window, GLFW_TRUE);
         }
 
         // Load scenes
-        if (key == GLFW_KEY_1 && action == GLFW_PRESS)
+        if (key == GLFW_KEY_1)
         {
             SceneManager::loadAsync("realistic");
         }
-        if (key == GLFW_KEY_2 && action == GLFW_PRESS)
+        if (key == GLFW_KEY_2)
         {
             SceneManager::loadAsync("cartoon");
         }
-        if (key == GLFW_KEY_T && action == GLFW_PRESS)
+        if (key == GLFW_KEY_T)
         {
             SceneManager::loadAsync("test");
         }
@@ -66,13 +145,13 @@ void EventHandler::keyCallback(GLFWwindow *window, int key, int scancode, int ac
     else
     {
         // Back to title on ESC
-        if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+        if (key == GLFW_KEY_ESCAPE)
         {
-            SceneManager::load("title");
+            SceneManager::loadAsync("title");
         }
 
         // Toggle render debug on F9
-        if (key == GLFW_KEY_F9 && action == GLFW_PRESS)
+        if (key == GLFW_KEY_F9)
         {
             Render::debugPhysics = false;
 
@@ -87,7 +166,7 @@ void EventHandler::keyCallback(GLFWwindow *window, int key, int scancode, int ac
         }
 
         // Toggle physics debug on F10
-        if (key == GLFW_KEY_F10 && action == GLFW_PRESS)
+        if (key == GLFW_KEY_F10)
         {
             Render::debugRender = false;
 
@@ -101,8 +180,38 @@ void EventHandler::keyCallback(GLFWwindow *window, int key, int scancode, int ac
             }
         }
 
+        // Cycle occlusion culling (off, GPU queries, CPU raster) on O
+        if (key == GLFW_KEY_O)
+        {
+            Render::occlusionMode = static_cast<OcclusionMode>((Render::occlusionMode + 1) % 3);
+        }
+
+        // Toggle reuse of skinned buffers on K
+        if (key == GLFW_KEY_K)
+        {
+            Skinning::reuse = !Skinning::reuse;
+        }
+
+        // Toggle sail cloth simulation on L
+        if (key == GLFW_KEY_L)
+        {
+            SailCloth::enabled = !SailCloth::enabled;
+        }
+
+        // Toggle fleet and polar validation in physics debug on V
+        if (key == GLFW_KEY_V)
+        {
+            Physics::validateFleet = !Physics::validateFleet;
+        }
+
+        // Toggle telemetry recording on F8
+        if (key == GLFW_KEY_F8)
+        {
+            Physics::recordTelemetry = !Physics::recordTelemetry;
+        }
+
         // Toggle Freecam on C
-        if (key == GLFW_KEY_C && action == GLFW_PRESS)
+        if (key == GLFW_KEY_C)
         {
             if (Camera::freeCam)
             {
@@ -113,22 +222,10 @@ void EventHandler::keyCallback(GLFWwindow *window, int key, int scancode, int ac
                 Camera::freeCam = true;
             }
         }
-
-        // Reset physics on R
-        if (key == GLFW_KEY_R && action == GLFW_PRESS)
-        {
-            Physics::resetState = true;
-        }
-
-        // Switch to next controllable yacht on N
-        if (key == GLFW_KEY_N && action == GLFW_PRESS)
-        {
-            Physics::switchControlledYacht(*SceneManager::currentScene);
-        }
     }
 
     // Toggle fullscreen on F11
-    if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+    if (key == GLFW_KEY_F11)
     {
         if (fullscreen)
         {
@@ -158,7 +255,7 @@ void EventHandler::keyCallback(GLFWwindow *window, int key, int scancode, int ac
     }
 }
 
-void EventHandler::mouseCallback(GLFWwindow *window, double xPos, double yPos)
+void EventHandler::handleMouse(GLFWwindow *window, double xPos, double yPos)
 {
     // Check if window size changed last iteration
     if (firstFrame || windowSizeChanged)
@@ -231,64 +328,36 @@ void EventHandler::processInput(GLFWwindow *window)
         forwardXY = glm::normalize(forwardXY);
 
         // Apply camera movement per button pressed
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS && Camera::freeCam)
+        if (InputRecorder::keyHeld(window, GLFW_KEY_W) && Camera::freeCam)
         {
             Camera::cameraPositionFree += cameraSpeed * forwardXY;
             Camera::cameraMoved = true;
         }
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS && Camera::freeCam)
+        if (InputRecorder::keyHeld(window, GLFW_KEY_S) && Camera::freeCam)
         {
             Camera::cameraPositionFree -= cameraSpeed * forwardXY;
             Camera::cameraMoved = true;
         }
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS && Camera::freeCam)
+        if (InputRecorder::keyHeld(window, GLFW_KEY_A) && Camera::freeCam)
         {
             Camera::cameraPositionFree -= glm::normalize(glm::cross(forwardXY, Camera::worldUp)) * cameraSpeed;
             Camera::cameraMoved = true;
         }
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS && Camera::freeCam)
+        if (InputRecorder::keyHeld(window, GLFW_KEY_D) && Camera::freeCam)
         {
             Camera::cameraPositionFree += glm::normalize(glm::cross(forwardXY, Camera::worldUp)) * cameraSpeed;
             Camera::cameraMoved = true;
         }
-        if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS && Camera::freeCam)
+        if (InputRecorder::keyHeld(window, GLFW_KEY_SPACE) && Camera::freeCam)
         {
             Camera::cameraPositionFree += cameraSpeed * Camera::worldUp;
             Camera::cameraMoved = true;
         }
-        if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS && Camera::freeCam)
+        if (InputRecorder::keyHeld(window, GLFW_KEY_LEFT_SHIFT) && Camera::freeCam)
         {
             Camera::cameraPositionFree -= cameraSpeed * Camera::worldUp;
             Camera::cameraMoved = true;
         }
-
-        // Physics Keys
-        // Set all keyspresses to false
-        for (auto &key : Physics::keyInputs)
-        {
-            key = false;
-        }
-
-        if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
-        {
-            Physics::keyInputs[0] = true;
-        }
-        if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
-        {
-            Physics::keyInputs[1] = true;
-        }
-        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
-        {
-            Physics::keyInputs[2] = true;
-        }
-        if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
-        {
-            Physics::keyInputs[3] = true;
-        }
-        if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
-        {
-            Physics::keyInputs[4] = true;
-        }
     }
 }
 
@@ -8,6 +8,10 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include <vector>
+
+#include "input_queue/input_queue.h"
+
 class EventHandler
 {
 public:
@@ -30,13 +34,22 @@ public:
     static glm::vec3 lightCol;
     static float lightInsensity;
 
-    // Global input/callback Functions
+    // Key and mouse events of callbacks, and keys that go to simulation instead
+    static InputQueue events;
+    static const std::vector<int> simulationKeys;
+
+    // Global input/callback Functions, key and mouse callbacks only queue events
     static void update(GLFWwindow *window);
     static void errorCallback(int error, const char *description);
     static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
     static void mouseCallback(GLFWwindow *window, double xPos, double yPos);
     static void processInput(GLFWwindow *window);
     static void framebufferSizeCallback(GLFWwindow *window, int width, int height);
+
+    // Queued events, once per loop after events are polled
+    static void handleEvents(GLFWwindow *window);
+    static void handleKey(GLFWwindow *window, int key);
+    static void handleMouse(GLFWwindow *window, double xPos, double yPos);
 };
 
 #endif
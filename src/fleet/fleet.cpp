@@ -0,0 +1,412 @@
+#include "fleet/fleet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "lanes/lanes.h"
+#include "physics/physics.h"
+#include "snapshot/snapshot.h"
+
+// Kernel is written once for lane types, instantiated for SIMD and scalar
+using namespace lanes;
+
+namespace
+{
+    // Bilinear interpolation in polar table, cell is index of lower corner
+    template <typename L>
+    L bilinear(const float *table, L cell, L fu, L fv)
+    {
+        L c00 = gather(table, cell), c01 = gather(table, cell + 1.0f);
+        L c10 = gather(table, cell + (float)Polar::sailCount), c11 = gather(table, cell + (float)(Polar::sailCount + 1));
+        L c0 = c00 + (c01 - c00) * fv;
+        L c1 = c10 + (c11 - c10) * fv;
+        return c0 + (c1 - c0) * fu;
+    }
+
+    // Same steps as Physics::move, for L::width yachts starting at index i. Each yacht steps over its own
+    // stepTime, lanes with none keep their state. Heading and position are left to advanceLanes
+    template <typename L>
+    void stepLanes(Fleet &f, int i)
+    {
+        // Time covered by step, and share of sail smoothing over it
+        L dt = L::load(&f.stepTime[i]);
+        L smoothing = L::load(&f.stepSmoothing[i]);
+        typename L::Mask due = dt > 0.0f;
+
+        // Inputs
+        L windX = L::load(&f.windX[i]), windY = L::load(&f.windY[i]);
+        L sheetIn = L::load(&f.sheetIn[i]), sheetOut = L::load(&f.sheetOut[i]);
+        L steer = L::load(&f.steer[i]), push = L::load(&f.push[i]);
+
+        // State
+        L headingX = L::load(&f.headingX[i]), headingY = L::load(&f.headingY[i]);
+        L oldVelocity = L::load(&f.velocity[i]), velocity = oldVelocity;
+        L oldSteeringAngle = L::load(&f.steeringAngle[i]), steeringAngle = oldSteeringAngle;
+        L oldMastAngle = L::load(&f.mastAngle[i]), mastAngle = oldMastAngle;
+        L oldBoomAngle = L::load(&f.boomAngle[i]), boomAngle = oldBoomAngle;
+        L oldSailControl = L::load(&f.sailControl[i]), sailControl = oldSailControl;
+
+        // Properties
+        L steeringSmoothness = L::load(&f.steeringSmoothness[i]);
+        L maxSteeringAngle = L::load(&f.maxSteeringAngle[i]);
+        L maxMastAngle = L::load(&f.maxMastAngle[i]), maxBoomAngle = L::load(&f.maxBoomAngle[i]);
+        L optimalAngle = L::load(&f.optimalAngle[i]);
+        L mass = L::load(&f.mass[i]);
+
+        // Sail control and steering from inputs
+        sailControl = clamp(sailControl + (sheetIn * 1.0f - sheetOut * 0.4f) * dt, L(0.2f), L(1.0f));
+        L steeringChange = steer * steeringSmoothness * maxSteeringAngle;
+
+        // Angle of heading to wind, half angle sine from its cosine
+        L windCross = -(headingX * windY - headingY * windX);
+        L windDot = -(headingX * windX + headingY * windY);
+        L angleToWind = arcTangent2(windCross, windDot);
+        L windCos = windDot / max(sqrt(windX * windX + windY * windY), L(1e-30f));
+        L halfSine = sqrt(max((L(1.0f) - windCos) * 0.5f, L(0.0f)));
+
+        // Sail setup follows wind
+        L targetMastAngle = (sailControl + 0.5f) / 1.5f * clamp(angleToWind, -maxMastAngle, maxMastAngle);
+        L targetBoomAngle = sailControl * clamp(angleToWind, -maxBoomAngle, maxBoomAngle);
+        mastAngle = mastAngle + (targetMastAngle - mastAngle) * smoothing;
+        boomAngle = boomAngle + (targetBoomAngle - boomAngle) * smoothing;
+        L sailAngle = boomAngle * (L(1.0f) + halfSine * 0.1f);
+
+        // Apparent wind, angle straight from components
+        L apparentX = windX - headingX * velocity;
+        L apparentY = windY - headingY * velocity;
+        L apparentSpeed = sqrt(apparentX * apparentX + apparentY * apparentY);
+        L apparentCross = -(headingX * apparentY - headingY * apparentX);
+        L apparentDot = -(headingX * apparentX + headingY * apparentY);
+        L angleToApparentWind = arcTangent2(apparentCross, apparentDot);
+
+        // Lift and drag, from polar table or analytic
+        L relativeSailAngle = angleToApparentWind - sailAngle;
+        L sailArea = L::load(&f.sailArea[i]);
+        L dynamicPressure = apparentSpeed * apparentSpeed * (0.5f * Physics::airDensity);
+        L effectiveCL, effectiveCD, sailForce;
+
+        if (f.usePolars)
+        {
+            // Grid coordinates, sail axis is relative to apparent wind
+            L u = clamp((angleToApparentWind + pi) * ((Polar::angleCount - 1) / (2.0f * pi)), L(0.0f), L(Polar::angleCount - 1.0f));
+            L v = clamp(relativeSailAngle * L::load(&f.polarScale[i]) + (float)((Polar::sailCount - 1) / 2), L(0.0f), L(Polar::sailCount - 1.0f));
+            L row = clamp(round(u - 0.5f), L(0.0f), L(Polar::angleCount - 2.0f));
+            L column = clamp(round(v - 0.5f), L(0.0f), L(Polar::sailCount - 2.0f));
+            L cell = L::load(&f.polarOffset[i]) + row * (float)Polar::sailCount + column;
+
+            const float *table = f.polarData.data();
+            effectiveCL = bilinear(table, cell, u - row, v - column);
+            effectiveCD = bilinear(table + Polar::cellCount, cell, u - row, v - column);
+            sailForce = dynamicPressure * sailArea * bilinear(table + 2 * Polar::cellCount, cell, u - row, v - column);
+        }
+        else
+        {
+            L inverseSpeed = L(1.0f) / max(apparentSpeed, L(1e-30f));
+            L apparentSine = apparentCross * inverseSpeed;
+            L apparentCosine = apparentDot * inverseSpeed;
+
+            L absAngle = abs(relativeSailAngle);
+            L sign = select(relativeSailAngle < 0.0f, L(-1.0f), L(1.0f));
+            L innerLift = L::load(&f.liftSlope[i]) * relativeSailAngle * sine(absAngle * 2.0f);
+            L outerLift = L::load(&f.maxLiftCoefficient[i]) * (optimalAngle / max(absAngle, L(1e-30f))) * sign;
+            effectiveCL = select(absAngle <= optimalAngle, innerLift, outerLift);
+            L absSine = sine(absAngle);
+            effectiveCD = L::load(&f.minDragCoefficient[i]) + absSine * absSine;
+
+            sailForce = dynamicPressure * sailArea * (effectiveCL * apparentSine - effectiveCD * apparentCosine);
+        }
+
+        // Body drag
+        L bodyDragForce = L::load(&f.bodyDragArea[i]) * velocity * velocity * (0.5f * Physics::airDensity);
+
+        // Rolling resistance
+        L rollScaling = L::load(&f.rollScaling[i]);
+        L effectiveCr = L::load(&f.rollCoefficient[i]) * (L(1.0f) + (velocity * velocity) / (rollScaling * rollScaling));
+        L rollResistance = effectiveCr * mass * Physics::g;
+
+        // Stationary yachts need propulsion over roll resistance to get going
+        L propulsion = sailForce - bodyDragForce;
+        typename L::Mask stuck = (velocity < 0.02f) & (propulsion < rollResistance);
+        L netForce = select(stuck, L(0.0f), propulsion - rollResistance);
+        velocity = select(stuck, velocity * 0.75f, velocity);
+
+        L forwardAcceleration = push + netForce / mass;
+
+        // Apply accelerations
+        velocity = velocity + forwardAcceleration * dt;
+        steeringAngle = steeringAngle + (steeringChange - steeringAngle * steeringSmoothness) * dt;
+        L effectiveSteeringAngle = steeringAngle / (L(1.0f) + L::load(&f.steeringAttenuation[i]) * velocity);
+
+        // Clockwise turn in radians per second, held until next step
+        L turnRate = effectiveSteeringAngle * velocity * (pi / 180.0f);
+
+        // Store state of yachts that stepped
+        select(due, velocity, oldVelocity).store(&f.velocity[i]);
+        select(due, steeringAngle, oldSteeringAngle).store(&f.steeringAngle[i]);
+        select(due, mastAngle, oldMastAngle).store(&f.mastAngle[i]);
+        select(due, boomAngle, oldBoomAngle).store(&f.boomAngle[i]);
+        select(due, sailAngle, L::load(&f.sailAngle[i])).store(&f.sailAngle[i]);
+        select(due, sailControl, oldSailControl).store(&f.sailControl[i]);
+        select(due, turnRate, L::load(&f.turnRate[i])).store(&f.turnRate[i]);
+
+        // Store values for debug
+        select(due, forwardAcceleration, L::load(&f.acceleration[i])).store(&f.acceleration[i]);
+        select(due, apparentSpeed, L::load(&f.apparentWindSpeed[i])).store(&f.apparentWindSpeed[i]);
+        select(due, angleToWind, L::load(&f.angleToWind[i])).store(&f.angleToWind[i]);
+        select(due, angleToApparentWind, L::load(&f.angleToApparentWind[i])).store(&f.angleToApparentWind[i]);
+        select(due, effectiveSteeringAngle, L::load(&f.effectiveSteeringAngle[i])).store(&f.effectiveSteeringAngle[i]);
+        select(due, effectiveCL, L::load(&f.liftCoefficient[i])).store(&f.liftCoefficient[i]);
+        select(due, effectiveCD, L::load(&f.dragCoefficient[i])).store(&f.dragCoefficient[i]);
+    }
+
+    // Turn heading clockwise at turn rate, then move forward, every yacht every tick
+    template <typename L>
+    void advanceLanes(Fleet &f, int i, float dt)
+    {
+        L headingX = L::load(&f.headingX[i]), headingY = L::load(&f.headingY[i]);
+        L velocity = L::load(&f.velocity[i]);
+
+        L turn = L::load(&f.turnRate[i]) * dt;
+        L turnSine = sine(turn), turnCosine = sine(turn + 0.5f * pi);
+        L newHeadingX = headingX * turnCosine + headingY * turnSine;
+        L newHeadingY = headingY * turnCosine - headingX * turnSine;
+
+        // Keep heading unit length
+        L lengthCorrection = (L(3.0f) - (newHeadingX * newHeadingX + newHeadingY * newHeadingY)) * 0.5f;
+        headingX = newHeadingX * lengthCorrection;
+        headingY = newHeadingY * lengthCorrection;
+
+        (L::load(&f.positionX[i]) + headingX * velocity * dt).store(&f.positionX[i]);
+        (L::load(&f.positionY[i]) + headingY * velocity * dt).store(&f.positionY[i]);
+        (L::load(&f.wheelAngle[i]) + velocity * (dt * 100.0f)).store(&f.wheelAngle[i]);
+        headingX.store(&f.headingX[i]);
+        headingY.store(&f.headingY[i]);
+    }
+}
+
+std::vector<std::vector<float> *> Fleet::arrays()
+{
+    return {&sheetIn, &sheetOut, &steer, &push, &originX, &originY, &originZ, &originCos, &originSin, &worldX, &worldY, &windX, &windY,
+            &positionX, &positionY, &headingX, &headingY, &velocity, &steeringAngle, &wheelAngle,
+            &mastAngle, &boomAngle, &sailAngle, &sailControl, &turnRate, &groundHeight, &groundPitch, &groundRoll,
+            &stepInterval, &ticksSinceStep, &stepTime, &stepSmoothing,
+            &maxMastAngle, &maxBoomAngle, &maxLiftCoefficient, &optimalAngle, &liftSlope, &minDragCoefficient, &sailArea,
+            &rollCoefficient, &rollScaling, &mass, &bodyDragArea, &steeringSmoothness, &maxSteeringAngle, &steeringAttenuation, &polarOffset, &polarScale,
+            &acceleration, &apparentWindSpeed, &angleToWind, &angleToApparentWind, &effectiveSteeringAngle, &liftCoefficient, &dragCoefficient};
+}
+
+void Fleet::save(Snapshot &snapshot) const
+{
+    snapshot.write(count);
+    for (std::vector<float> *array : const_cast<Fleet *>(this)->arrays())
+    {
+        snapshot.write(*array);
+    }
+}
+
+bool Fleet::restore(Snapshot &snapshot)
+{
+    int savedCount;
+    if (!snapshot.read(savedCount) || savedCount != count)
+    {
+        return false;
+    }
+    for (std::vector<float> *array : arrays())
+    {
+        if (!snapshot.read(*array))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Fleet::clear()
+{
+    for (std::vector<float> *array : arrays())
+    {
+        array->clear();
+    }
+    polars.clear();
+    polarData.clear();
+    count = 0;
+}
+
+int Fleet::add(const Physics &physics, const glm::mat4 &placement)
+{
+    int index = count++;
+    for (std::vector<float> *array : arrays())
+    {
+        array->resize(count, 0.0f);
+    }
+
+    // Placement is rotation around Z and translation, scale is up to each user of it
+    float scaleX = glm::length(glm::vec3(placement[0]));
+    originX[index] = placement[3][0];
+    originY[index] = placement[3][1];
+    originZ[index] = placement[3][2];
+    originCos[index] = placement[0][0] / scaleX;
+    originSin[index] = placement[0][1] / scaleX;
+
+    // Properties
+    maxMastAngle[index] = physics.maxMastAngle;
+    maxBoomAngle[index] = physics.maxBoomAngle;
+    maxLiftCoefficient[index] = physics.maxLiftCoefficient;
+    optimalAngle[index] = physics.optimalAngle;
+    liftSlope[index] = physics.maxLiftCoefficient / (physics.optimalAngle * std::sin(2.0f * physics.optimalAngle));
+    minDragCoefficient[index] = physics.minDragCoefficient;
+    sailArea[index] = physics.sailArea;
+    rollCoefficient[index] = physics.rollCoefficient;
+    rollScaling[index] = physics.rollScaling;
+    mass[index] = physics.mass;
+    bodyDragArea[index] = physics.bodyDragCoefficient * physics.bodyArea;
+    steeringSmoothness[index] = physics.steeringSmoothness;
+    maxSteeringAngle[index] = physics.maxSteeringAngle;
+    steeringAttenuation[index] = physics.steeringAttenuation;
+
+    // Full step every tick until told otherwise
+    stepInterval[index] = 1.0f;
+
+    // Tables of yacht type, added once per polar
+    int polarIndex = std::find(polars.begin(), polars.end(), physics.polar) - polars.begin();
+    if (polarIndex == polars.size())
+    {
+        polars.push_back(physics.polar);
+        polarData.insert(polarData.end(), physics.polar->data.begin(), physics.polar->data.end());
+    }
+    polarOffset[index] = (float)(polarIndex * 3 * Polar::cellCount);
+    polarScale[index] = 1.0f / physics.polar->sailStep;
+
+    load(index, physics);
+
+    return index;
+}
+
+void Fleet::load(int index, const Physics &physics)
+{
+    // Position and forward direction from transform
+    positionX[index] = physics.baseTransform[3][0];
+    positionY[index] = physics.baseTransform[3][1];
+    glm::vec2 heading = glm::normalize(glm::vec2(physics.baseTransform[1][0], physics.baseTransform[1][1]));
+    headingX[index] = heading.x;
+    headingY[index] = heading.y;
+
+    velocity[index] = physics.forwardVelocity;
+    steeringAngle[index] = physics.steeringAngle;
+    wheelAngle[index] = physics.wheelAngle;
+    mastAngle[index] = physics.MastAngle;
+    boomAngle[index] = physics.BoomAngle;
+    sailAngle[index] = physics.SailAngle;
+    sailControl[index] = physics.sailControlFactor;
+
+    // Turn rate comes from next full step, due right away
+    turnRate[index] = 0.0f;
+    ticksSinceStep[index] = stepInterval[index] - 1.0f;
+}
+
+void Fleet::store(int index, Physics &physics, bool onGround) const
+{
+    // Rotation around Z with forward along local Y, then position
+    float x = headingX[index], y = headingY[index];
+    physics.baseTransform = glm::mat4(glm::vec4(y, -x, 0.0f, 0.0f),
+                                      glm::vec4(x, y, 0.0f, 0.0f),
+                                      glm::vec4(0.0f, 0.0f, 1.0f, 0.0f),
+                                      glm::vec4(positionX[index], positionY[index], 0.0f, 1.0f));
+
+    // Pitch around right axis, then roll around forward axis, body stays level for comparing with move()
+    if (onGround)
+    {
+        float cp = std::cos(groundPitch[index]), sp = std::sin(groundPitch[index]);
+        float cr = std::cos(groundRoll[index]), sr = std::sin(groundRoll[index]);
+        glm::mat4 tilt = glm::mat4(glm::vec4(cr, -sp * sr, cp * sr, 0.0f),
+                                   glm::vec4(0.0f, cp, sp, 0.0f),
+                                   glm::vec4(-sr, -sp * cr, cp * cr, 0.0f),
+                                   glm::vec4(0.0f, 0.0f, groundHeight[index], 1.0f));
+        physics.baseTransform = physics.baseTransform * tilt;
+    }
+
+    physics.forwardVelocity = velocity[index];
+    physics.steeringAngle = steeringAngle[index];
+    physics.wheelAngle = wheelAngle[index];
+    physics.MastAngle = mastAngle[index];
+    physics.BoomAngle = boomAngle[index];
+    physics.SailAngle = sailAngle[index];
+    physics.sailControlFactor = sailControl[index];
+}
+
+void Fleet::placeInWorld()
+{
+    for (int i = 0; i < count; i++)
+    {
+        worldX[i] = originX[i] + originCos[i] * positionX[i] - originSin[i] * positionY[i];
+        worldY[i] = originY[i] + originSin[i] * positionX[i] + originCos[i] * positionY[i];
+    }
+}
+
+void Fleet::windToPlacement()
+{
+    // Inverse of placement rotation
+    for (int i = 0; i < count; i++)
+    {
+        float x = windX[i], y = windY[i];
+        windX[i] = originCos[i] * x + originSin[i] * y;
+        windY[i] = -originSin[i] * x + originCos[i] * y;
+    }
+}
+
+void Fleet::step(float deltaTime)
+{
+    // Yachts due for a full step take all ticks since their last one at once
+    for (int i = 0; i < count; i++)
+    {
+        ticksSinceStep[i] += 1.0f;
+        if (ticksSinceStep[i] >= stepInterval[i])
+        {
+            stepTime[i] = ticksSinceStep[i] * deltaTime;
+            stepSmoothing[i] = 1.0f - std::pow(0.95f, ticksSinceStep[i]);
+            ticksSinceStep[i] = 0.0f;
+        }
+        else
+        {
+            stepTime[i] = 0.0f;
+        }
+    }
+
+    int i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // Full SIMD batches, skipped when none of their yachts is due
+    for (; i + SimdLanes::width <= count; i += SimdLanes::width)
+    {
+        if (std::any_of(&stepTime[i], &stepTime[i] + SimdLanes::width, [](float time)
+                        { return time > 0.0f; }))
+        {
+            stepLanes<SimdLanes>(*this, i);
+        }
+    }
+#endif
+
+    // Remaining yachts
+    for (; i < count; i++)
+    {
+        if (stepTime[i] > 0.0f)
+        {
+            stepLanes<ScalarLanes>(*this, i);
+        }
+    }
+
+    // Every yacht moves on its last turn rate and velocity
+    i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; i + SimdLanes::width <= count; i += SimdLanes::width)
+    {
+        advanceLanes<SimdLanes>(*this, i, deltaTime);
+    }
+#endif
+
+    for (; i < count; i++)
+    {
+        advanceLanes<ScalarLanes>(*this, i, deltaTime);
+    }
+}
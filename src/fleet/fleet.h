@@ -0,0 +1,99 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "polar/polar.h"
+
+class Physics;
+class Snapshot;
+
+// State and parameters of every yacht in a scene as structure of arrays, stepped together
+class Fleet
+{
+public:
+    // Add yacht with properties and state of physics object at scene placement, returns its index
+    int add(const Physics &physics, const glm::mat4 &placement);
+    void clear();
+    int size() const { return count; }
+
+    // Copy state between fleet and physics object
+    void load(int index, const Physics &physics);
+    void store(int index, Physics &physics, bool onGround = true) const;
+
+    // All arrays to snapshot, and back from one of a fleet of the same size
+    void save(Snapshot &snapshot) const;
+    bool restore(Snapshot &snapshot);
+
+    // Advance all yachts by one tick of deltaTime in their local wind. Yachts take a full step every
+    // stepInterval ticks over the whole time since their last one, and keep turn rate and velocity in between
+    void step(float deltaTime);
+
+    // Inputs per yacht, sheet in/out and push [0, 1], steer [-1, 1] positive to the left
+    std::vector<float> sheetIn, sheetOut, steer, push;
+
+    // Position of each yacht in world from its placement, for sampling world fields
+    void placeInWorld();
+
+    // Rotate wind sampled in world axes into placement axes of each yacht
+    void windToPlacement();
+
+    // Scene placement per yacht as rotation around Z and translation, position and heading are relative to it
+    std::vector<float> originX, originY, originZ, originCos, originSin;
+
+    // Position in world, set by placeInWorld
+    std::vector<float> worldX, worldY;
+
+    // Wind vector at each yacht in placement axes, sampled from wind field before step
+    std::vector<float> windX, windY;
+
+    // State per yacht, heading is unit forward vector in the XY plane
+    std::vector<float> positionX, positionY;
+    std::vector<float> headingX, headingY;
+    std::vector<float> velocity;
+    std::vector<float> steeringAngle, wheelAngle;
+    std::vector<float> mastAngle, boomAngle, sailAngle, sailControl;
+    std::vector<float> turnRate;
+
+    // Body height above placement and tilt from terrain, set by Ground after step, radians with nose up and right side up positive
+    std::vector<float> groundHeight, groundPitch, groundRoll;
+
+    // Properties per yacht
+    std::vector<float> maxMastAngle, maxBoomAngle;
+    std::vector<float> maxLiftCoefficient, optimalAngle, liftSlope, minDragCoefficient, sailArea;
+    std::vector<float> rollCoefficient, rollScaling, mass, bodyDragArea;
+    std::vector<float> steeringSmoothness, maxSteeringAngle, steeringAttenuation;
+
+    // Ticks between full steps per yacht, set by simulation LOD, 1 steps every tick
+    std::vector<float> stepInterval;
+
+    // Ticks since last full step, and time and sail smoothing of this tick's step, 0 time if not due
+    std::vector<float> ticksSinceStep, stepTime, stepSmoothing;
+
+    // Start of polar tables in polarData and inverse of its sail step, per yacht
+    std::vector<float> polarOffset, polarScale;
+
+    // Tables of all polars in fleet, shared by yachts of the same type
+    std::vector<float> polarData;
+
+    // Look sail coefficients up in polars, analytic otherwise
+    bool usePolars = true;
+
+    // Values of last step, for debug overlay
+    std::vector<float> acceleration, apparentWindSpeed, angleToWind, angleToApparentWind;
+    std::vector<float> effectiveSteeringAngle, liftCoefficient, dragCoefficient;
+
+private:
+    int count = 0;
+
+    // Polars with tables in polarData, in order
+    std::vector<std::shared_ptr<const Polar>> polars;
+
+    // All arrays, for resizing together
+    std::vector<std::vector<float> *> arrays();
+};
+
+#endif
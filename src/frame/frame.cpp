@@ -0,0 +1,58 @@
+#include "frame/frame.h"
+
+#include <algorithm>
+
+#include <glm/gtc/quaternion.hpp>
+
+float Frame::blendFactor(std::chrono::steady_clock::time_point now) const
+{
+    if (stepTime <= 0.0f)
+    {
+        return 1.0f;
+    }
+
+    float elapsed = std::chrono::duration<float>(now - time).count();
+    return std::clamp(elapsed / stepTime, 0.0f, 1.0f);
+}
+
+glm::mat4 interpolateTransform(const glm::mat4 &a, const glm::mat4 &b, float t)
+{
+    // Split into scale, rotation and translation
+    glm::vec3 scaleA(glm::length(glm::vec3(a[0])), glm::length(glm::vec3(a[1])), glm::length(glm::vec3(a[2])));
+    glm::vec3 scaleB(glm::length(glm::vec3(b[0])), glm::length(glm::vec3(b[1])), glm::length(glm::vec3(b[2])));
+
+    glm::quat rotationA = glm::quat_cast(glm::mat3(glm::vec3(a[0]) / scaleA.x, glm::vec3(a[1]) / scaleA.y, glm::vec3(a[2]) / scaleA.z));
+    glm::quat rotationB = glm::quat_cast(glm::mat3(glm::vec3(b[0]) / scaleB.x, glm::vec3(b[1]) / scaleB.y, glm::vec3(b[2]) / scaleB.z));
+
+    // Blend parts separately
+    glm::mat4 result = glm::mat4_cast(glm::slerp(rotationA, rotationB, t));
+    glm::vec3 scale = glm::mix(scaleA, scaleB, t);
+    result[0] *= scale.x;
+    result[1] *= scale.y;
+    result[2] *= scale.z;
+    result[3] = glm::mix(a[3], b[3], t);
+
+    return result;
+}
+
+Frame &FrameMailbox::back()
+{
+    return frames[backIndex];
+}
+
+void FrameMailbox::publish()
+{
+    // Swap finished frame into middle, continue writing in the one left there
+    backIndex = readyIndex.exchange(backIndex | freshBit, std::memory_order_acq_rel) & ~freshBit;
+}
+
+const Frame &FrameMailbox::acquire()
+{
+    // Only swap if simulation published since last time, otherwise keep current frame
+    if (readyIndex.load(std::memory_order_relaxed) & freshBit)
+    {
+        frontIndex = readyIndex.exchange(frontIndex, std::memory_order_acq_rel) & ~freshBit;
+    }
+
+    return frames[frontIndex];
+}
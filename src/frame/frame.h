@@ -0,0 +1,127 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+// Values for physics debug overlay from one simulation step, only filled while overlay is shown
+struct PhysicsDebug
+{
+    // Controlled yacht, angles in degrees
+    bool controlled = false;
+    float velocity = 0.0f;
+    float acceleration = 0.0f;
+    float apparentWind = 0.0f;
+    float steeringAngle = 0.0f;
+    float effectiveSteeringAngle = 0.0f;
+    float angleToWind = 0.0f;
+    float angleToApparentWind = 0.0f;
+    float relativeAngle = 0.0f;
+    float effectiveCL = 0.0f;
+    float effectiveCD = 0.0f;
+    float localWind = 0.0f;
+    float groundPitch = 0.0f;
+    float groundRoll = 0.0f;
+
+    // Fleet step against reference step, and polar lookups against analytic, while validating
+    bool validating = false;
+    float fleetError = 0.0f;
+    float polarLiftError = 0.0f;
+    float polarDragError = 0.0f;
+    float polarDriveError = 0.0f;
+
+    // Yachts per simulation tier, and hull contacts
+    float lodNear = 0.0f;
+    float lodMid = 0.0f;
+    float lodFar = 0.0f;
+    float contacts = 0.0f;
+
+    // Multiplayer server, while connected
+    bool connected = false;
+    float netRoundTrip = 0.0f;
+    float netBytesIn = 0.0f;
+    float netBytesOut = 0.0f;
+    float netLost = 0.0f;
+
+    // Telemetry, while recording
+    bool recording = false;
+    float telemetryDropped = 0.0f;
+
+    // Animation of step, and steps dropped by simulation thread
+    float posesUpdated = 0.0f;
+    float posesDeferred = 0.0f;
+    float sailsSimulated = 0.0f;
+    float droppedSteps = 0.0f;
+};
+
+// Scene state after one simulation step
+struct FrameState
+{
+    // Global bone transforms of all animated models, sliced as in Scene::poses
+    std::vector<glm::mat4> poses;
+
+    // Sail cloth offsets of all cloth instances, sliced as in Scene::cloth
+    std::vector<glm::vec3> cloth;
+
+    // Times each scene model was posed, so render skips slices that did not change
+    std::vector<unsigned int> poseVersions;
+
+    // Fixed camera following controlled yacht
+    bool cameraFollow = false;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    float cameraYaw = 0.0f;
+};
+
+// Everything render needs from one simulation step
+struct Frame
+{
+    // Scene the frame was made for, frames of old scenes are ignored
+    unsigned int sceneId = 0;
+    unsigned int step = 0;
+
+    // Last two steps, render interpolates between them
+    FrameState previous;
+    FrameState current;
+
+    // Wall clock time current state belongs to, and step length
+    std::chrono::steady_clock::time_point time;
+    float stepTime = 0.0f;
+
+    // Physics values for debug overlay
+    PhysicsDebug debugPhysicsData;
+
+    // How far render time is past current state, in steps [0, 1]
+    float blendFactor(std::chrono::steady_clock::time_point now) const;
+};
+
+// Blend rigid transforms, rotation is slerped so bones keep their shape
+glm::mat4 interpolateTransform(const glm::mat4 &a, const glm::mat4 &b, float t);
+
+// Triple buffer between simulation and render thread. Simulation writes back frame,
+// render reads newest published frame, neither ever waits on the other
+class FrameMailbox
+{
+public:
+    // Simulation side
+    Frame &back();
+    void publish();
+
+    // Render side, newest published frame
+    const Frame &acquire();
+
+private:
+    std::array<Frame, 3> frames;
+
+    // Frame owned by each side, and the one in between. Bit 4 marks unread frame
+    int backIndex = 0;
+    int frontIndex = 1;
+    std::atomic<int> readyIndex{2};
+
+    static const int freshBit = 4;
+};
+
+#endif
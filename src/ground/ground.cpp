@@ -0,0 +1,90 @@
+#include "ground/ground.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "fleet/fleet.h"
+#include "heightfield/heightfield.h"
+
+int Ground::add(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4 &placement)
+{
+    // Placement itself is kept by fleet, its scale goes into runners
+    float scaleX = glm::length(glm::vec3(placement[0]));
+    float scaleY = glm::length(glm::vec3(placement[1]));
+    float scaleZ = glm::length(glm::vec3(placement[2]));
+
+    left.push_back(boundsMin.x * scaleX);
+    right.push_back(boundsMax.x * scaleX);
+    back.push_back(boundsMin.y * scaleY);
+    front.push_back(boundsMax.y * scaleY);
+    bottom.push_back(boundsMin.z * scaleZ);
+
+    int index = left.size() - 1;
+    for (std::vector<float> *array : {&runnerX, &runnerY, &runnerZ})
+    {
+        array->resize(3 * (index + 1), 0.0f);
+    }
+
+    return index;
+}
+
+void Ground::clear()
+{
+    for (std::vector<float> *array : {&left, &right, &front, &back, &bottom, &runnerX, &runnerY, &runnerZ})
+    {
+        array->clear();
+    }
+}
+
+void Ground::step(Fleet &fleet, const Heightfield &terrain)
+{
+    int count = std::min((int)left.size(), fleet.size());
+
+    // Scenes without terrain keep yachts level at their placement
+    if (!terrain.loaded())
+    {
+        std::fill(fleet.groundHeight.begin(), fleet.groundHeight.end(), 0.0f);
+        std::fill(fleet.groundPitch.begin(), fleet.groundPitch.end(), 0.0f);
+        std::fill(fleet.groundRoll.begin(), fleet.groundRoll.end(), 0.0f);
+        return;
+    }
+
+    // Runners to world, right of hull is (heading.y, -heading.x)
+    for (int i = 0; i < count; i++)
+    {
+        float c = fleet.originCos[i], s = fleet.originSin[i];
+        float hx = fleet.headingX[i], hy = fleet.headingY[i];
+        float acrossX[3] = {0.5f * (left[i] + right[i]), left[i], right[i]};
+        float alongY[3] = {front[i], back[i], back[i]};
+
+        for (int r = 0; r < 3; r++)
+        {
+            float localX = fleet.positionX[i] + hy * acrossX[r] + hx * alongY[r];
+            float localY = fleet.positionY[i] - hx * acrossX[r] + hy * alongY[r];
+            runnerX[3 * i + r] = fleet.originX[i] + c * localX - s * localY;
+            runnerY[3 * i + r] = fleet.originY[i] + s * localX + c * localY;
+        }
+    }
+
+    // All runners in one batch
+    terrain.height(runnerX.data(), runnerY.data(), runnerZ.data(), 3 * count);
+
+    for (int i = 0; i < count; i++)
+    {
+        // Height of body origin that puts bottom of each runner on the ground
+        float bow = runnerZ[3 * i] - fleet.originZ[i] - bottom[i];
+        float backLeft = runnerZ[3 * i + 1] - fleet.originZ[i] - bottom[i];
+        float backRight = runnerZ[3 * i + 2] - fleet.originZ[i] - bottom[i];
+        float stern = 0.5f * (backLeft + backRight);
+
+        float length = std::max(front[i] - back[i], 1e-3f);
+        float width = std::max(right[i] - left[i], 1e-3f);
+        float pitchSlope = (bow - stern) / length;
+        float rollSlope = (backRight - backLeft) / width;
+
+        // Plane through runners at model origin, nose up and right side up are positive
+        fleet.groundHeight[i] = stern - back[i] * pitchSlope - 0.5f * (left[i] + right[i]) * rollSlope;
+        fleet.groundPitch[i] = std::atan(pitchSlope);
+        fleet.groundRoll[i] = std::atan(rollSlope);
+    }
+}
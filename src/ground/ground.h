@@ -0,0 +1,31 @@
+#ifndef GROUND_H
+#define GROUND_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class Fleet;
+class Heightfield;
+
+// Keeps fleet yachts on the terrain. Each yacht stands on three runners, one at the bow and
+// two at the back corners of its footprint, and its body follows the plane through them
+class Ground
+{
+public:
+    // Add yacht from model bounds and scene placement, returns its index, same order as fleet
+    int add(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4 &placement);
+    void clear();
+
+    // Height, pitch and roll of every yacht from terrain under its runners
+    void step(Fleet &fleet, const Heightfield &terrain);
+
+private:
+    // Runners in model space after scale, bow runner is centred across, and bottom of the model
+    std::vector<float> left, right, front, back, bottom;
+
+    // World runner positions this step, bow, back left and back right after each other per yacht
+    std::vector<float> runnerX, runnerY, runnerZ;
+};
+
+#endif
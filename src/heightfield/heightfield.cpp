@@ -0,0 +1,416 @@
+#include "heightfield/heightfield.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "lanes/lanes.h"
+
+using namespace lanes;
+
+std::mutex Heightfield::cacheMutex;
+std::vector<std::shared_ptr<const Heightfield::Pyramid>> Heightfield::cache;
+
+namespace
+{
+    // Bilinear sample at texel coordinates, texel centres on whole numbers, wraps like GL_REPEAT
+    template <typename L>
+    L bilinear(const float *values, int width, int height, L x, L y)
+    {
+        const float w = (float)width, h = (float)height;
+
+        L x0 = floor(x), y0 = floor(y);
+        L fx = x - x0, fy = y - y0;
+        x0 = x0 - floor(x0 * (1.0f / w)) * w;
+        y0 = y0 - floor(y0 * (1.0f / h)) * h;
+
+        // Reciprocal can round the wrap one texel off
+        x0 = select(x0 >= w, x0 - w, select(x0 < 0.0f, x0 + w, x0));
+        y0 = select(y0 >= h, y0 - h, select(y0 < 0.0f, y0 + h, y0));
+        L x1 = select(x0 >= w - 1.0f, L(0.0f), x0 + 1.0f);
+        L y1 = select(y0 >= h - 1.0f, L(0.0f), y0 + 1.0f);
+
+        L c00 = gather(values, y0, x0, width), c10 = gather(values, y0, x1, width);
+        L c01 = gather(values, y1, x0, width), c11 = gather(values, y1, x1, width);
+        L c0 = c00 + (c10 - c00) * fx;
+        L c1 = c01 + (c11 - c01) * fx;
+        return c0 + (c1 - c0) * fy;
+    }
+
+    // World to texel coordinates of a level, x * scale + shift per axis
+    struct TexelMap
+    {
+        float scaleX, scaleY, shiftX, shiftY;
+    };
+
+    template <typename L>
+    void heightLanes(const float *values, int width, int height, const TexelMap &map, float offsetZ, float heightScale,
+                     const float *positionX, const float *positionY, float *out, int i)
+    {
+        L x = L::load(&positionX[i]) * map.scaleX + map.shiftX;
+        L y = L::load(&positionY[i]) * map.scaleY + map.shiftY;
+        (L(offsetZ) + bilinear(values, width, height, x, y) * heightScale).store(&out[i]);
+    }
+
+    template <typename L>
+    void normalLanes(const float *values, int width, int height, const TexelMap &map, float heightScale,
+                     const float *positionX, const float *positionY, float *normalX, float *normalY, float *normalZ, int i)
+    {
+        L x = L::load(&positionX[i]) * map.scaleX + map.shiftX;
+        L y = L::load(&positionY[i]) * map.scaleY + map.shiftY;
+
+        // Central differences one texel to each side
+        L left = bilinear(values, width, height, x - 1.0f, y);
+        L right = bilinear(values, width, height, x + 1.0f, y);
+        L down = bilinear(values, width, height, x, y - 1.0f);
+        L up = bilinear(values, width, height, x, y + 1.0f);
+
+        L slopeX = (right - left) * (0.5f * heightScale * map.scaleX);
+        L slopeY = (up - down) * (0.5f * heightScale * map.scaleY);
+        L inverseLength = L(1.0f) / sqrt(slopeX * slopeX + slopeY * slopeY + 1.0f);
+
+        (-slopeX * inverseLength).store(&normalX[i]);
+        (-slopeY * inverseLength).store(&normalY[i]);
+        inverseLength.store(&normalZ[i]);
+    }
+
+    // Level ranges of texels first to last on a wrapping axis of size texels, split where they wrap
+    int wrapRanges(int first, int last, int size, int shift, int ranges[4])
+    {
+        int span = last - first;
+        if (span + 1 >= size)
+        {
+            ranges[0] = 0;
+            ranges[1] = (size - 1) >> shift;
+            return 1;
+        }
+
+        first = (first % size + size) % size;
+        last = first + span;
+        if (last < size)
+        {
+            ranges[0] = first >> shift;
+            ranges[1] = last >> shift;
+            return 1;
+        }
+
+        ranges[0] = first >> shift;
+        ranges[1] = (size - 1) >> shift;
+        ranges[2] = 0;
+        ranges[3] = (last - size) >> shift;
+        return 2;
+    }
+}
+
+bool Heightfield::load(const std::string &path, glm::vec3 offset, float heightScale)
+{
+    this->offset = offset;
+    this->heightScale = heightScale;
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    // Reuse pyramid of an image loaded before
+    for (const std::shared_ptr<const Pyramid> &cached : cache)
+    {
+        if (cached->path == path)
+        {
+            pyramid = cached;
+            return true;
+        }
+    }
+
+    int width, height, components;
+    unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, 0);
+    if (!data)
+    {
+        std::cout << "Heightmap failed to load at path: " << path << std::endl;
+        pyramid = nullptr;
+        return false;
+    }
+
+    std::shared_ptr<Pyramid> built = std::make_shared<Pyramid>();
+    built->path = path;
+
+    // Full size level from red channel
+    Level base;
+    base.width = width;
+    base.height = height;
+    base.values.resize(width * height);
+    for (int i = 0; i < width * height; i++)
+    {
+        base.values[i] = data[i * components] / 255.0f;
+    }
+    stbi_image_free(data);
+
+    // Steepest step between neighbours, wrapping, bounds slope for ray marching
+    built->maxStep = 0.0f;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            float value = base.values[y * width + x];
+            built->maxStep = std::max({built->maxStep,
+                                       std::fabs(base.values[y * width + (x + 1) % width] - value),
+                                       std::fabs(base.values[((y + 1) % height) * width + x] - value)});
+        }
+    }
+    built->levels.push_back(std::move(base));
+
+    // Halve until one texel, odd edges keep their last texel alone
+    while (built->levels.back().width > 1 || built->levels.back().height > 1)
+    {
+        const Level &fine = built->levels.back();
+        const std::vector<float> &fineMinimum = built->levels.size() == 1 ? fine.values : fine.minimum;
+
+        Level coarse;
+        coarse.width = (fine.width + 1) / 2;
+        coarse.height = (fine.height + 1) / 2;
+        coarse.values.resize(coarse.width * coarse.height);
+        coarse.minimum.resize(coarse.width * coarse.height);
+
+        for (int y = 0; y < coarse.height; y++)
+        {
+            for (int x = 0; x < coarse.width; x++)
+            {
+                float sum = 0.0f;
+                float lowest = INFINITY;
+                int texels = 0;
+                for (int fy = 2 * y; fy < std::min(2 * y + 2, fine.height); fy++)
+                {
+                    for (int fx = 2 * x; fx < std::min(2 * x + 2, fine.width); fx++)
+                    {
+                        sum += fine.values[fy * fine.width + fx];
+                        lowest = std::min(lowest, fineMinimum[fy * fine.width + fx]);
+                        texels++;
+                    }
+                }
+                coarse.values[y * coarse.width + x] = sum / texels;
+                coarse.minimum[y * coarse.width + x] = lowest;
+            }
+        }
+
+        built->levels.push_back(std::move(coarse));
+    }
+
+    cache.push_back(built);
+    pyramid = built;
+    return true;
+}
+
+int Heightfield::levels() const
+{
+    return pyramid ? pyramid->levels.size() : 0;
+}
+
+const Heightfield::Level &Heightfield::level(int index) const
+{
+    return pyramid->levels[std::clamp(index, 0, (int)pyramid->levels.size() - 1)];
+}
+
+void Heightfield::height(const float *positionX, const float *positionY, float *height, int count, int level) const
+{
+    // Flat at offset without a heightmap
+    if (!pyramid)
+    {
+        std::fill(height, height + count, offset.z);
+        return;
+    }
+
+    const Level &source = this->level(level);
+    float scaleX = source.width / worldSize, scaleY = source.height / worldSize;
+    TexelMap map = {scaleX, scaleY, 0.5f * source.width - 0.5f - offset.x * scaleX, 0.5f * source.height - 0.5f - offset.y * scaleY};
+    int i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // Full SIMD batches
+    for (; i + SimdLanes::width <= count; i += SimdLanes::width)
+    {
+        heightLanes<SimdLanes>(source.values.data(), source.width, source.height, map, offset.z, heightScale, positionX, positionY, height, i);
+    }
+#endif
+
+    // Remaining positions
+    for (; i < count; i++)
+    {
+        heightLanes<ScalarLanes>(source.values.data(), source.width, source.height, map, offset.z, heightScale, positionX, positionY, height, i);
+    }
+}
+
+float Heightfield::height(glm::vec2 position, int level) const
+{
+    float z;
+    height(&position.x, &position.y, &z, 1, level);
+    return z;
+}
+
+void Heightfield::normal(const float *positionX, const float *positionY, float *normalX, float *normalY, float *normalZ, int count, int level) const
+{
+    if (!pyramid)
+    {
+        std::fill(normalX, normalX + count, 0.0f);
+        std::fill(normalY, normalY + count, 0.0f);
+        std::fill(normalZ, normalZ + count, 1.0f);
+        return;
+    }
+
+    const Level &source = this->level(level);
+    float scaleX = source.width / worldSize, scaleY = source.height / worldSize;
+    TexelMap map = {scaleX, scaleY, 0.5f * source.width - 0.5f - offset.x * scaleX, 0.5f * source.height - 0.5f - offset.y * scaleY};
+    int i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // Full SIMD batches
+    for (; i + SimdLanes::width <= count; i += SimdLanes::width)
+    {
+        normalLanes<SimdLanes>(source.values.data(), source.width, source.height, map, heightScale, positionX, positionY, normalX, normalY, normalZ, i);
+    }
+#endif
+
+    // Remaining positions
+    for (; i < count; i++)
+    {
+        normalLanes<ScalarLanes>(source.values.data(), source.width, source.height, map, heightScale, positionX, positionY, normalX, normalY, normalZ, i);
+    }
+}
+
+glm::vec3 Heightfield::normal(glm::vec2 position, int level) const
+{
+    glm::vec3 n;
+    normal(&position.x, &position.y, &n.x, &n.y, &n.z, 1, level);
+    return n;
+}
+
+float Heightfield::minHeight(glm::vec2 boundsMin, glm::vec2 boundsMax) const
+{
+    if (!pyramid)
+    {
+        return offset.z;
+    }
+
+    // Texels of full level that bilinear samples in the area can touch
+    const Level &base = level(0);
+    float scaleX = base.width / worldSize, scaleY = base.height / worldSize;
+    int firstX = (int)std::floor((boundsMin.x - offset.x) * scaleX + 0.5f * base.width - 0.5f);
+    int firstY = (int)std::floor((boundsMin.y - offset.y) * scaleY + 0.5f * base.height - 0.5f);
+    int lastX = (int)std::floor((boundsMax.x - offset.x) * scaleX + 0.5f * base.width - 0.5f) + 1;
+    int lastY = (int)std::floor((boundsMax.y - offset.y) * scaleY + 0.5f * base.height - 0.5f) + 1;
+
+    // Coarsest level that still takes a few texels per side, its minimums cover all texels below
+    int shift = 0;
+    while (shift + 1 < levels() && ((lastX - firstX) >> shift > 4 || (lastY - firstY) >> shift > 4))
+    {
+        shift++;
+    }
+
+    const Level &source = level(shift);
+    const std::vector<float> &minimum = shift == 0 ? source.values : source.minimum;
+
+    int rangesX[4], rangesY[4];
+    int countX = wrapRanges(firstX, lastX, base.width, shift, rangesX);
+    int countY = wrapRanges(firstY, lastY, base.height, shift, rangesY);
+
+    float lowest = INFINITY;
+    for (int ry = 0; ry < countY; ry++)
+    {
+        for (int y = rangesY[2 * ry]; y <= rangesY[2 * ry + 1]; y++)
+        {
+            for (int rx = 0; rx < countX; rx++)
+            {
+                for (int x = rangesX[2 * rx]; x <= rangesX[2 * rx + 1]; x++)
+                {
+                    lowest = std::min(lowest, minimum[y * source.width + x]);
+                }
+            }
+        }
+    }
+
+    return offset.z + heightScale * lowest;
+}
+
+bool Heightfield::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, float &distance) const
+{
+    // Flat plane at offset without a heightmap
+    if (!pyramid)
+    {
+        distance = origin.z <= offset.z ? 0.0f : (direction.z < 0.0f ? (origin.z - offset.z) / -direction.z : INFINITY);
+        return distance <= maxDistance;
+    }
+
+    // Highest the surface can reach, and fastest it can rise per meter across
+    const Level &base = level(0);
+    float top = offset.z + heightScale;
+    float slope = std::sqrt(2.0f) * pyramid->maxStep * heightScale * std::max(base.width, base.height) / worldSize;
+    float horizontal = glm::length(glm::vec2(direction));
+    float closing = slope * horizontal - direction.z;
+
+    // Skip to where ray comes below highest point
+    float t = 0.0f;
+    if (origin.z > top)
+    {
+        if (direction.z >= 0.0f)
+        {
+            return false;
+        }
+        t = (origin.z - top) / -direction.z;
+    }
+
+    auto gap = [&](float t)
+    {
+        glm::vec3 point = origin + direction * t;
+        return point.z - height(glm::vec2(point));
+    };
+
+    float current = gap(t);
+    if (current <= 0.0f)
+    {
+        distance = t;
+        return t <= maxDistance;
+    }
+
+    // Ray climbs faster than any slope, surface can not catch up
+    if (closing <= 0.0f)
+    {
+        return false;
+    }
+
+    // Step as far as the steepest possible rise allows, at least a fraction of a texel
+    float minStep = 0.25f * worldSize / std::max(base.width, base.height);
+    while (t < maxDistance)
+    {
+        float next = std::min(t + std::max(current / closing, minStep), maxDistance);
+        float nextGap = gap(next);
+
+        if (nextGap <= 0.0f)
+        {
+            // Crossing between t and next, refine
+            float low = t, high = next;
+            for (int i = 0; i < 16; i++)
+            {
+                float middle = 0.5f * (low + high);
+                if (gap(middle) > 0.0f)
+                {
+                    low = middle;
+                }
+                else
+                {
+                    high = middle;
+                }
+            }
+            distance = high;
+            return true;
+        }
+
+        // Ray left height range going up
+        if (origin.z + direction.z * next > top && direction.z >= 0.0f)
+        {
+            return false;
+        }
+
+        t = next;
+        current = nextGap;
+    }
+
+    return false;
+}
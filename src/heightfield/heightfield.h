@@ -0,0 +1,71 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Terrain heights on the CPU, from the same heightmap image the terrain shader samples.
+// Image is kept as a float mip pyramid with averages for smooth queries at lower detail,
+// and minimums for conservative bounds over an area
+class Heightfield
+{
+public:
+    // Default empty constructor
+    Heightfield() {};
+
+    // Load image, red channel is height in [0, 1], pyramid is shared by every heightfield of the same image
+    bool load(const std::string &path, glm::vec3 offset, float heightScale);
+    bool loaded() const { return pyramid != nullptr; }
+    int levels() const;
+
+    // World size of one repeat of the image, same as terrain shader, and placement of terrain
+    float worldSize = 1024.0f;
+    glm::vec3 offset = glm::vec3(0.0f);
+    float heightScale = 1.0f;
+
+    // World height at count positions, bilinear on a pyramid level
+    void height(const float *positionX, const float *positionY, float *height, int count, int level = 0) const;
+    float height(glm::vec2 position, int level = 0) const;
+
+    // Unit surface normal at count positions, from height differences one texel of level apart
+    void normal(const float *positionX, const float *positionY, float *normalX, float *normalY, float *normalZ, int count, int level = 0) const;
+    glm::vec3 normal(glm::vec2 position, int level = 0) const;
+
+    // Lowest world height the surface reaches over an area, never above the bilinear height
+    float minHeight(glm::vec2 boundsMin, glm::vec2 boundsMax) const;
+
+    // Distance along unit direction to first surface hit, false if none within maxDistance
+    bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, float &distance) const;
+
+private:
+    // One pyramid level, row major, rows along +Y. Minimum of texels covered on level 0, empty there as it equals values
+    struct Level
+    {
+        int width, height;
+        std::vector<float> values;
+        std::vector<float> minimum;
+    };
+
+    // Pyramid of one image, level 0 is full size and each next one half of it rounded up
+    struct Pyramid
+    {
+        std::string path;
+        std::vector<Level> levels;
+
+        // Largest height change per texel of level 0
+        float maxStep;
+    };
+
+    std::shared_ptr<const Pyramid> pyramid;
+
+    static std::mutex cacheMutex;
+    static std::vector<std::shared_ptr<const Pyramid>> cache;
+
+    const Level &level(int index) const;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#include "input_queue/input_queue.h"
+
+bool InputQueue::push(const TimedInput &input)
+{
+    uint32_t position = head.load(std::memory_order_relaxed);
+    if (position - tail.load(std::memory_order_acquire) >= size)
+    {
+        dropped++;
+        return false;
+    }
+
+    inputs[position & (size - 1)] = input;
+    head.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool InputQueue::peek(TimedInput &input) const
+{
+    uint32_t position = tail.load(std::memory_order_relaxed);
+    if (position == head.load(std::memory_order_acquire))
+    {
+        return false;
+    }
+
+    input = inputs[position & (size - 1)];
+    return true;
+}
+
+void InputQueue::pop()
+{
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
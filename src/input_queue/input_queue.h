@@ -0,0 +1,57 @@
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// What a queued input is
+enum TimedInputType
+{
+    timedKey,
+    timedMouse,
+    timedRelease
+};
+
+// Key or mouse event as a callback got it, with the time it came in. Release lets go of every key
+struct TimedInput
+{
+    std::chrono::steady_clock::time_point time;
+    TimedInputType type = timedKey;
+
+    // Key code of consumer, pressed or let go, and a press repeated by holding
+    int key = 0;
+    bool pressed = false;
+    bool repeat = false;
+
+    // Cursor position
+    double x = 0.0, y = 0.0;
+};
+
+// Fixed size lock free ring of inputs from one producer thread to one consumer thread.
+// Callbacks only push, consumer handles inputs at a point of its own choosing
+class InputQueue
+{
+public:
+    // Inputs in ring, power of 2
+    static const int size = 256;
+
+    // Producer, false when ring is full and input is dropped
+    bool push(const TimedInput &input);
+
+    // Consumer, oldest input without taking it, then taking it
+    bool peek(TimedInput &input) const;
+    void pop();
+
+    // Inputs lost to a full ring
+    std::atomic<uint32_t> dropped = 0;
+
+private:
+    TimedInput inputs[size];
+
+    // Positions only count up, slot is position modulo size. Head written by producer, tail by consumer
+    alignas(64) std::atomic<uint32_t> head = 0;
+    alignas(64) std::atomic<uint32_t> tail = 0;
+};
+
+#endif
@@ -0,0 +1,372 @@
+#include "input_recorder/input_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "event_handler/event_handler.h"
+
+// Event types in streams
+enum InputEvent : uint8_t
+{
+    frameEvent,
+    keyEvent,
+    mouseEvent,
+    sceneEvent,
+    stepEvent
+};
+
+// Bits of a step event after the five keys
+static const uint16_t resetBit = 1 << 5;
+static const uint16_t switchBit = 1 << 6;
+static const uint16_t viewBit = 1 << 7;
+static const uint16_t rewindBit = 1 << 8;
+
+std::atomic<InputMode> InputRecorder::mode = liveInput;
+std::string InputRecorder::path;
+std::vector<uint8_t> InputRecorder::frameData, InputRecorder::stepData;
+size_t InputRecorder::frameRead = 0, InputRecorder::stepRead = 0;
+uint32_t InputRecorder::held = 0;
+bool InputRecorder::dispatching = false;
+SimulationView InputRecorder::view;
+bool InputRecorder::sceneFound = false;
+
+// Keys read with glfwGetKey anywhere, held state of these is kept per frame
+const std::vector<int> InputRecorder::heldKeys = {GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D, GLFW_KEY_SPACE, GLFW_KEY_LEFT_SHIFT,
+                                                  GLFW_KEY_UP, GLFW_KEY_DOWN, GLFW_KEY_LEFT, GLFW_KEY_RIGHT, GLFW_KEY_P};
+
+template <typename T>
+void InputRecorder::put(std::vector<uint8_t> &data, const T &value)
+{
+    const uint8_t *bytes = (const uint8_t *)&value;
+    data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+bool InputRecorder::get(const std::vector<uint8_t> &data, size_t &read, T &value)
+{
+    if (read + sizeof(T) > data.size())
+    {
+        read = data.size();
+        return false;
+    }
+    std::memcpy(&value, &data[read], sizeof(T));
+    read += sizeof(T);
+    return true;
+}
+
+bool InputRecorder::startRecording(const std::string &path)
+{
+    // Check file can be written before recording a whole session
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open file: " << path << std::endl;
+        return false;
+    }
+
+    InputRecorder::path = path;
+    frameData.clear();
+    stepData.clear();
+    view = SimulationView();
+    mode = recordInput;
+    return true;
+}
+
+bool InputRecorder::startReplay(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open file: " << path << std::endl;
+        return false;
+    }
+
+    // Header, then sizes of both streams
+    char fileMagic[4];
+    uint32_t fileVersion;
+    uint64_t frameSize, stepSize;
+    file.read(fileMagic, sizeof(fileMagic));
+    file.read((char *)&fileVersion, sizeof(fileVersion));
+    file.read((char *)&frameSize, sizeof(frameSize));
+    file.read((char *)&stepSize, sizeof(stepSize));
+    if (!file || std::memcmp(fileMagic, magic, sizeof(magic)) != 0 || fileVersion != version)
+    {
+        std::cerr << "Not an input recording: " << path << std::endl;
+        return false;
+    }
+
+    frameData.resize(frameSize);
+    stepData.resize(stepSize);
+    file.read((char *)frameData.data(), frameSize);
+    file.read((char *)stepData.data(), stepSize);
+    if (!file)
+    {
+        std::cerr << "Input recording cut short: " << path << std::endl;
+        return false;
+    }
+
+    frameRead = 0;
+    stepRead = 0;
+    held = 0;
+    view = SimulationView();
+    sceneFound = false;
+    mode = replayInput;
+    return true;
+}
+
+void InputRecorder::stop()
+{
+    if (mode == recordInput)
+    {
+        std::ofstream file(path, std::ios::binary);
+        uint32_t fileVersion = version;
+        uint64_t frameSize = frameData.size(), stepSize = stepData.size();
+        file.write(magic, sizeof(magic));
+        file.write((const char *)&fileVersion, sizeof(fileVersion));
+        file.write((const char *)&frameSize, sizeof(frameSize));
+        file.write((const char *)&stepSize, sizeof(stepSize));
+        file.write((const char *)frameData.data(), frameSize);
+        file.write((const char *)stepData.data(), stepSize);
+        std::cout << "Input recorded to " << path << std::endl;
+    }
+
+    mode = liveInput;
+    frameData.clear();
+    stepData.clear();
+}
+
+void InputRecorder::frame(GLFWwindow *window, float &time)
+{
+    if (mode == recordInput)
+    {
+        held = 0;
+        for (int i = 0; i < heldKeys.size(); i++)
+        {
+            held |= (glfwGetKey(window, heldKeys[i]) == GLFW_PRESS ? 1u : 0u) << i;
+        }
+
+        put(frameData, frameEvent);
+        put(frameData, time);
+        put(frameData, held);
+    }
+    else if (mode == replayInput)
+    {
+        // Events not taken yet belong to frames before this one
+        dispatch(window);
+
+        uint8_t type;
+        float recordedTime;
+        if (get(frameData, frameRead, type) && get(frameData, frameRead, recordedTime) && get(frameData, frameRead, held))
+        {
+            time = recordedTime;
+            return;
+        }
+
+        // Out of frames, player takes over. Steps took their inputs from replay, so let go of keys and requests queued by replayed events
+        std::cout << "Replay finished" << std::endl;
+        mode = liveInput;
+        held = 0;
+        TimedInput release;
+        release.time = std::chrono::steady_clock::now();
+        release.type = timedRelease;
+        Physics::inputs.push(release);
+    }
+}
+
+bool InputRecorder::keyHeld(GLFWwindow *window, int key)
+{
+    if (mode == replayInput)
+    {
+        int index = std::find(heldKeys.begin(), heldKeys.end(), key) - heldKeys.begin();
+        return index < heldKeys.size() && (held >> index) & 1u;
+    }
+
+    return glfwGetKey(window, key) == GLFW_PRESS;
+}
+
+bool InputRecorder::key(int key, int scancode, int action, int mods)
+{
+    if (dispatching)
+    {
+        return true;
+    }
+
+    if (mode == recordInput)
+    {
+        put(frameData, keyEvent);
+        put(frameData, (int32_t)key);
+        put(frameData, (int32_t)scancode);
+        put(frameData, (uint8_t)action);
+        put(frameData, (uint8_t)mods);
+    }
+
+    return mode != replayInput;
+}
+
+bool InputRecorder::mouse(double xPos, double yPos)
+{
+    if (dispatching)
+    {
+        return true;
+    }
+
+    if (mode == recordInput)
+    {
+        put(frameData, mouseEvent);
+        put(frameData, xPos);
+        put(frameData, yPos);
+    }
+
+    return mode != replayInput;
+}
+
+void InputRecorder::dispatch(GLFWwindow *window)
+{
+    if (mode != replayInput)
+    {
+        return;
+    }
+
+    // Every event up to next frame
+    dispatching = true;
+    while (frameRead < frameData.size() && frameData[frameRead] != frameEvent)
+    {
+        uint8_t type;
+        get(frameData, frameRead, type);
+
+        if (type == keyEvent)
+        {
+            int32_t key, scancode;
+            uint8_t action, mods;
+            if (get(frameData, frameRead, key) && get(frameData, frameRead, scancode) && get(frameData, frameRead, action) && get(frameData, frameRead, mods))
+            {
+                EventHandler::keyCallback(window, key, scancode, action, mods);
+            }
+        }
+        else if (type == mouseEvent)
+        {
+            double xPos, yPos;
+            if (get(frameData, frameRead, xPos) && get(frameData, frameRead, yPos))
+            {
+                EventHandler::mouseCallback(window, xPos, yPos);
+            }
+        }
+        else
+        {
+            // Unknown event, rest of stream can not be read
+            frameRead = frameData.size();
+        }
+    }
+    dispatching = false;
+}
+
+void InputRecorder::beginScene(const std::string &name)
+{
+    if (mode == recordInput)
+    {
+        put(stepData, sceneEvent);
+        put(stepData, (uint8_t)std::min(name.size(), (size_t)255));
+        stepData.insert(stepData.end(), name.begin(), name.begin() + std::min(name.size(), (size_t)255));
+
+        // First step of scene always records camera
+        view = SimulationView();
+    }
+    else if (mode == replayInput)
+    {
+        // Steps of last scene that were not replayed are skipped
+        sceneFound = false;
+        view = SimulationView();
+        while (stepRead < stepData.size())
+        {
+            uint8_t type;
+            get(stepData, stepRead, type);
+
+            if (type == sceneEvent)
+            {
+                uint8_t length = 0;
+                get(stepData, stepRead, length);
+                std::string recorded(stepData.begin() + std::min(stepRead, stepData.size()), stepData.begin() + std::min(stepRead + length, stepData.size()));
+                stepRead += length;
+
+                sceneFound = recorded == name;
+                if (!sceneFound)
+                {
+                    std::cerr << "Replay recorded scene " << recorded << ", not " << name << ", yachts get no inputs" << std::endl;
+                }
+                return;
+            }
+
+            // Skip a step event and its camera
+            uint16_t bits = 0;
+            get(stepData, stepRead, bits);
+            if (bits & viewBit)
+            {
+                stepRead += sizeof(uint8_t) + sizeof(glm::vec3) + sizeof(view.planes);
+            }
+        }
+    }
+}
+
+void InputRecorder::step(StepInput &input)
+{
+    if (mode == recordInput)
+    {
+        uint16_t bits = 0;
+        for (int i = 0; i < 5; i++)
+        {
+            bits |= input.keys[i] ? 1 << i : 0;
+        }
+        bits |= input.reset ? resetBit : 0;
+        bits |= input.rewind ? rewindBit : 0;
+        bits |= input.switchYacht ? switchBit : 0;
+
+        // Camera only when it changed since last step
+        bool changed = input.view.valid != view.valid || input.view.position != view.position || input.view.planes != view.planes;
+        bits |= changed ? viewBit : 0;
+
+        put(stepData, stepEvent);
+        put(stepData, bits);
+        if (changed)
+        {
+            put(stepData, (uint8_t)input.view.valid);
+            put(stepData, input.view.position);
+            put(stepData, input.view.planes);
+            view = input.view;
+        }
+    }
+    else if (mode == replayInput)
+    {
+        // Steps past the end of the recorded scene get no inputs
+        input = StepInput();
+        input.view = view;
+        if (!sceneFound || stepRead >= stepData.size() || stepData[stepRead] != stepEvent)
+        {
+            return;
+        }
+
+        uint8_t type;
+        uint16_t bits;
+        get(stepData, stepRead, type);
+        get(stepData, stepRead, bits);
+        for (int i = 0; i < 5; i++)
+        {
+            input.keys[i] = (bits >> i) & 1;
+        }
+        input.reset = bits & resetBit;
+        input.rewind = bits & rewindBit;
+        input.switchYacht = bits & switchBit;
+
+        if (bits & viewBit)
+        {
+            uint8_t valid = 0;
+            get(stepData, stepRead, valid);
+            get(stepData, stepRead, view.position);
+            get(stepData, stepRead, view.planes);
+            view.valid = valid;
+            input.view = view;
+        }
+    }
+}
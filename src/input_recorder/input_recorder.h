@@ -0,0 +1,86 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#ifndef __glad_h_
+#include <glad/glad.h>
+#endif
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "physics/physics.h"
+
+// What happens to input
+enum InputMode
+{
+    liveInput,
+    recordInput,
+    replayInput
+};
+
+// Records a whole session of input to file, and plays it back in place of the player. Main thread
+// keeps frame times, held keys, key and mouse events per frame. Simulation thread keeps the inputs
+// of every fixed step per scene, so yachts sail the same way whatever the frame timing on replay
+class InputRecorder
+{
+public:
+    // File format
+    static constexpr char magic[4] = {'M', 'R', 'I', 'R'};
+    static const uint32_t version = 2;
+
+    // Start from launch, before first scene loads. Replay reads whole file, false if it is not a recording
+    static bool startRecording(const std::string &path);
+    static bool startReplay(const std::string &path);
+
+    // Write recording to file, after simulation thread has stopped
+    static void stop();
+
+    static InputMode getMode() { return mode; }
+
+    // Main thread, once per frame after time is read. Replay sets time to recorded one
+    static void frame(GLFWwindow *window, float &time);
+
+    // Held key, from window or replay
+    static bool keyHeld(GLFWwindow *window, int key);
+
+    // Called first in callbacks, records event. False for events from window during replay, which are ignored
+    static bool key(int key, int scancode, int action, int mods);
+    static bool mouse(double xPos, double yPos);
+
+    // Replay events of this frame through callbacks, after window events are polled
+    static void dispatch(GLFWwindow *window);
+
+    // Simulation thread, at first step of a scene and at every step
+    static void beginScene(const std::string &name);
+    static void step(StepInput &input);
+
+private:
+    static std::atomic<InputMode> mode;
+    static std::string path;
+
+    // Main and simulation stream, type byte then values per event
+    static std::vector<uint8_t> frameData, stepData;
+    static size_t frameRead, stepRead;
+
+    // Held keys of current frame, bit per entry of heldKeys
+    static uint32_t held;
+    static const std::vector<int> heldKeys;
+
+    // Replayed event is going through callback
+    static bool dispatching;
+
+    // Last recorded or replayed camera of simulation
+    static SimulationView view;
+    static bool sceneFound;
+
+    template <typename T>
+    static void put(std::vector<uint8_t> &data, const T &value);
+    template <typename T>
+    static bool get(const std::vector<uint8_t> &data, size_t &read, T &value);
+};
+
+#endif
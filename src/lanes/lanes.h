@@ -0,0 +1,200 @@
+#ifndef LANES_H
+#define LANES_H
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Lane types for kernels written once and instantiated for SIMD and scalar lanes
+namespace lanes
+{
+#if defined(__AVX2__)
+    // 8 values at a time
+    struct SimdMask
+    {
+        __m256 v;
+    };
+
+    struct SimdLanes
+    {
+        static const int width = 8;
+        typedef SimdMask Mask;
+
+        __m256 v;
+        SimdLanes() {}
+        SimdLanes(__m256 v) : v(v) {}
+        SimdLanes(float s) : v(_mm256_set1_ps(s)) {}
+
+        static SimdLanes load(const float *p) { return _mm256_loadu_ps(p); }
+        void store(float *p) const { _mm256_storeu_ps(p, v); }
+    };
+
+    inline SimdLanes operator+(SimdLanes a, SimdLanes b) { return _mm256_add_ps(a.v, b.v); }
+    inline SimdLanes operator-(SimdLanes a, SimdLanes b) { return _mm256_sub_ps(a.v, b.v); }
+    inline SimdLanes operator*(SimdLanes a, SimdLanes b) { return _mm256_mul_ps(a.v, b.v); }
+    inline SimdLanes operator/(SimdLanes a, SimdLanes b) { return _mm256_div_ps(a.v, b.v); }
+    inline SimdLanes operator-(SimdLanes a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+    inline SimdLanes min(SimdLanes a, SimdLanes b) { return _mm256_min_ps(a.v, b.v); }
+    inline SimdLanes max(SimdLanes a, SimdLanes b) { return _mm256_max_ps(a.v, b.v); }
+    inline SimdLanes abs(SimdLanes a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+    inline SimdLanes sqrt(SimdLanes a) { return _mm256_sqrt_ps(a.v); }
+    inline SimdLanes round(SimdLanes a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    inline SimdLanes floor(SimdLanes a) { return _mm256_floor_ps(a.v); }
+    inline SimdMask operator<(SimdLanes a, SimdLanes b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+    inline SimdMask operator>(SimdLanes a, SimdLanes b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+    inline SimdMask operator<=(SimdLanes a, SimdLanes b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+    inline SimdMask operator>=(SimdLanes a, SimdLanes b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+    inline SimdMask operator&(SimdMask a, SimdMask b) { return {_mm256_and_ps(a.v, b.v)}; }
+    inline SimdLanes select(SimdMask mask, SimdLanes a, SimdLanes b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+    inline SimdLanes gather(const float *base, SimdLanes index) { return _mm256_i32gather_ps(base, _mm256_cvttps_epi32(index.v), 4); }
+    inline SimdLanes gather(const float *base, SimdLanes row, SimdLanes column, int stride)
+    {
+        // Index in integers, floats are not exact past 2^24
+        __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(row.v), _mm256_set1_epi32(stride)), _mm256_cvttps_epi32(column.v));
+        return _mm256_i32gather_ps(base, index, 4);
+    }
+#elif defined(__SSE2__)
+    // 4 values at a time
+    struct SimdMask
+    {
+        __m128 v;
+    };
+
+    struct SimdLanes
+    {
+        static const int width = 4;
+        typedef SimdMask Mask;
+
+        __m128 v;
+        SimdLanes() {}
+        SimdLanes(__m128 v) : v(v) {}
+        SimdLanes(float s) : v(_mm_set1_ps(s)) {}
+
+        static SimdLanes load(const float *p) { return _mm_loadu_ps(p); }
+        void store(float *p) const { _mm_storeu_ps(p, v); }
+    };
+
+    inline SimdLanes operator+(SimdLanes a, SimdLanes b) { return _mm_add_ps(a.v, b.v); }
+    inline SimdLanes operator-(SimdLanes a, SimdLanes b) { return _mm_sub_ps(a.v, b.v); }
+    inline SimdLanes operator*(SimdLanes a, SimdLanes b) { return _mm_mul_ps(a.v, b.v); }
+    inline SimdLanes operator/(SimdLanes a, SimdLanes b) { return _mm_div_ps(a.v, b.v); }
+    inline SimdLanes operator-(SimdLanes a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+    inline SimdLanes min(SimdLanes a, SimdLanes b) { return _mm_min_ps(a.v, b.v); }
+    inline SimdLanes max(SimdLanes a, SimdLanes b) { return _mm_max_ps(a.v, b.v); }
+    inline SimdLanes abs(SimdLanes a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+    inline SimdLanes sqrt(SimdLanes a) { return _mm_sqrt_ps(a.v); }
+    inline SimdLanes round(SimdLanes a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+    inline SimdLanes floor(SimdLanes a)
+    {
+        // Truncate, then step down where that rounded up
+        __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f)));
+    }
+    inline SimdMask operator<(SimdLanes a, SimdLanes b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+    inline SimdMask operator>(SimdLanes a, SimdLanes b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+    inline SimdMask operator<=(SimdLanes a, SimdLanes b) { return {_mm_cmple_ps(a.v, b.v)}; }
+    inline SimdMask operator>=(SimdLanes a, SimdLanes b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+    inline SimdMask operator&(SimdMask a, SimdMask b) { return {_mm_and_ps(a.v, b.v)}; }
+    inline SimdLanes select(SimdMask mask, SimdLanes a, SimdLanes b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+    inline SimdLanes gather(const float *base, SimdLanes index)
+    {
+        // No gather instruction, load lanes one by one
+        alignas(16) float indices[4];
+        _mm_store_ps(indices, index.v);
+        return _mm_setr_ps(base[(int)indices[0]], base[(int)indices[1]], base[(int)indices[2]], base[(int)indices[3]]);
+    }
+    inline SimdLanes gather(const float *base, SimdLanes row, SimdLanes column, int stride)
+    {
+        alignas(16) float rows[4], columns[4];
+        _mm_store_ps(rows, row.v);
+        _mm_store_ps(columns, column.v);
+        return _mm_setr_ps(base[(int)rows[0] * stride + (int)columns[0]], base[(int)rows[1] * stride + (int)columns[1]],
+                           base[(int)rows[2] * stride + (int)columns[2]], base[(int)rows[3] * stride + (int)columns[3]]);
+    }
+#endif
+
+    // One value at a time, for remainder and builds without SIMD
+    struct ScalarMask
+    {
+        bool v;
+    };
+
+    struct ScalarLanes
+    {
+        static const int width = 1;
+        typedef ScalarMask Mask;
+
+        float v;
+        ScalarLanes() {}
+        ScalarLanes(float s) : v(s) {}
+
+        static ScalarLanes load(const float *p) { return *p; }
+        void store(float *p) const { *p = v; }
+    };
+
+    inline ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return a.v + b.v; }
+    inline ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return a.v - b.v; }
+    inline ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return a.v * b.v; }
+    inline ScalarLanes operator/(ScalarLanes a, ScalarLanes b) { return a.v / b.v; }
+    inline ScalarLanes operator-(ScalarLanes a) { return -a.v; }
+    inline ScalarLanes min(ScalarLanes a, ScalarLanes b) { return std::min(a.v, b.v); }
+    inline ScalarLanes max(ScalarLanes a, ScalarLanes b) { return std::max(a.v, b.v); }
+    inline ScalarLanes abs(ScalarLanes a) { return std::fabs(a.v); }
+    inline ScalarLanes sqrt(ScalarLanes a) { return std::sqrt(a.v); }
+    inline ScalarLanes round(ScalarLanes a) { return std::nearbyint(a.v); }
+    inline ScalarLanes floor(ScalarLanes a) { return std::floor(a.v); }
+    inline ScalarMask operator<(ScalarLanes a, ScalarLanes b) { return {a.v < b.v}; }
+    inline ScalarMask operator>(ScalarLanes a, ScalarLanes b) { return {a.v > b.v}; }
+    inline ScalarMask operator<=(ScalarLanes a, ScalarLanes b) { return {a.v <= b.v}; }
+    inline ScalarMask operator>=(ScalarLanes a, ScalarLanes b) { return {a.v >= b.v}; }
+    inline ScalarMask operator&(ScalarMask a, ScalarMask b) { return {a.v && b.v}; }
+    inline ScalarLanes select(ScalarMask mask, ScalarLanes a, ScalarLanes b) { return mask.v ? a : b; }
+    inline ScalarLanes gather(const float *base, ScalarLanes index) { return base[(int)index.v]; }
+    inline ScalarLanes gather(const float *base, ScalarLanes row, ScalarLanes column, int stride) { return base[(int)row.v * stride + (int)column.v]; }
+
+    const float pi = 3.14159265f;
+
+    template <typename L>
+    L clamp(L x, L low, L high)
+    {
+        return min(max(x, low), high);
+    }
+
+    // Polynomial sine, error below 4e-6 after reduction to [-pi/2, pi/2]
+    template <typename L>
+    L sine(L x)
+    {
+        // Wrap to [-pi, pi], then mirror outer quarters inwards
+        x = x - round(x * (0.5f / pi)) * (2.0f * pi);
+        x = select(x > 0.5f * pi, L(pi) - x, x);
+        x = select(x < -0.5f * pi, L(-pi) - x, x);
+
+        L x2 = x * x;
+        return x * (L(1.0f) + x2 * (L(-1.0f / 6.0f) + x2 * (L(1.0f / 120.0f) + x2 * (L(-1.0f / 5040.0f) + x2 * L(1.0f / 362880.0f)))));
+    }
+
+    // Polynomial atan2, error below 1e-5 rad
+    template <typename L>
+    L arcTangent2(L y, L x)
+    {
+        // Reduce to atan of [0, 1]
+        L ax = abs(x), ay = abs(y);
+        typename L::Mask swap = ay > ax;
+        L z = select(swap, ax, ay) / max(select(swap, ay, ax), L(1e-30f));
+
+        L z2 = z * z;
+        L r = z * (L(0.99997726f) + z2 * (L(-0.33262347f) + z2 * (L(0.19354346f) + z2 * (L(-0.11643287f) + z2 * (L(0.05265332f) + z2 * L(-0.01172120f))))));
+
+        // Back to full circle
+        r = select(swap, L(0.5f * pi) - r, r);
+        r = select(x < 0.0f, L(pi) - r, r);
+        return select(y < 0.0f, -r, r);
+    }
+}
+
+#endif
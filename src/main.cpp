@@ -11,7 +11,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "event_handler/event_handler.h"
+#include "input_recorder/input_recorder.h"
 #include "model/model.h"
+#include "physics/physics.h"
 #include "scene/scene.h"
 #include "scene_manager/scene_manager.h"
 #include "camera/camera.h"
@@ -19,8 +21,33 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 
-int main()
+int main(int argc, char **argv)
 {
+    // Record or replay input of whole session
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--record" && !InputRecorder::startRecording(argv[i + 1]))
+        {
+            return -1;
+        }
+        if (option == "--replay" && !InputRecorder::startReplay(argv[i + 1]))
+        {
+            return -1;
+        }
+
+        // Race against others on a server started with marama_sim --serve, as host:port
+        if (option == "--connect")
+        {
+            std::string address = argv[i + 1];
+            size_t split = address.rfind(':');
+            if (split == std::string::npos || !Physics::sync.connect(address.substr(0, split), std::stoi(address.substr(split + 1))))
+            {
+                std::cerr << "Could not connect to " << address << std::endl;
+                return -1;
+            }
+        }
+    }
 
     // Initialize GLFW
     if (!glfwInit())
@@ -106,6 +133,9 @@ int main()
 
     Render::setup();
 
+    // Simulation runs on its own thread, main thread owns window and GL context
+    SceneManager::startSimulation();
+
     // Main Loop
     while (!glfwWindowShouldClose(window))
     {
@@ -123,15 +153,19 @@ int main()
 
         if (SceneManager::loadingState == 0)
         {
-            SceneManager::update();
             SceneManager::render();
             EventHandler::update(window);
         }
 
         glfwSwapBuffers(window);
         glfwPollEvents();
+        InputRecorder::dispatch(window);
+        EventHandler::handleEvents(window);
     }
 
+    SceneManager::stopSimulation();
+    InputRecorder::stop();
+    Physics::sync.disconnect();
     SceneManager::unload();
 
     // Cleanup GLFW
@@ -47,60 +47,6 @@ Mesh Mesh::genUnitPlane(glm::vec3 color, std::string shaderName)
     return Mesh(vertices, indices, shaderName);
 }
 
-Mesh Mesh::genGrid(int gridSizeX, int gridSizeY, float lod, glm::vec3 color, std::string shaderName)
-{
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-
-    // Make hole if LOD !=0
-    float holeFactor;
-    if (lod == 0)
-        holeFactor = 1.0f;
-    else
-        holeFactor = 0.25f;
-
-    // Make vertices
-    for (int y = 0; y <= gridSizeY; y++)
-    {
-        for (int x = 0; x <= gridSizeX; x++)
-        {
-            Vertex vertex;
-            vertex.Position = glm::vec3(x - 0.5f * gridSizeX, y - 0.5f * gridSizeY, 0.0f);
-            vertex.Color = color;
-            vertex.TexCoords = glm::vec2((float)x / gridSizeX, (float)y / gridSizeY);
-
-            vertices.push_back(vertex);
-        }
-    }
-
-    // Make faces from vertices
-    for (int y = 0; y < gridSizeY; y++)
-    {
-        for (int x = 0; x < gridSizeX; x++)
-        {
-            // If in hole, skip
-            if (x > holeFactor * gridSizeX && x < gridSizeX * (1 - holeFactor) &&
-                y > holeFactor * gridSizeY && y < gridSizeY * (1 - holeFactor))
-            {
-                continue;
-            }
-
-            int start = y * (gridSizeX + 1) + x;
-
-            indices.push_back(start);
-            indices.push_back(start + 1);
-            indices.push_back(start + gridSizeX + 1);
-
-            indices.push_back(start + 1);
-            indices.push_back(start + gridSizeX + 2);
-            indices.push_back(start + gridSizeX + 1);
-        }
-    }
-
-    // Return Mesh
-    return Mesh(vertices, indices, shaderName);
-}
-
 unsigned int Mesh::setupSkyBoxMesh()
 {
     float skyboxVertices[] = {
@@ -205,6 +151,7 @@ void Mesh::uploadToGPU()
     glDisableVertexAttribArray(2);
     glDisableVertexAttribArray(3);
     glDisableVertexAttribArray(4);
+    glDisableVertexAttribArray(5);
 
     if (this->shader == "default")
     {
@@ -220,6 +167,9 @@ void Mesh::uploadToGPU()
         // vertex bone weights
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Weights));
+        // vertex place on sail cloth
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Cloth));
     }
 
     else if (this->shader == "toon")
@@ -236,13 +186,9 @@ void Mesh::uploadToGPU()
         // vertex bone weights
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Weights));
-    }
-
-    else if (this->shader == "toon-terrain")
-    {
-        // vertex texture coords
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+        // vertex place on sail cloth
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, Cloth));
     }
 
     else if (this->shader == "simple")
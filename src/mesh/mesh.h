@@ -17,6 +17,9 @@ struct Vertex
     glm::vec3 Color;
     int BoneIDs[4] = {0, 0, 0, 0};
     float Weights[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    // Place on sail cloth grid and weight of cloth, 0 for vertices off the sail
+    glm::vec3 Cloth = glm::vec3(0.0f);
 };
 
 struct Bone
@@ -46,7 +49,6 @@ public:
 
     // Mesh generators
     static Mesh genUnitPlane(glm::vec3 color, std::string shaderName);
-    static Mesh genGrid(int gridSizeX, int gridSizeY, float lod, glm::vec3 color, std::string shaderName);
     static unsigned int setupSkyBoxMesh();
 
     // Send mesh data to gpu
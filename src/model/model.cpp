@@ -11,6 +11,7 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "animation/animation.h"
 #include "scene/scene.h"
 #include "event_handler/event_handler.h"
 
@@ -31,6 +32,9 @@ std::mutex Model::openglMutex;
 std::map<std::string, std::pair<std::string, ModelType>> Model::modelMap;
 std::string modelMapPath = "resources/models.json";
 
+// Keys per second of baked animation clips
+float Model::clipKeyRate = 30.0f;
+
 // Json setups
 JSONCONS_N_MEMBER_TRAITS(JSONModelMapData, 2, name, path);
 JSONCONS_N_MEMBER_TRAITS(JSONModelMap, 0, models, yachts);
@@ -96,8 +100,15 @@ void Model::loadModel(std::string path, std::string shaderName)
     // Combine meshes into one
     combineMeshes(scene, shaderName);
 
-    // Generate initial bone positions
-    generateBoneTransforms();
+    // Flat skeleton from bones found, and clips for it
+    generateSkeleton();
+    generateClips(scene);
+
+    // Pick triangles for software occlusion, bones of skeleton order
+    generateOccluder();
+
+    // Cloth grid over sail, before meshes are uploaded with their place on it
+    sail = SailCloth::fit(meshes, skeleton, skeleton.find(Animation::yachtBoneNames[sailBone]));
 }
 
 void Model::processNode(aiNode *node, const aiScene *scene, std::string shaderName, Bone *parentBone)
@@ -438,6 +449,18 @@ void Model::combineMeshes(const aiScene *scene, std::string shaderName)
         indexOffset += meshVertices.size();
     }
 
+    // Find bounds of combined mesh
+    if (!allVertices.empty())
+    {
+        boundsMin = allVertices[0].Position;
+        boundsMax = allVertices[0].Position;
+        for (const Vertex &vertex : allVertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+    }
+
     // Now create a single combined mesh
     Mesh combinedMesh = Mesh(allVertices, allIndices, shaderName);
 
@@ -445,6 +468,70 @@ void Model::combineMeshes(const aiScene *scene, std::string shaderName)
     meshes.push_back(combinedMesh); // Replace the old meshes with the combined one
 }
 
+void Model::generateOccluder()
+{
+    const int maxOccluderTriangles = 48;
+
+    occluderVertices.clear();
+    occluderBones.clear();
+
+    if (meshes.empty())
+    {
+        return;
+    }
+
+    const std::vector<Vertex> &vertices = meshes[0].vertices;
+    const std::vector<unsigned int> &indices = meshes[0].indices;
+
+    // Find single bone vertex is fully attached to, -1 if unskinned, -2 if blended
+    auto rigidBone = [](const Vertex &vertex)
+    {
+        int bone = -1;
+        for (int k = 0; k < 4; k++)
+        {
+            if (vertex.Weights[k] > 0.01f)
+            {
+                if (bone != -1 || vertex.Weights[k] < 0.99f)
+                {
+                    return -2;
+                }
+                bone = vertex.BoneIDs[k];
+            }
+        }
+        return bone;
+    };
+
+    // Collect rigid triangles with their area
+    std::vector<std::pair<float, int>> candidates;
+    for (int i = 0; i + 2 < indices.size(); i += 3)
+    {
+        int bone = rigidBone(vertices[indices[i]]);
+        if (bone == -2 || rigidBone(vertices[indices[i + 1]]) != bone || rigidBone(vertices[indices[i + 2]]) != bone)
+        {
+            continue;
+        }
+
+        glm::vec3 a = vertices[indices[i]].Position;
+        glm::vec3 b = vertices[indices[i + 1]].Position;
+        glm::vec3 c = vertices[indices[i + 2]].Position;
+        candidates.push_back({glm::length(glm::cross(b - a, c - a)), i});
+    }
+
+    // Keep largest triangles
+    int count = std::min((int)candidates.size(), maxOccluderTriangles);
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](const auto &a, const auto &b)
+                      { return a.first > b.first; });
+
+    for (int t = 0; t < count; t++)
+    {
+        int i = candidates[t].second;
+        occluderVertices.push_back(vertices[indices[i]].Position);
+        occluderVertices.push_back(vertices[indices[i + 1]].Position);
+        occluderVertices.push_back(vertices[indices[i + 2]].Position);
+        occluderBones.push_back(rigidBone(vertices[indices[i]]));
+    }
+}
+
 std::vector<Texture> Model::loadMaterialTexture(aiMaterial *mat, aiTextureType type, std::string typeName)
 {
     // Vector of textures to push to GPU
@@ -737,76 +824,60 @@ unsigned int Model::LoadSkyBoxTexture(SkyBoxData skybox)
     return textureID;
 }
 
-void Model::generateBoneTransforms()
-{
-
-    // Resize if matrix array not large enough
-    if (boneTransforms.size() != boneHierarchy.size())
-    {
-        boneTransforms.resize(boneHierarchy.size(), glm::mat4(1.0f));
-        boneOffsets.resize(boneHierarchy.size(), glm::mat4(1.0f));
-        boneInverseOffsets.resize(boneHierarchy.size(), glm::mat4(1.0f));
-    }
-
-    for (auto &rootBone : rootBones)
-    {
-        // Start recursion from the root bone, with identity matrix for the root's parent transform
-        generateBoneTransformsRecursive(rootBone);
-    }
-}
-
-void Model::generateBoneTransformsRecursive(Bone *bone)
+void Model::generateSkeleton()
 {
-    // Check if bone in range
-    if (bone->index < 0 || bone->index >= boneTransforms.size())
+    // Flat skeleton from bone tree, tree is not needed after this
+    std::vector<int> remap;
+    skeletonValid = skeleton.build(boneHierarchy, remap);
+    if (!skeletonValid)
     {
-        std::cerr << "Error: Bone index out of range: " << bone->index << ", with name: " << bone->name << std::endl;
-        return;
+        std::cerr << "Error: Bones do not form a tree in model: " << name << ", it can not be animated" << std::endl;
     }
 
-    boneInverseOffsets[bone->index] = glm::inverse(bone->offsetMatrix);
-
-    // Recursively update the transforms of the child bones
-    for (Bone *child : bone->children)
+    // Vertices take bones by palette index
+    for (Mesh &mesh : meshes)
     {
-        if (!child)
+        for (Vertex &vertex : mesh.vertices)
         {
-            continue; // Prevents null pointer access
+            for (int k = 0; k < 4; k++)
+            {
+                int bone = vertex.BoneIDs[k];
+                vertex.BoneIDs[k] = bone >= 0 && bone < remap.size() ? remap[bone] : 0;
+            }
         }
-        generateBoneTransformsRecursive(child);
     }
-}
 
-void Model::updateBoneTransforms()
-{
-    for (auto &rootBone : rootBones)
+    for (auto &[boneName, bone] : boneHierarchy)
     {
-        // Start recursion from the root bone, with identity matrix for the root's parent transform
-        updateBoneTransformsRecursive(rootBone, glm::mat4(1.0f), glm::mat4(1.0f));
+        delete bone;
     }
+    boneHierarchy.clear();
+    rootBones.clear();
 }
 
-void Model::updateBoneTransformsRecursive(Bone *bone, const glm::mat4 &parentTransform, const glm::mat4 &parentInverseOffset)
+void Model::generateClips(const aiScene *scene)
 {
-    // Check if bone in range
-    if (bone->index < 0 || bone->index >= boneTransforms.size())
+    clips.clear();
+    for (unsigned int i = 0; i < scene->mNumAnimations; i++)
     {
-        std::cerr << "Error: Bone index out of range: " << bone->index << ", with name: " << bone->name << std::endl;
-        return;
+        AnimationClip clip;
+        if (clip.bake(scene->mAnimations[i], scene->mRootNode, skeleton, clipKeyRate))
+        {
+            clips.push_back(std::move(clip));
+        }
     }
+}
 
-    // Update bone transform
-    boneTransforms[bone->index] = parentTransform * parentInverseOffset * bone->offsetMatrix * bone->transform;
-
-    // Recursively update the transforms of the child bones
-    for (Bone *child : bone->children)
+int Model::findClip(const std::string &clipName) const
+{
+    for (int i = 0; i < clips.size(); i++)
     {
-        if (!child)
+        if (clips[i].name == clipName)
         {
-            continue; // Prevents null pointer access
+            return i;
         }
-        updateBoneTransformsRecursive(child, boneTransforms[bone->index], boneInverseOffsets[bone->index]);
     }
+    return -1;
 }
 
 void Model::uploadToGPU()
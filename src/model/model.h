@@ -12,6 +12,9 @@
 #include <mutex>
 
 #include "mesh/mesh.h"
+#include "skeleton/skeleton.h"
+#include "animation_clip/animation_clip.h"
+#include "sail_cloth/sail_cloth.h"
 
 struct Texture
 {
@@ -71,16 +74,35 @@ public:
 
     void uploadToGPU();
 
-    // Local model data
+    // Bone tree of import, emptied once skeleton is built from it
     std::map<std::string, Bone *> boneHierarchy;
-    std::vector<glm::mat4> boneTransforms;
-    std::vector<glm::mat4> boneOffsets;
-    std::vector<glm::mat4> boneInverseOffsets;
     std::vector<Bone *> rootBones;
+
+    // Flat bones, shared by instances. Their poses are in the PoseArena of scene. Not valid if bones of
+    // import did not form a tree, model can not be animated then
+    Skeleton skeleton;
+    bool skeletonValid = true;
+
+    // Animations of import baked for skeleton, and index of named one, -1 if there is none
+    std::vector<AnimationClip> clips;
+    int findClip(const std::string &clipName) const;
+
+    // Sail of yacht models for cloth, invalid for others
+    SailShape sail;
+
+    // Local model data
     std::string path;
     std::string name;
     std::vector<Texture> textures;
 
+    // Bind pose bounds of all meshes
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+
+    // Largest rigid triangles, used as software occluder. Bone per triangle, -1 if none
+    std::vector<glm::vec3> occluderVertices;
+    std::vector<int> occluderBones;
+
     // Model map and load function
     static std::map<std::string, std::pair<std::string, ModelType>> modelMap;
     static void loadModelMap();
@@ -102,17 +124,19 @@ public:
     void processPendingTextures();
     static unsigned int LoadSkyBoxTexture(SkyBoxData skybox);
 
-    // Generate and update bones
-    void generateBoneTransforms();
-    void generateBoneTransformsRecursive(Bone *bone);
-    void updateBoneTransforms();
-    void updateBoneTransformsRecursive(Bone *bone, const glm::mat4 &parentTransform, const glm::mat4 &parentInverseOffset);
+    // Generate skeleton from bone tree, bone IDs of vertices follow its order
+    void generateSkeleton();
+
+    // Bake animations of import, keys per second of baked clips
+    void generateClips(const aiScene *scene);
+    static float clipKeyRate;
 
 private:
     void loadModel(std::string path, std::string shaderName);
     void processNode(aiNode *node, const aiScene *scene, std::string shaderName, Bone *parentBone = nullptr);
     Mesh processMesh(aiMesh *mesh, const aiScene *scene, std::string shaderName, std::map<std::string, Bone *> &boneHierarchy);
     void combineMeshes(const aiScene *scene, std::string shaderName);
+    void generateOccluder();
     std::vector<Texture> loadMaterialTexture(aiMaterial *mat, aiTextureType type, std::string typeName);
     std::string findTextureInDirectory(const std::string &directory, const std::string &typeName);
 
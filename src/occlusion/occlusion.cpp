@@ -0,0 +1,369 @@
+#include "occlusion/occlusion.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "camera/camera.h"
+
+// Occlusion buffer variables
+const float Occlusion::nearDepth = 0.1f;
+glm::mat4 Occlusion::viewProjection;
+std::vector<float> Occlusion::depthBuffer(Occlusion::width *Occlusion::height, FLT_MAX);
+int Occlusion::occluderTriangles = 0;
+
+// Write depth to pixels of row with center inside all three edges
+static void rasterizeSpan(float *row, int minX, int maxX, const float edgeA[3], const float rowEdge[3], float depth)
+{
+    int x = minX;
+
+#if defined(__AVX2__)
+    // 8 pixels at a time, width is multiple of 8 so aligned chunks stay in row
+    const __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 a0 = _mm256_set1_ps(edgeA[0]), a1 = _mm256_set1_ps(edgeA[1]), a2 = _mm256_set1_ps(edgeA[2]);
+    const __m256 r0 = _mm256_set1_ps(rowEdge[0]), r1 = _mm256_set1_ps(rowEdge[1]), r2 = _mm256_set1_ps(rowEdge[2]);
+    const __m256 triangleDepth = _mm256_set1_ps(depth);
+
+    for (x = minX & ~7; x <= maxX; x += 8)
+    {
+        __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+
+        // Edge functions at pixel centers
+        __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a0, px), r0);
+        __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a1, px), r1);
+        __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a2, px), r2);
+        __m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)), _mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+
+        // Keep closest depth where inside
+        __m256 current = _mm256_loadu_ps(row + x);
+        _mm256_storeu_ps(row + x, _mm256_blendv_ps(current, _mm256_min_ps(current, triangleDepth), inside));
+    }
+#elif defined(__SSE2__)
+    // 4 pixels at a time, width is multiple of 4 so aligned chunks stay in row
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 a0 = _mm_set1_ps(edgeA[0]), a1 = _mm_set1_ps(edgeA[1]), a2 = _mm_set1_ps(edgeA[2]);
+    const __m128 r0 = _mm_set1_ps(rowEdge[0]), r1 = _mm_set1_ps(rowEdge[1]), r2 = _mm_set1_ps(rowEdge[2]);
+    const __m128 triangleDepth = _mm_set1_ps(depth);
+
+    for (x = minX & ~3; x <= maxX; x += 4)
+    {
+        __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+
+        // Edge functions at pixel centers
+        __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+        __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+        __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+        // Keep closest depth where inside
+        __m128 current = _mm_loadu_ps(row + x);
+        __m128 updated = _mm_min_ps(current, triangleDepth);
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, updated), _mm_andnot_ps(inside, current)));
+    }
+#endif
+
+    // Scalar fallback
+    for (; x <= maxX; x++)
+    {
+        float px = x + 0.5f;
+        if (edgeA[0] * px + rowEdge[0] >= 0 && edgeA[1] * px + rowEdge[1] >= 0 && edgeA[2] * px + rowEdge[2] >= 0)
+        {
+            row[x] = std::min(row[x], depth);
+        }
+    }
+}
+
+// Check if any pixel of row is farther than depth
+static bool testSpan(const float *row, int minX, int maxX, float depth)
+{
+    int x = minX;
+
+#if defined(__AVX2__)
+    const __m256 laneIndices = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 first = _mm256_set1_ps((float)minX), last = _mm256_set1_ps((float)maxX);
+    const __m256 boxDepth = _mm256_set1_ps(depth);
+
+    for (x = minX & ~7; x <= maxX; x += 8)
+    {
+        __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneIndices);
+        __m256 inSpan = _mm256_and_ps(_mm256_cmp_ps(px, first, _CMP_GE_OQ), _mm256_cmp_ps(px, last, _CMP_LE_OQ));
+        __m256 farther = _mm256_cmp_ps(_mm256_loadu_ps(row + x), boxDepth, _CMP_GE_OQ);
+
+        if (_mm256_movemask_ps(_mm256_and_ps(inSpan, farther)))
+        {
+            return true;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128 laneIndices = _mm_setr_ps(0, 1, 2, 3);
+    const __m128 first = _mm_set1_ps((float)minX), last = _mm_set1_ps((float)maxX);
+    const __m128 boxDepth = _mm_set1_ps(depth);
+
+    for (x = minX & ~3; x <= maxX; x += 4)
+    {
+        __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneIndices);
+        __m128 inSpan = _mm_and_ps(_mm_cmpge_ps(px, first), _mm_cmple_ps(px, last));
+        __m128 farther = _mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth);
+
+        if (_mm_movemask_ps(_mm_and_ps(inSpan, farther)))
+        {
+            return true;
+        }
+    }
+#endif
+
+    // Scalar fallback
+    for (; x <= maxX; x++)
+    {
+        if (row[x] >= depth)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void Occlusion::clear()
+{
+    viewProjection = Camera::u_projection * Camera::u_view;
+    std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+    occluderTriangles = 0;
+}
+
+void Occlusion::rasterizeScene(Scene &scene)
+{
+    clear();
+
+    // Terrain tiles split into flat pieces at the lowest height under each, so they never hide more than the terrain.
+    // Pieces end on vertex lines and take one more vertex around for morphing
+    for (auto &grid : scene.grids)
+    {
+        glm::vec3 offset = glm::vec3(grid.u_model[3]);
+
+        for (int t = 0; t < grid.clipmap.tileRects.size(); t++)
+        {
+            const glm::vec4 &rect = grid.clipmap.tileRects[t];
+            float spacing = grid.clipmap.tileSpacings[t];
+            int cellsX = (int)std::round((rect.z - rect.x) / spacing);
+            int cellsY = (int)std::round((rect.w - rect.y) / spacing);
+            int stepX = grid.heightfield.loaded() ? std::max((cellsX + terrainSplit - 1) / terrainSplit, 1) : std::max(cellsX, 1);
+            int stepY = grid.heightfield.loaded() ? std::max((cellsY + terrainSplit - 1) / terrainSplit, 1) : std::max(cellsY, 1);
+
+            for (int y = 0; y < cellsY; y += stepY)
+            {
+                for (int x = 0; x < cellsX; x += stepX)
+                {
+                    glm::vec2 pieceMin = glm::vec2(offset) + glm::vec2(rect.x + x * spacing, rect.y + y * spacing);
+                    glm::vec2 pieceMax = glm::vec2(offset) + glm::vec2(rect.x + std::min(x + stepX, cellsX) * spacing,
+                                                                       rect.y + std::min(y + stepY, cellsY) * spacing);
+                    float z = grid.heightfield.loaded() ? grid.heightfield.minHeight(pieceMin - spacing, pieceMax + spacing) : offset.z;
+
+                    glm::vec3 a = glm::vec3(pieceMin.x, pieceMin.y, z);
+                    glm::vec3 b = glm::vec3(pieceMax.x, pieceMin.y, z);
+                    glm::vec3 c = glm::vec3(pieceMax.x, pieceMax.y, z);
+                    glm::vec3 d = glm::vec3(pieceMin.x, pieceMax.y, z);
+
+                    rasterizeTriangle(a, b, c);
+                    rasterizeTriangle(a, c, d);
+                }
+            }
+        }
+    }
+
+    // Large rigid parts of models in view
+    for (auto &model : scene.structModels)
+    {
+        glm::vec3 boxMin, boxMax;
+        model.getWorldBounds(boxMin, boxMax);
+
+        if (Camera::boxInFrustum(boxMin, boxMax))
+        {
+            rasterizeModel(model);
+        }
+    }
+}
+
+void Occlusion::rasterizeModel(const ModelData &model)
+{
+    const Model &source = *model.model;
+
+    for (int t = 0; t < source.occluderBones.size(); t++)
+    {
+        // Move triangle with its bone
+        glm::mat4 transform = model.u_model;
+        int bone = source.occluderBones[t];
+        if (model.animated && bone >= 0 && bone < model.boneCount)
+        {
+            transform = transform * model.boneTransforms[bone] * source.skeleton.inverseOffsets[bone];
+        }
+
+        glm::vec3 a = glm::vec3(transform * glm::vec4(source.occluderVertices[3 * t], 1.0f));
+        glm::vec3 b = glm::vec3(transform * glm::vec4(source.occluderVertices[3 * t + 1], 1.0f));
+        glm::vec3 c = glm::vec3(transform * glm::vec4(source.occluderVertices[3 * t + 2], 1.0f));
+
+        rasterizeTriangle(a, b, c);
+    }
+}
+
+void Occlusion::rasterizeTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c)
+{
+    glm::vec4 clip[3] = {
+        viewProjection * glm::vec4(a, 1.0f),
+        viewProjection * glm::vec4(b, 1.0f),
+        viewProjection * glm::vec4(c, 1.0f)};
+
+    rasterizeClipTriangle(clip);
+}
+
+glm::vec2 Occlusion::toScreen(const glm::vec4 &clip)
+{
+    return glm::vec2((clip.x / clip.w * 0.5f + 0.5f) * width, (clip.y / clip.w * 0.5f + 0.5f) * height);
+}
+
+void Occlusion::rasterizeClipTriangle(const glm::vec4 clip[3])
+{
+    // Clip against near plane, triangle becomes at most a quad
+    glm::vec4 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        const glm::vec4 &current = clip[i];
+        const glm::vec4 &next = clip[(i + 1) % 3];
+        bool currentIn = current.w >= nearDepth;
+        bool nextIn = next.w >= nearDepth;
+
+        if (currentIn)
+        {
+            polygon[count++] = current;
+        }
+        if (currentIn != nextIn)
+        {
+            float t = (nearDepth - current.w) / (next.w - current.w);
+            polygon[count++] = current + (next - current) * t;
+        }
+    }
+
+    if (count < 3)
+    {
+        return;
+    }
+
+    // Farthest depth of polygon, keeps occluder conservative
+    float depth = 0.0f;
+    for (int i = 0; i < count; i++)
+    {
+        depth = std::max(depth, polygon[i].w);
+    }
+
+    // Fan out polygon
+    glm::vec2 first = toScreen(polygon[0]);
+    for (int i = 1; i + 1 < count; i++)
+    {
+        rasterizeScreenTriangle(first, toScreen(polygon[i]), toScreen(polygon[i + 1]), depth);
+    }
+
+    occluderTriangles++;
+}
+
+void Occlusion::rasterizeScreenTriangle(glm::vec2 a, glm::vec2 b, glm::vec2 c, float depth)
+{
+    // Make winding counter clockwise, skip degenerate triangles
+    float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+    if (std::fabs(area) < 1e-6f)
+    {
+        return;
+    }
+    if (area < 0)
+    {
+        std::swap(b, c);
+    }
+
+    // Bounding rectangle on buffer
+    int minX = std::max(0, (int)std::floor(std::min({a.x, b.x, c.x})));
+    int maxX = std::min(width - 1, (int)std::ceil(std::max({a.x, b.x, c.x})));
+    int minY = std::max(0, (int)std::floor(std::min({a.y, b.y, c.y})));
+    int maxY = std::min(height - 1, (int)std::ceil(std::max({a.y, b.y, c.y})));
+
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    // Edge functions e = A * x + B * y + C, sampled at pixel centers
+    glm::vec2 vertices[3] = {a, b, c};
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (int i = 0; i < 3; i++)
+    {
+        glm::vec2 from = vertices[i];
+        glm::vec2 to = vertices[(i + 1) % 3];
+
+        edgeA[i] = -(to.y - from.y);
+        edgeB[i] = to.x - from.x;
+        edgeC[i] = (to.y - from.y) * from.x - (to.x - from.x) * from.y;
+
+        // Widen by a fraction of a pixel so rounding leaves no cracks along shared edges
+        edgeC[i] += (std::fabs(edgeA[i]) + std::fabs(edgeB[i])) / 64.0f;
+    }
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        float py = y + 0.5f;
+        float rowEdge[3] = {edgeB[0] * py + edgeC[0], edgeB[1] * py + edgeC[1], edgeB[2] * py + edgeC[2]};
+
+        rasterizeSpan(&depthBuffer[y * width], minX, maxX, edgeA, rowEdge, depth);
+    }
+}
+
+bool Occlusion::testBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax)
+{
+    glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+    float depth = FLT_MAX;
+
+    for (int i = 0; i < 8; i++)
+    {
+        glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+
+        // Box reaches past near plane, cannot be hidden
+        if (clip.w < nearDepth)
+        {
+            return true;
+        }
+
+        glm::vec2 screen = toScreen(clip);
+        screenMin = glm::min(screenMin, screen);
+        screenMax = glm::max(screenMax, screen);
+        depth = std::min(depth, clip.w);
+    }
+
+    // Pixels touched by box
+    int minX = std::max(0, (int)std::floor(screenMin.x));
+    int maxX = std::min(width - 1, (int)std::ceil(screenMax.x));
+    int minY = std::max(0, (int)std::floor(screenMin.y));
+    int maxY = std::min(height - 1, (int)std::ceil(screenMax.y));
+
+    // Fully off screen
+    if (minX > maxX || minY > maxY)
+    {
+        return false;
+    }
+
+    for (int y = minY; y <= maxY; y++)
+    {
+        if (testSpan(&depthBuffer[y * width], minX, maxX, depth))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,49 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "scene/scene.h"
+
+// Low resolution CPU depth buffer, filled with occluders and tested against before drawing
+class Occlusion
+{
+public:
+    // Buffer size, width multiple of SIMD lane count
+    static const int width = 256;
+    static const int height = 128;
+
+    // Closest depth in front of which nothing is hidden
+    static const float nearDepth;
+
+    // Terrain tile pieces per side, each flat at its lowest height
+    static const int terrainSplit = 4;
+
+    // Fill buffer with scene occluders for current view
+    static void rasterizeScene(Scene &scene);
+
+    // Occluder input, world space
+    static void clear();
+    static void rasterizeTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+    static void rasterizeModel(const ModelData &model);
+
+    // True if any part of box may be visible
+    static bool testBox(const glm::vec3 &boxMin, const glm::vec3 &boxMax);
+
+    // Stats of last frame
+    static int occluderTriangles;
+
+private:
+    static glm::mat4 viewProjection;
+
+    // View depth per pixel, smaller is closer
+    static std::vector<float> depthBuffer;
+
+    static void rasterizeClipTriangle(const glm::vec4 clip[3]);
+    static void rasterizeScreenTriangle(glm::vec2 a, glm::vec2 b, glm::vec2 c, float depth);
+    static glm::vec2 toScreen(const glm::vec4 &clip);
+};
+
+#endif
@@ -1,13 +1,14 @@
-#include <physics/physics.h>
+#include "physics/physics.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/vector_angle.hpp>
 
-#include "event_handler/event_handler.h"
-#include "render/render.h"
+#include <algorithm>
+#include <chrono>
 
-// Boolmap for input tracking
-bool Physics::keyInputs[5];
+// Queued keys, and inputs of current step
+InputQueue Physics::inputs;
+StepInput Physics::input;
 
 // World physics properties
 glm::vec3 Physics::windDirection = glm::vec3(0.0f, -1.0f, 0.0f);
@@ -15,16 +16,42 @@ float Physics::windStrength = 10.0f;
 float Physics::airDensity = 1.225f;
 float Physics::g = 9.81f;
 
-bool Physics::resetState = false;
-
-Physics::Physics(ModelData &ModelData)
+// Wind field of scene
+WindField Physics::wind;
+float Physics::time = 0.0f;
+
+float Physics::deltaTime = 0.0f;
+bool Physics::debug = false;
+PhysicsDebug Physics::debugData;
+
+// Fleet of scene
+Fleet Physics::fleet;
+Collision Physics::collision;
+Heightfield Physics::terrain;
+Ground Physics::ground;
+SimulationLod Physics::lod;
+Autopilot Physics::autopilot;
+SyncClient Physics::sync;
+Telemetry Physics::telemetry;
+std::atomic<bool> Physics::recordTelemetry = false;
+float Physics::fleetError = 0.0f;
+std::atomic<bool> Physics::validateFleet = false;
+
+// Snapshots of scene
+Snapshot Physics::startSnapshot;
+std::vector<Snapshot> Physics::history;
+int Physics::historySize = 40;
+int Physics::historyInterval = 60;
+float Physics::rewindTime = 5.0f;
+
+Physics::Physics(const std::string &modelPath)
 {
     // Set base transform to 1
     baseTransform = glm::mat4(1.0f);
 
     // Check which yacht, and apply correct properties
 
-    if (ModelData.model->path.find("dn-duvel") != std::string::npos)
+    if (modelPath.find("dn-duvel") != std::string::npos)
     {
         // Max control angles
         maxMastAngle = glm::radians(60.0f);
@@ -49,7 +76,7 @@ Physics::Physics(ModelData &ModelData)
         steeringAttenuation = 0.5f;
     }
 
-    else if (ModelData.model->path.find("red-piper") != std::string::npos)
+    else if (modelPath.find("red-piper") != std::string::npos)
     {
         // Max control angles
         maxMastAngle = glm::radians(60.0f);
@@ -74,7 +101,7 @@ Physics::Physics(ModelData &ModelData)
         steeringAttenuation = 0.45f;
     }
 
-    else if (ModelData.model->path.find("blue-piper") != std::string::npos)
+    else if (modelPath.find("blue-piper") != std::string::npos)
     {
         // Max control angles
         maxMastAngle = glm::radians(60.0f);
@@ -99,7 +126,7 @@ Physics::Physics(ModelData &ModelData)
         steeringAttenuation = 1.55f;
     }
 
-    else if (ModelData.model->path.find("sietske") != std::string::npos)
+    else if (modelPath.find("sietske") != std::string::npos)
     {
         // Max control angles
         maxMastAngle = glm::radians(60.0f);
@@ -148,6 +175,14 @@ Physics::Physics(ModelData &ModelData)
         maxSteeringAngle = 1.0f;
         steeringAttenuation = 1.0f;
     }
+
+    buildPolar();
+}
+
+void Physics::buildPolar()
+{
+    // Sail turns up to a tenth further than the boom
+    polar = Polar::get(maxLiftCoefficient, optimalAngle, minDragCoefficient, 1.1f * maxBoomAngle);
 }
 
 void Physics::reset()
@@ -162,62 +197,88 @@ void Physics::reset()
     wheelAngle = 0.0f;
 }
 
-void Physics::setup(Scene &scene)
+float Physics::stepWorld(PhysicsWorld &world, float time, float stepTime, const std::vector<int> &controlled, const bool keys[5],
+                         const SimulationView &view, SyncClient *sync, Physics *reference)
 {
-    // Setup all animated models
-    for (ModelData &model : scene.structModels)
+    Fleet &fleet = world.fleet;
+
+    // Wind field is in world, sample at world position of every yacht and turn into its placement axes
+    world.wind.update(time);
+    fleet.placeInWorld();
+    world.wind.sample(fleet.worldX.data(), fleet.worldY.data(), fleet.windX.data(), fleet.windY.data(), fleet.size());
+    fleet.windToPlacement();
+
+    // Inputs to fleet, autopilot for all yachts first, controlled ones take keys
+    world.autopilot.steer(fleet);
+    for (int index : controlled)
     {
-        if (model.animated)
-        {
-            model.physics.clear();
-            model.physics.push_back(new Physics(model));
-            model.physics[0]->reset();
-        }
+        fleet.sheetIn[index] = keys[0] ? 1.0f : 0.0f;
+        fleet.sheetOut[index] = keys[1] ? 1.0f : 0.0f;
+        fleet.steer[index] = (keys[2] ? 1.0f : 0.0f) - (keys[3] ? 1.0f : 0.0f);
+        fleet.push[index] = keys[4] ? 1.0f : 0.0f;
     }
-}
 
-void Physics::update(Scene &scene)
-{
-    // Move all controlled models
-    for (ModelData &model : scene.structModels)
+    // First controlled yacht is always near, and is the one checked against reference
+    int first = controlled.empty() ? -1 : controlled[0];
+    if (reference && first >= 0)
     {
-        if (model.controlled)
-        {
-            model.physics[0]->move();
-        }
+        fleet.store(first, *reference, false);
+        reference->move(glm::vec2(fleet.windX[first], fleet.windY[first]), keys, stepTime);
     }
-}
 
-void Physics::move()
-{
-    // Reset if needed
-    if (resetState)
+    // Step rates for this tick, then move all yachts
+    world.lod.plan(fleet, first, view);
+    fleet.step(stepTime);
+
+    // Compare fleet with reference step, before server state, contacts and ground change the fleet's
+    float error = 0.0f;
+    if (reference && first >= 0)
+    {
+        Physics stepped = *reference;
+        fleet.store(first, stepped, false);
+
+        error = std::max({std::fabs(stepped.forwardVelocity - reference->forwardVelocity),
+                          std::fabs(stepped.steeringAngle - reference->steeringAngle),
+                          std::fabs(stepped.SailAngle - reference->SailAngle),
+                          glm::length(glm::vec3(stepped.baseTransform[1] - reference->baseTransform[1])),
+                          glm::length(glm::vec3(stepped.baseTransform[3] - reference->baseTransform[3]))});
+    }
+
+    // Yachts of server put over local step, before contacts so own yacht bounces off them
+    if (sync && sync->connected())
     {
-        resetState = false;
-        this->reset();
+        sync->update(fleet);
     }
 
+    world.collision.step(fleet);
+    world.ground.step(fleet, world.terrain);
+
+    return error;
+}
+
+void Physics::move(glm::vec2 localWind, const bool keys[5], float stepTime)
+{
     // Acceleration from keys
     float forwardAcceleration = 0.0f;
     float steeringChange = 0.0f;
 
-    if (keyInputs[0])
+    if (keys[0])
     {
-        sailControlFactor += 1.f * EventHandler::deltaTime;
+        sailControlFactor += 1.f * stepTime;
     }
-    if (keyInputs[1])
+    if (keys[1])
     {
-        sailControlFactor -= 0.4f * EventHandler::deltaTime;
+        sailControlFactor -= 0.4f * stepTime;
     }
-    if (keyInputs[2])
+    if (keys[2])
     {
         steeringChange += steeringSmoothness * maxSteeringAngle;
     }
-    if (keyInputs[3])
+    if (keys[3])
     {
         steeringChange -= steeringSmoothness * maxSteeringAngle;
     }
-    if (keyInputs[4])
+    if (keys[4])
     {
         forwardAcceleration += 1.f;
     }
@@ -225,9 +286,13 @@ void Physics::move()
     // Clamp sail control
     sailControlFactor = std::clamp(sailControlFactor, 0.2f, 1.0f);
 
+    // Wind at yacht
+    glm::vec3 trueWind = glm::vec3(localWind, 0.0f);
+    glm::vec3 trueWindDirection = glm::normalize(trueWind);
+
     // Find new angles for sail
     glm::vec3 direction = glm::normalize(glm::vec3(baseTransform[1]));
-    float angleToWind = glm::orientedAngle(direction, -windDirection, glm::vec3(0.0f, 0.0f, 1.0f));
+    float angleToWind = glm::orientedAngle(direction, -trueWindDirection, glm::vec3(0.0f, 0.0f, 1.0f));
 
     // Apply angles to sail setup
     float targetMastAngle = (0.5f + sailControlFactor) / 1.5f * std::clamp(angleToWind, -maxMastAngle, maxMastAngle);
@@ -240,7 +305,7 @@ void Physics::move()
     SailAngle = BoomAngle * (1 + 0.1 * fabs(sin(angleToWind / 2)));
 
     // Apparent wind direction
-    glm::vec3 apparentWind = windDirection * windStrength - direction * forwardVelocity;
+    glm::vec3 apparentWind = trueWind - direction * forwardVelocity;
     float apparentWindSpeed = glm::length(apparentWind);
     glm::vec3 apparentWindDirection = glm::normalize(apparentWind);
 
@@ -295,52 +360,12 @@ void Physics::move()
     forwardAcceleration += netForce / mass;
 
     // Apply accelerations
-    forwardVelocity += forwardAcceleration * EventHandler::deltaTime;
-    steeringAngle += (steeringChange - steeringAngle * steeringSmoothness) * EventHandler::deltaTime;
+    forwardVelocity += forwardAcceleration * stepTime;
+    steeringAngle += (steeringChange - steeringAngle * steeringSmoothness) * stepTime;
     float effectiveSteeringAngle = steeringAngle / (1 + steeringAttenuation * forwardVelocity);
 
     // Transform with velocities
-    baseTransform *= glm::rotate(glm::mat4(1.0f), glm::radians(effectiveSteeringAngle * forwardVelocity * EventHandler::deltaTime), glm::vec3(0.0f, 0.0f, -1.0f));
-    baseTransform *= glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, forwardVelocity * EventHandler::deltaTime, 0.0f));
-    wheelAngle += forwardVelocity * EventHandler::deltaTime * 100;
-
-    // Send values to debug
-    Render::debugPhysicsData.push_back(std::pair("velocity", forwardVelocity));
-    Render::debugPhysicsData.push_back(std::pair("acceleration", forwardAcceleration));
-    Render::debugPhysicsData.push_back(std::pair("apparantWind", apparentWindSpeed));
-    Render::debugPhysicsData.push_back(std::pair("steeringAngle", steeringAngle));
-    Render::debugPhysicsData.push_back(std::pair("effectiveSteeringAngle", effectiveSteeringAngle));
-    Render::debugPhysicsData.push_back(std::pair("angleToWind", glm::degrees(angleToWind)));
-    Render::debugPhysicsData.push_back(std::pair("angleToApparentWind", glm::degrees(angleToApparentWind)));
-    Render::debugPhysicsData.push_back(std::pair("relativeAngle", glm::degrees(relativeSailAngle)));
-    Render::debugPhysicsData.push_back(std::pair("effectiveCL", effectiveCL));
-    Render::debugPhysicsData.push_back(std::pair("effectiveCD", effectiveCD));
+    baseTransform *= glm::rotate(glm::mat4(1.0f), glm::radians(effectiveSteeringAngle * forwardVelocity * stepTime), glm::vec3(0.0f, 0.0f, -1.0f));
+    baseTransform *= glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, forwardVelocity * stepTime, 0.0f));
+    wheelAngle += forwardVelocity * stepTime * 100;
 }
-
-void Physics::switchControlledYacht(Scene &scene)
-{
-    std::string current;
-
-    // Find current controlled yacht, and stop controlling it
-    for (auto &model : scene.structModels)
-    {
-        if (model.controlled && model.physics[0]->forwardVelocity <= 0.01f)
-        {
-            current = model.model->name;
-            model.controlled = false;
-        }
-    }
-
-    // Find id of current yacht in loaded yachts, increment by 1, overflow
-    int currentId = find(scene.loadedYachts.begin(), scene.loadedYachts.end(), current) - scene.loadedYachts.begin();
-    int newId = (currentId + 1) % scene.loadedYachts.size();
-
-    // Control new yacht
-    for (auto &model : scene.structModels)
-    {
-        if (model.model->name == scene.loadedYachts[newId])
-        {
-            model.controlled = true;
-        }
-    }
-}
\ No newline at end of file
@@ -3,28 +3,149 @@
 
 #include <glm/glm.hpp>
 
-#include "scene/scene.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "autopilot/autopilot.h"
+#include "collision/collision.h"
+#include "fleet/fleet.h"
+#include "frame/frame.h"
+#include "ground/ground.h"
+#include "heightfield/heightfield.h"
+#include "input_queue/input_queue.h"
+#include "polar/polar.h"
+#include "simulation_lod/simulation_lod.h"
+#include "snapshot/snapshot.h"
+#include "sync_client/sync_client.h"
+#include "telemetry/telemetry.h"
+#include "wind_field/wind_field.h"
+
+class Scene;
+struct ModelData;
+
+// Keys the simulation takes, as queued by callbacks. Held keys first, then single presses
+enum SimulationKey
+{
+    sheetInKey,
+    sheetOutKey,
+    steerLeftKey,
+    steerRightKey,
+    pushKey,
+    resetKey,
+    rewindKey,
+    switchKey
+};
+
+// Everything from outside the simulation that one step depends on
+struct StepInput
+{
+    // Held during step, sheet in to push in SimulationKey order
+    bool keys[5] = {false, false, false, false, false};
+    bool reset = false;
+    bool rewind = false;
+    bool switchYacht = false;
+
+    // Camera simulation tiers are picked for
+    SimulationView view;
+};
+
+// Yachts of a scene and everything acting on them. Game steps the Physics statics, each sim run its own
+struct PhysicsWorld
+{
+    WindField &wind;
+    Fleet &fleet;
+    Collision &collision;
+    const Heightfield &terrain;
+    Ground &ground;
+    SimulationLod &lod;
+    Autopilot &autopilot;
+};
 
 class Physics
 {
 public:
-    // Constructor
-    Physics(ModelData &ModelData);
-    static bool resetState;
+    // Default empty constructor
+    Physics() {};
 
-    // World variables
+    // Constructor, properties picked from yacht model path
+    Physics(const std::string &modelPath);
+
+    // Step time of simulation thread
+    static float deltaTime;
+
+    // World variables, wind is the mean of the wind field
     static glm::vec3 windDirection;
     static float windStrength;
     static float airDensity;
     static float g;
 
-    // Functions
+    // Local wind with gusts, and time it was moved to
+    static WindField wind;
+    static float time;
+
+    // All yachts of scene, stepped together, and their hull footprints
+    static Fleet fleet;
+    static Collision collision;
+
+    // Terrain of scene, flat without one, and runner contact of yachts with it
+    static Heightfield terrain;
+    static Ground ground;
+
+    // Step rate of yachts by distance to camera
+    static SimulationLod lod;
+
+    // Inputs for yachts the player does not control
+    static Autopilot autopilot;
+
+    // Connection to multiplayer server, other players' yachts come from it when joined
+    static SyncClient sync;
+
+    // Fleet state per tick to file while recording, toggled by main thread
+    static Telemetry telemetry;
+    static std::atomic<bool> recordTelemetry;
+
+    // Largest difference of fleet step to move() for controlled yacht, last validated step, includes polar lookup error
+    static float fleetError;
+
+    // Step controlled yacht with move() too and compare fleet step and polar lookups to it, written by main thread
+    static std::atomic<bool> validateFleet;
+
+    // One step of a world from time on, same in game and sim. Keys go to controlled yachts, first of them is always
+    // simulated near. With a reference, it steps with move() beside the first controlled yacht and the largest difference
+    // right after the fleet step is returned. Server yachts come in through sync when given
+    static float stepWorld(PhysicsWorld &world, float time, float stepTime, const std::vector<int> &controlled, const bool keys[5],
+                           const SimulationView &view, SyncClient *sync = nullptr, Physics *reference = nullptr);
+
+    // Scene of game, in physics_scene.cpp so the sim builds without the scene and renderer
     static void setup(Scene &scene);
     static void update(Scene &scene);
     static void switchControlledYacht(Scene &scene);
 
-    // Boolmap for tracking inputs
-    static bool keyInputs[5];
+    // Whole simulation state of scene, restored in place without loading the scene again. Restore of a
+    // snapshot of another scene returns false and changes nothing
+    static void save(Scene &scene, Snapshot &snapshot);
+    static bool restore(Scene &scene, Snapshot &snapshot);
+
+    // State at start of scene for reset, and last historySize states, one every historyInterval steps, for rewind
+    static Snapshot startSnapshot;
+    static std::vector<Snapshot> history;
+    static int historySize;
+    static int historyInterval;
+    static float rewindTime;
+
+    // Simulation keys from callbacks on main thread, taken at the step they came in during
+    static InputQueue inputs;
+
+    // Inputs of current step, from queued keys up to its end time so main thread can not change them halfway
+    static StepInput input;
+    static void takeInput(std::chrono::steady_clock::time_point stepEnd);
+
+    // Values for debug overlay, collected during step only while debug is set by simulation thread
+    static bool debug;
+    static PhysicsDebug debugData;
 
     // Velocity and steering variables
     glm::mat4 baseTransform;
@@ -56,8 +177,12 @@ public:
     float bodyDragCoefficient;
     float bodyArea;
 
-private:
-    void move();
+    // Sail coefficient tables, built from properties above
+    std::shared_ptr<const Polar> polar;
+    void buildPolar();
+
+    // Reference step for a single yacht with keys held over step, fleet kernel follows the same math
+    void move(glm::vec2 localWind, const bool keys[5], float stepTime);
     void reset();
 };
 
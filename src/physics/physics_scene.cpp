@@ -0,0 +1,388 @@
+#include "physics/physics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "scene/scene.h"
+
+// Keys held as of last step
+static bool heldKeys[5] = {false, false, false, false, false};
+
+// History ring, next slot and filled slots, and steps since setup
+static int historyNext = 0;
+static int historyCount = 0;
+static int historySteps = 0;
+
+// Layout check for restores, reused so restoring does not allocate
+static Snapshot scratchSnapshot;
+
+// Indices of controlled yachts, reused every step
+static std::vector<int> controlledYachts;
+
+void Physics::setup(Scene &scene)
+{
+    fleet.clear();
+    collision.clear();
+    ground.clear();
+    lod.clear();
+    autopilot.clear();
+
+    // Fleet changes, a recording goes on in a new file
+    telemetry.stop();
+
+    // Keys held in last scene are let go
+    std::fill(std::begin(heldKeys), std::end(heldKeys), false);
+
+    // Yachts stand on first grid with a heightmap
+    terrain = Heightfield();
+    for (GridData &grid : scene.grids)
+    {
+        if (grid.heightfield.loaded())
+        {
+            terrain = grid.heightfield;
+            break;
+        }
+    }
+
+    // Fresh wind field, keyframes made on worker thread
+    time = 0.0f;
+    wind.start(windDirection, windStrength, true);
+
+    // Setup all animated models
+    for (ModelData &model : scene.structModels)
+    {
+        if (model.animated)
+        {
+            model.physics.clear();
+            model.physics.push_back(new Physics(model.model->path));
+            model.physics[0]->reset();
+            model.fleetIndex = fleet.add(*model.physics[0], model.u_model);
+            collision.add(model.model->boundsMin, model.model->boundsMax, model.u_model);
+            ground.add(model.model->boundsMin, model.model->boundsMax, model.u_model);
+            lod.add(model.model->boundsMin, model.model->boundsMax, model.u_model);
+            autopilot.add();
+        }
+    }
+
+    // Course of scene for autopilot
+    autopilot.setCourse(scene.waypoints);
+
+    // Ask server for a yacht of this scene
+    if (sync.connected())
+    {
+        sync.join(scene.name, fleet.size());
+    }
+
+    // Start of race, and no history to rewind into yet
+    save(scene, startSnapshot);
+    history.resize(historySize);
+    historyNext = 0;
+    historyCount = 0;
+    historySteps = 0;
+}
+
+void Physics::save(Scene &scene, Snapshot &snapshot)
+{
+    snapshot.begin();
+
+    // World and wind, wind field follows from these and time
+    snapshot.write(time);
+    snapshot.write(windDirection);
+    snapshot.write(windStrength);
+
+    fleet.save(snapshot);
+    collision.save(snapshot);
+    autopilot.save(snapshot);
+    lod.save(snapshot);
+
+    // Controlled yacht, camera follows it
+    for (ModelData &model : scene.structModels)
+    {
+        if (model.animated)
+        {
+            snapshot.write((uint8_t)model.controlled);
+        }
+    }
+}
+
+bool Physics::restore(Scene &scene, Snapshot &snapshot)
+{
+    // Same layout as this scene, so reading can not fail halfway
+    save(scene, scratchSnapshot);
+    if (snapshot.data.size() != scratchSnapshot.data.size() || !snapshot.open())
+    {
+        return false;
+    }
+
+    glm::vec3 savedDirection;
+    float savedStrength;
+    snapshot.read(time);
+    snapshot.read(savedDirection);
+    snapshot.read(savedStrength);
+
+    fleet.restore(snapshot);
+    collision.restore(snapshot);
+    autopilot.restore(snapshot);
+    lod.restore(snapshot);
+
+    for (ModelData &model : scene.structModels)
+    {
+        if (model.animated)
+        {
+            uint8_t controlled;
+            snapshot.read(controlled);
+            model.controlled = controlled;
+        }
+    }
+
+    // Other mean wind makes a new field, same one only moves to time
+    if (savedDirection != windDirection || savedStrength != windStrength)
+    {
+        windDirection = savedDirection;
+        windStrength = savedStrength;
+        wind.start(windDirection, windStrength, true);
+    }
+    wind.seek(time);
+
+    // Physics objects and poses follow restored fleet
+    for (ModelData &model : scene.structModels)
+    {
+        if (model.animated)
+        {
+            fleet.store(model.fleetIndex, *model.physics[0]);
+        }
+    }
+
+    return true;
+}
+
+void Physics::takeInput(std::chrono::steady_clock::time_point stepEnd)
+{
+    input.reset = false;
+    input.rewind = false;
+    input.switchYacht = false;
+    bool tapped[5] = {false, false, false, false, false};
+
+    // Keys up to end of this step, later ones wait for the step they fall in
+    TimedInput queued;
+    while (inputs.peek(queued) && queued.time <= stepEnd)
+    {
+        inputs.pop();
+
+        // Let go of everything, and drop requests taken so far
+        if (queued.type == timedRelease)
+        {
+            std::fill(std::begin(heldKeys), std::end(heldKeys), false);
+            std::fill(std::begin(tapped), std::end(tapped), false);
+            input.reset = false;
+            input.rewind = false;
+            input.switchYacht = false;
+            continue;
+        }
+
+        if (queued.key <= pushKey)
+        {
+            heldKeys[queued.key] = queued.pressed;
+            tapped[queued.key] |= queued.pressed;
+        }
+        else if (queued.pressed && !queued.repeat)
+        {
+            input.reset |= queued.key == resetKey;
+            input.rewind |= queued.key == rewindKey;
+            input.switchYacht |= queued.key == switchKey;
+        }
+    }
+
+    // Held at end of step, or pressed within it, so a tap shorter than a step still counts
+    for (int i = 0; i < 5; i++)
+    {
+        input.keys[i] = heldKeys[i] || tapped[i];
+    }
+    input.view = lod.takeView();
+}
+
+void Physics::update(Scene &scene)
+{
+    // Restart race, or go back to state of some seconds ago, newest of those stays in history
+    if (input.reset)
+    {
+        restore(scene, startSnapshot);
+        historyNext = 0;
+        historyCount = 0;
+    }
+    else if (input.rewind && historyCount > 0)
+    {
+        int back = std::clamp((int)std::ceil(rewindTime / (historyInterval * deltaTime)), 1, historyCount);
+        int slot = (historyNext - back + historySize) % historySize;
+        restore(scene, history[slot]);
+        historyNext = (slot + 1) % historySize;
+        historyCount -= back - 1;
+    }
+
+    // Online the server picks the yacht, and every other one is another player's or its autopilot
+    if (sync.joined())
+    {
+        for (ModelData &model : scene.structModels)
+        {
+            model.controlled = model.animated && model.fleetIndex == sync.slot;
+        }
+    }
+    else if (input.switchYacht)
+    {
+        switchControlledYacht(scene);
+    }
+
+    // Controlled yachts take keys, first one steps on its own too while validating, to check fleet against
+    Physics reference;
+    controlledYachts.clear();
+    for (ModelData &model : scene.structModels)
+    {
+        if (model.animated && model.controlled)
+        {
+            if (controlledYachts.empty())
+            {
+                reference = *model.physics[0];
+            }
+            controlledYachts.push_back(model.fleetIndex);
+        }
+    }
+    int controlledIndex = controlledYachts.empty() ? -1 : controlledYachts[0];
+    bool validating = validateFleet && controlledIndex >= 0;
+
+    // Same step as sim
+    PhysicsWorld world = {wind, fleet, collision, terrain, ground, lod, autopilot};
+    float error = stepWorld(world, time, deltaTime, controlledYachts, input.keys, input.view, &sync, validating ? &reference : nullptr);
+    time += deltaTime;
+
+    // Keep state every few steps to rewind to
+    if (++historySteps % historyInterval == 0)
+    {
+        save(scene, history[historyNext]);
+        historyNext = (historyNext + 1) % historySize;
+        historyCount = std::min(historyCount + 1, historySize);
+    }
+
+    // Start or stop recording here, only this thread appends to telemetry
+    if (recordTelemetry != telemetry.recording())
+    {
+        if (recordTelemetry)
+        {
+            auto seconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+            recordTelemetry = telemetry.start("telemetry-" + std::to_string(seconds) + ".bin");
+        }
+        else
+        {
+            telemetry.stop();
+        }
+    }
+    if (telemetry.recording())
+    {
+        telemetry.record(fleet, time);
+    }
+
+    // Hand new state to physics objects for animation
+    for (ModelData &model : scene.structModels)
+    {
+        if (model.animated)
+        {
+            fleet.store(model.fleetIndex, *model.physics[0]);
+        }
+    }
+
+    if (validating)
+    {
+        fleetError = error;
+    }
+
+    // Overlay values, only while it is shown
+    if (!debug)
+    {
+        return;
+    }
+
+    debugData.lodNear = lod.tierCounts[nearTier];
+    debugData.lodMid = lod.tierCounts[midTier];
+    debugData.lodFar = lod.tierCounts[farTier];
+    debugData.contacts = collision.contacts;
+
+    debugData.connected = sync.connected();
+    if (debugData.connected)
+    {
+        debugData.netRoundTrip = sync.roundTrip;
+        debugData.netBytesIn = sync.bytesIn;
+        debugData.netBytesOut = sync.bytesOut;
+        debugData.netLost = sync.lost;
+    }
+
+    debugData.recording = telemetry.recording();
+    debugData.telemetryDropped = telemetry.dropped;
+
+    if (controlledIndex < 0)
+    {
+        return;
+    }
+
+    // Controlled yacht as fleet stepped it, and wind and ground under it
+    int i = controlledIndex;
+    debugData.controlled = true;
+    debugData.velocity = fleet.velocity[i];
+    debugData.acceleration = fleet.acceleration[i];
+    debugData.apparentWind = fleet.apparentWindSpeed[i];
+    debugData.steeringAngle = fleet.steeringAngle[i];
+    debugData.effectiveSteeringAngle = fleet.effectiveSteeringAngle[i];
+    debugData.angleToWind = glm::degrees(fleet.angleToWind[i]);
+    debugData.angleToApparentWind = glm::degrees(fleet.angleToApparentWind[i]);
+    debugData.relativeAngle = glm::degrees(fleet.angleToApparentWind[i] - fleet.sailAngle[i]);
+    debugData.effectiveCL = fleet.liftCoefficient[i];
+    debugData.effectiveCD = fleet.dragCoefficient[i];
+    debugData.localWind = glm::length(glm::vec2(fleet.windX[i], fleet.windY[i]));
+    debugData.groundPitch = glm::degrees(fleet.groundPitch[i]);
+    debugData.groundRoll = glm::degrees(fleet.groundRoll[i]);
+
+    debugData.validating = validating;
+    if (validating)
+    {
+        debugData.fleetError = fleetError;
+
+        // Polar lookup against analytic at the angles of this step
+        float angle = fleet.angleToApparentWind[i];
+        float sail = fleet.sailAngle[i];
+        float tableLift, tableDrag, tableDrive;
+        float lift, drag, drive;
+        reference.polar->lookup(angle, sail, tableLift, tableDrag, tableDrive);
+        reference.polar->evaluate(angle, sail, lift, drag, drive);
+
+        debugData.polarLiftError = std::fabs(tableLift - lift);
+        debugData.polarDragError = std::fabs(tableDrag - drag);
+        debugData.polarDriveError = std::fabs(tableDrive - drive);
+    }
+}
+
+void Physics::switchControlledYacht(Scene &scene)
+{
+    std::string current;
+
+    // Find current controlled yacht, and stop controlling it
+    for (auto &model : scene.structModels)
+    {
+        if (model.controlled && model.physics[0]->forwardVelocity <= 0.01f)
+        {
+            current = model.model->name;
+            model.controlled = false;
+        }
+    }
+
+    // Find id of current yacht in loaded yachts, increment by 1, overflow
+    int currentId = find(scene.loadedYachts.begin(), scene.loadedYachts.end(), current) - scene.loadedYachts.begin();
+    int newId = (currentId + 1) % scene.loadedYachts.size();
+
+    // Control new yacht
+    for (auto &model : scene.structModels)
+    {
+        if (model.model->name == scene.loadedYachts[newId])
+        {
+            model.controlled = true;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "polar/polar.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    const float pi = 3.14159265f;
+}
+
+std::mutex Polar::cacheMutex;
+std::vector<std::shared_ptr<const Polar>> Polar::cache;
+
+std::shared_ptr<const Polar> Polar::get(float maxLiftCoefficient, float optimalAngle, float minDragCoefficient, float maxSailAngle)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    // Reuse polar of yacht type with the same sail
+    for (const std::shared_ptr<const Polar> &polar : cache)
+    {
+        if (polar->maxLiftCoefficient == maxLiftCoefficient && polar->optimalAngle == optimalAngle &&
+            polar->minDragCoefficient == minDragCoefficient && polar->maxSailAngle == maxSailAngle)
+        {
+            return polar;
+        }
+    }
+
+    cache.push_back(std::make_shared<const Polar>(maxLiftCoefficient, optimalAngle, minDragCoefficient, maxSailAngle));
+    return cache.back();
+}
+
+Polar::Polar(float maxLiftCoefficient, float optimalAngle, float minDragCoefficient, float maxSailAngle)
+    : maxLiftCoefficient(maxLiftCoefficient), optimalAngle(optimalAngle), minDragCoefficient(minDragCoefficient), maxSailAngle(maxSailAngle)
+{
+    // Sail axis covers every relative angle the sail can reach, with the lift peak on a grid line
+    float maxRelativeAngle = pi + maxSailAngle;
+    int stepsToOptimal = std::max(1, (int)((sailCount - 1) / 2 * optimalAngle / maxRelativeAngle));
+    sailStep = optimalAngle / stepsToOptimal;
+
+    data.resize(3 * cellCount);
+
+    // Sample analytic coefficients on grid
+    for (int i = 0; i < angleCount; i++)
+    {
+        float angle = -pi + 2.0f * pi * i / (angleCount - 1);
+        for (int j = 0; j < sailCount; j++)
+        {
+            float relativeSailAngle = (j - (sailCount - 1) / 2) * sailStep;
+            int cell = i * sailCount + j;
+            evaluate(angle, angle - relativeSailAngle, data[cell], data[cellCount + cell], data[2 * cellCount + cell]);
+        }
+    }
+}
+
+void Polar::evaluate(float angleToApparentWind, float sailAngle, float &lift, float &drag, float &drive) const
+{
+    float relativeSailAngle = angleToApparentWind - sailAngle;
+    float absAngle = std::fabs(relativeSailAngle);
+
+    lift = (absAngle <= optimalAngle ? maxLiftCoefficient * (relativeSailAngle / optimalAngle) * std::sin(2.0f * absAngle) / std::sin(2.0f * optimalAngle) : maxLiftCoefficient * (optimalAngle / absAngle) * (relativeSailAngle < 0 ? -1.0f : 1.0f));
+    drag = minDragCoefficient + std::sin(absAngle) * std::sin(absAngle);
+
+    // Forward force per dynamic pressure and sail area
+    drive = lift * std::sin(angleToApparentWind) - drag * std::cos(angleToApparentWind);
+}
+
+void Polar::lookup(float angleToApparentWind, float sailAngle, float &lift, float &drag, float &drive) const
+{
+    // Grid coordinates, clamped to table
+    float u = std::clamp((angleToApparentWind + pi) * ((angleCount - 1) / (2.0f * pi)), 0.0f, angleCount - 1.0f);
+    float v = std::clamp((angleToApparentWind - sailAngle) / sailStep + (sailCount - 1) / 2, 0.0f, sailCount - 1.0f);
+    int i = std::min((int)u, angleCount - 2);
+    int j = std::min((int)v, sailCount - 2);
+    float fu = u - i, fv = v - j;
+
+    // Weights of the four surrounding samples
+    int cell = i * sailCount + j;
+    float w00 = (1.0f - fu) * (1.0f - fv), w01 = (1.0f - fu) * fv;
+    float w10 = fu * (1.0f - fv), w11 = fu * fv;
+
+    const float *table[3] = {&data[cell], &data[cellCount + cell], &data[2 * cellCount + cell]};
+    float *out[3] = {&lift, &drag, &drive};
+    for (int t = 0; t < 3; t++)
+    {
+        const float *c = table[t];
+        *out[t] = w00 * c[0] + w01 * c[1] + w10 * c[sailCount] + w11 * c[sailCount + 1];
+    }
+}
+
+void Polar::validate(float &liftError, float &dragError, float &driveError) const
+{
+    liftError = 0.0f;
+    dragError = 0.0f;
+    driveError = 0.0f;
+
+    // Four samples per grid step, so centres and edges of cells are covered
+    const int steps = 4;
+    int sailSamples = (int)std::ceil(2.0f * maxSailAngle / sailStep) * steps;
+    for (int i = 0; i < (angleCount - 1) * steps; i++)
+    {
+        float angle = -pi + 2.0f * pi * (i + 0.5f) / ((angleCount - 1) * steps);
+        for (int j = 0; j < sailSamples; j++)
+        {
+            float sail = -maxSailAngle + 2.0f * maxSailAngle * (j + 0.5f) / sailSamples;
+
+            float tableLift, tableDrag, tableDrive;
+            float lift, drag, drive;
+            lookup(angle, sail, tableLift, tableDrag, tableDrive);
+            evaluate(angle, sail, lift, drag, drive);
+
+            liftError = std::max(liftError, std::fabs(tableLift - lift));
+            dragError = std::max(dragError, std::fabs(tableDrag - drag));
+            driveError = std::max(driveError, std::fabs(tableDrive - drive));
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef POLAR_H
+#define POLAR_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Sail coefficients over apparent wind angle and sail angle, precomputed for bilinear lookup
+class Polar
+{
+public:
+    // Grid size, apparent wind angle over [-pi, pi] and sail angle stored relative to it, centred on 0
+    static const int angleCount = 73;
+    static const int sailCount = 129;
+    static const int cellCount = angleCount * sailCount;
+
+    // Polar shared by all yachts with the same sail properties, built on first use
+    static std::shared_ptr<const Polar> get(float maxLiftCoefficient, float optimalAngle, float minDragCoefficient, float maxSailAngle);
+
+    Polar(float maxLiftCoefficient, float optimalAngle, float minDragCoefficient, float maxSailAngle);
+
+    // Sail properties the tables were built from
+    float maxLiftCoefficient;
+    float optimalAngle;
+    float minDragCoefficient;
+    float maxSailAngle;
+
+    // Relative sail angle per grid step, optimal angle is a whole number of steps
+    float sailStep;
+
+    // Lift, drag and drive coefficient tables after each other, sail angle is the fastest index
+    std::vector<float> data;
+
+    // Bilinear lookup from tables
+    void lookup(float angleToApparentWind, float sailAngle, float &lift, float &drag, float &drive) const;
+
+    // Analytic coefficients, same as Physics::move
+    void evaluate(float angleToApparentWind, float sailAngle, float &lift, float &drag, float &drive) const;
+
+    // Largest difference of lookup to analytic over all sail angles, sampled between grid points
+    void validate(float &liftError, float &dragError, float &driveError) const;
+
+private:
+    static std::mutex cacheMutex;
+    static std::vector<std::shared_ptr<const Polar>> cache;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "pose_arena/pose_arena.h"
+
+int PoseArena::add(const Skeleton &skeleton)
+{
+    int start = globals.size();
+    locals.resize(start + skeleton.size(), glm::mat4(1.0f));
+    globals.resize(start + skeleton.size(), glm::mat4(1.0f));
+
+    // Identity locals give bind pose
+    pose(skeleton, start);
+    return start;
+}
+
+void PoseArena::clear()
+{
+    locals.clear();
+    globals.clear();
+}
+
+void PoseArena::pose(const Skeleton &skeleton, int start)
+{
+    skeleton.pose(locals.data() + start, globals.data() + start);
+}
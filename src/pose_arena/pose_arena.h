@@ -0,0 +1,29 @@
+#ifndef POSE_ARENA_H
+#define POSE_ARENA_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "skeleton/skeleton.h"
+
+// Bone poses of all animated instances in one block, each instance owns a slice of skeleton size
+// at a fixed start. Instances of a shared model each keep their own pose, and a whole scene's poses
+// are copied or blended as one array
+class PoseArena
+{
+public:
+    // Slice for an instance of skeleton in bind pose, returns its start
+    int add(const Skeleton &skeleton);
+    void clear();
+    int size() const { return globals.size(); }
+
+    // Globals of slice from its locals, in one pass over skeleton
+    void pose(const Skeleton &skeleton, int start);
+
+    // Local and global transform per bone, slices back to back in order added
+    std::vector<glm::mat4> locals;
+    std::vector<glm::mat4> globals;
+};
+
+#endif
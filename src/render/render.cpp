@@ -8,6 +8,8 @@
 #include "frame_buffer/frame_buffer.h"
 #include "camera/camera.h"
 #include "scene_manager/scene_manager.h"
+#include "occlusion/occlusion.h"
+#include "skinning/skinning.h"
 
 // Global variables for quads
 unsigned int Render::quadVAO = 0, Render::quadVBO = 0;
@@ -18,12 +20,18 @@ float Render::waterHeight = 0.25;
 bool Render::WaterPass = true;
 
 // Render states
-bool Render::debugPhysics = false;
-std::vector<std::pair<std::string, float>> Render::debugPhysicsData;
+std::atomic<bool> Render::debugPhysics = false;
+PhysicsDebug Render::debugPhysicsData;
 bool Render::debugRender = false;
 std::vector<std::tuple<std::string, int, int>> Render::debugRenderData;
 glm::vec3 debugColor(1.0f, 0.1f, 0.1f);
 
+// Occlusion culling variables
+OcclusionMode Render::occlusionMode = noOcclusion;
+unsigned int Render::boundsVAO = 0;
+std::vector<int> Render::modelOrder;
+int Render::occludedModels = 0;
+
 glm::vec4 Render::clipPlane(0, 0, 0, 0);
 
 FT_Library Render::ft;
@@ -44,6 +52,9 @@ void Render::setup()
 {
     Render::initQuad();
     Render::initFreeType();
+
+    // Unit cube for occlusion bounds
+    boundsVAO = Mesh::setupSkyBoxMesh();
 }
 
 void Render::initQuad()
@@ -87,6 +98,11 @@ void Render::render(Scene &scene)
 
     UpdateRenderTiming("Skybox");
 
+    // Skin animated models once for all passes below
+    Skinning::skin(scene, waterHeight);
+
+    UpdateRenderTiming("Skinning");
+
     // If water loaded, render buffers
     if (Shader::waterLoaded)
     {
@@ -100,13 +116,13 @@ void Render::render(Scene &scene)
     // Reset clip plane
     clipPlane = {0, 0, 0, 0};
 
-    // Render rest of scene
+    // Render rest of scene, static occluders first
+    renderSceneGrids(scene, clipPlane);
+    UpdateRenderTiming("Grids");
     renderSceneModels(scene, clipPlane);
     UpdateRenderTiming("Models");
     renderSceneUnitPlanes(scene, clipPlane);
     UpdateRenderTiming("Planes");
-    renderSceneGrids(scene, clipPlane);
-    UpdateRenderTiming("Grids");
     renderSceneTexts(scene);
     UpdateRenderTiming("Text");
 
@@ -126,31 +142,162 @@ void Render::render(Scene &scene)
             debugText = debugText + std::get<0>(entry) + ":\nCPU: " + std::to_string(std::get<1>(entry)) + "\nGPU: " + std::to_string(std::get<2>(entry)) + "\n";
         }
 
+        debugText = debugText + "Skinned Models (Pre-pass" + (Skinning::reuse ? "" : ", every frame") + "): " + std::to_string(Skinning::skinnedModels) + "\n";
+
+        if (occlusionMode == queryOcclusion)
+        {
+            debugText = debugText + "Occluded Models (Queries): " + std::to_string(occludedModels) + "/" + std::to_string(scene.structModels.size()) + "\n";
+        }
+        else if (occlusionMode == rasterOcclusion)
+        {
+            debugText = debugText + "Occluded Models (Raster): " + std::to_string(occludedModels) + "/" + std::to_string(scene.structModels.size()) + "\n";
+            debugText = debugText + "Occluder Triangles: " + std::to_string(Occlusion::occluderTriangles) + "\n";
+        }
+
+        for (auto &grid : scene.grids)
+        {
+            debugText = debugText + "Terrain Tiles: " + std::to_string(grid.clipmap.drawnTiles) + " drawn, " + std::to_string(grid.clipmap.culledTiles) + " culled\n";
+        }
+
         renderText(debugText, 0.01f, 0.01f, 0.75f, debugColor);
     }
 
     // Render physics debug
     if (debugPhysics && !SceneManager::onTitleScreen)
     {
+        const PhysicsDebug &data = debugPhysicsData;
         std::string debugText = "Physics:\n";
+        auto line = [&](const char *name, float value)
+        {
+            debugText = debugText + name + ": " + std::to_string(value) + "\n";
+        };
 
-        for (auto entry : debugPhysicsData)
+        if (data.controlled)
+        {
+            line("velocity", data.velocity);
+            line("acceleration", data.acceleration);
+            line("apparantWind", data.apparentWind);
+            line("steeringAngle", data.steeringAngle);
+            line("effectiveSteeringAngle", data.effectiveSteeringAngle);
+            line("angleToWind", data.angleToWind);
+            line("angleToApparentWind", data.angleToApparentWind);
+            line("relativeAngle", data.relativeAngle);
+            line("effectiveCL", data.effectiveCL);
+            line("effectiveCD", data.effectiveCD);
+            line("localWind", data.localWind);
+            line("groundPitch", data.groundPitch);
+            line("groundRoll", data.groundRoll);
+        }
+        if (data.validating)
+        {
+            line("fleetError", data.fleetError);
+            line("polarLiftError", data.polarLiftError);
+            line("polarDragError", data.polarDragError);
+            line("polarDriveError", data.polarDriveError);
+        }
+        line("lodNear", data.lodNear);
+        line("lodMid", data.lodMid);
+        line("lodFar", data.lodFar);
+        line("contacts", data.contacts);
+        if (data.connected)
+        {
+            line("netRoundTrip", data.netRoundTrip);
+            line("netBytesIn", data.netBytesIn);
+            line("netBytesOut", data.netBytesOut);
+            line("netLost", data.netLost);
+        }
+        if (data.recording)
         {
-            debugText = debugText + entry.first + ": " + std::to_string(entry.second) + "\n";
+            line("telemetryDropped", data.telemetryDropped);
         }
+        line("posesUpdated", data.posesUpdated);
+        line("posesDeferred", data.posesDeferred);
+        line("sailsSimulated", data.sailsSimulated);
+        line("droppedSteps", data.droppedSteps);
 
         renderText(debugText, 0.01f, 0.01f, 1, debugColor);
     }
 
     Camera::cameraMoved = false;
     debugRenderData.clear();
-    debugPhysicsData.clear();
 }
 
 void Render::renderSceneModels(Scene &scene, glm::vec4 clipPlane)
 {
-    for (auto model : scene.structModels)
+    // Occlusion only in main pass, water passes see the scene from elsewhere
+    bool occlusionTest = occlusionMode == queryOcclusion && !WaterPass;
+    bool occlusionRaster = occlusionMode == rasterOcclusion && !WaterPass;
+
+    // Render order of models, front to back when testing occlusion
+    modelOrder.resize(scene.structModels.size());
+    for (int i = 0; i < modelOrder.size(); i++)
+    {
+        modelOrder[i] = i;
+    }
+
+    if (occlusionTest || occlusionRaster)
+    {
+        occludedModels = 0;
+
+        glm::vec3 cameraPosition = Camera::getPosition();
+        std::sort(modelOrder.begin(), modelOrder.end(), [&](int a, int b)
+                  {
+                      float distA = glm::distance(cameraPosition, glm::vec3(scene.structModels[a].u_model[3]));
+                      float distB = glm::distance(cameraPosition, glm::vec3(scene.structModels[b].u_model[3]));
+                      return distA < distB; // Sort by distance: closest first
+                  });
+    }
+
+    // Fill CPU depth buffer with terrain and large parts of models
+    if (occlusionRaster)
     {
+        Occlusion::rasterizeScene(scene);
+    }
+
+    for (int index : modelOrder)
+    {
+        ModelData &model = scene.structModels[index];
+
+        // Nothing is hidden without occlusion, skinning pre-pass reads this next frame
+        if (occlusionMode == noOcclusion)
+        {
+            model.occluded = false;
+        }
+
+        // Test bounds against depth drawn so far, skip if hidden last frame
+        bool conditional = false;
+        if (occlusionTest)
+        {
+            conditional = testOcclusion(model);
+
+            if (model.occluded)
+            {
+                occludedModels++;
+                continue;
+            }
+        }
+
+        // Test bounds against CPU depth buffer, skip before any GL work
+        if (occlusionRaster)
+        {
+            glm::vec3 boxMin, boxMax;
+            model.getWorldBounds(boxMin, boxMax);
+
+            model.occluded = !Camera::boxInFrustum(boxMin, boxMax) || !Occlusion::testBox(boxMin, boxMax);
+            if (model.occluded)
+            {
+                occludedModels++;
+                continue;
+            }
+        }
+
+        // Animated models the pre-pass left out are out of view or were hidden last frame, their shaders can not
+        // pose them. One that shows again in main pass is skinned right away instead of missing a frame
+        if (Skinning::skins(model) && !model.skinned && (WaterPass || !Skinning::skinLate(scene, model)))
+        {
+            continue;
+        }
+
         Shader *shader = Shader::load(model.shader);
 
         // Send light and view position to relevant shader
@@ -169,18 +316,88 @@ void Render::renderSceneModels(Scene &scene, glm::vec4 clipPlane)
 
         shader->setVec4("location_plane", clipPlane);
 
-        // Set animation state and bone stuff
-        shader->setBool("animated", model.animated);
-        if (model.animated)
+        // Let GPU drop the draw if this frame's bounds test found no samples
+        if (conditional)
         {
-            shader->setMat4Array("u_boneTransforms", model.model->boneTransforms);
-            shader->setMat4Array("u_inverseOffsets", model.model->boneInverseOffsets);
+            glBeginConditionalRender(model.occlusionQuery, GL_QUERY_WAIT);
         }
 
         renderModel(model);
+
+        if (conditional)
+        {
+            glEndConditionalRender();
+        }
     }
 }
 
+bool Render::testOcclusion(ModelData &model)
+{
+    // Create query on first use
+    if (model.occlusionQuery == 0)
+    {
+        glGenQueries(1, &model.occlusionQuery);
+    }
+
+    // Pick up result of earlier query if ready, never wait for it
+    if (model.occlusionPending)
+    {
+        GLint available = 0;
+        glGetQueryObjectiv(model.occlusionQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available)
+        {
+            return false;
+        }
+
+        GLuint samplesPassed = 0;
+        glGetQueryObjectuiv(model.occlusionQuery, GL_QUERY_RESULT, &samplesPassed);
+        model.occluded = (samplesPassed == 0);
+        model.occlusionPending = false;
+    }
+
+    glm::vec3 boxMin, boxMax;
+    model.getWorldBounds(boxMin, boxMax);
+
+    // Camera inside or near box, box faces would be clipped
+    glm::vec3 cameraPosition = Camera::getPosition();
+    if (glm::all(glm::greaterThan(cameraPosition, boxMin - glm::vec3(0.5f))) && glm::all(glm::lessThan(cameraPosition, boxMax + glm::vec3(0.5f))))
+    {
+        model.occluded = false;
+        return false;
+    }
+
+    // Outside of view, no need to ask GPU
+    if (!Camera::boxInFrustum(boxMin, boxMax))
+    {
+        model.occluded = true;
+        return false;
+    }
+
+    Shader *shader = Shader::load("bounds");
+    shader->setMat4("u_view", Camera::u_view);
+    shader->setMat4("u_projection", Camera::u_projection);
+    shader->setMat4("u_model", glm::scale(glm::translate(glm::mat4(1.0f), 0.5f * (boxMin + boxMax)), 0.5f * (boxMax - boxMin)));
+
+    // Draw box without writing color or depth
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_CULL_FACE);
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, model.occlusionQuery);
+    glBindVertexArray(boundsVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+    glBindVertexArray(0);
+    glEnable(GL_CULL_FACE);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    model.occlusionPending = true;
+    return true;
+}
+
 void Render::renderSceneUnitPlanes(Scene &scene, glm::vec4 clipPlane)
 {
     // Render opaque planes
@@ -237,7 +454,7 @@ void Render::renderSceneUnitPlanes(Scene &scene, glm::vec4 clipPlane)
 
 void Render::renderSceneGrids(Scene &scene, glm::vec4 clipPlane)
 {
-    for (auto grid : scene.grids)
+    for (auto &grid : scene.grids)
     {
         Shader *shader = Shader::load(grid.shader);
 
@@ -251,7 +468,14 @@ void Render::renderSceneGrids(Scene &scene, glm::vec4 clipPlane)
 
         shader->setVec4("location_plane", clipPlane);
 
-        shader->setFloat("lod", grid.lod);
+        // Snap clipmap levels to real camera, also in water passes
+        glm::vec2 cameraXY = glm::vec2(Camera::getPosition() - glm::vec3(grid.u_model[3]));
+        grid.clipmap.update(cameraXY);
+
+        shader->setVec2("cameraXY", cameraXY);
+        shader->setFloat("morphStart", grid.clipmap.morphStart);
+        shader->setFloat("morphWidth", grid.clipmap.morphWidth);
+        shader->setFloat("heightScale", grid.clipmap.heightScale);
 
         renderModel(grid);
     }
@@ -299,15 +523,15 @@ void Render::renderSceneTexts(Scene &scene)
     }
 }
 
-void Render::renderModel(ModelData model)
+void Render::renderModel(ModelData &model)
 {
     if (model.shader == "default")
     {
-        renderDefault(*model.model);
+        renderDefault(model);
     }
     else if (model.shader == "toon")
     {
-        renderToon(*model.model);
+        renderToon(model);
     }
     else if (model.shader == "pbr")
     {
@@ -342,15 +566,11 @@ void Render::renderModel(UnitPlaneData unitPlane)
     }
 }
 
-void Render::renderModel(GridData grid)
+void Render::renderModel(GridData &grid)
 {
-    if (grid.shader == "simple")
+    if (grid.shader == "toon-terrain")
     {
-        renderSimple(grid.grid);
-    }
-    else if (grid.shader == "toon-terrain")
-    {
-        renderToonTerrain(grid.grid);
+        renderToonTerrain(grid);
     }
     else
     {
@@ -358,8 +578,9 @@ void Render::renderModel(GridData grid)
     }
 }
 
-void Render::renderDefault(Model &model)
+void Render::renderDefault(ModelData &modelData)
 {
+    Model &model = *modelData.model;
     Shader *shader = Shader::load("default");
     unsigned int diffuseNr = 1;
     unsigned int propertiesNr = 1;
@@ -392,18 +613,19 @@ void Render::renderDefault(Model &model)
     // Unload texture
     glActiveTexture(GL_TEXTURE0);
 
-    // Draw every mesh
-    for (auto mesh : model.meshes)
+    // Draw every mesh, skinned copy when pre-pass made one
+    for (int i = 0; i < model.meshes.size(); i++)
     {
-        glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(modelData.skinned ? modelData.skinnedMeshes[i].VAO : model.meshes[i].VAO);
+        glDrawElements(GL_TRIANGLES, model.meshes[i].indices.size(), GL_UNSIGNED_INT, 0);
     }
 
     glBindVertexArray(0);
 }
 
-void Render::renderToon(Model &model)
+void Render::renderToon(ModelData &modelData)
 {
+    Model &model = *modelData.model;
     Shader *shader = Shader::load("toon");
     unsigned int highlightNr = 1;
     unsigned int shadowNr = 1;
@@ -438,17 +660,17 @@ void Render::renderToon(Model &model)
     // Unload texture
     glActiveTexture(GL_TEXTURE0);
 
-    // Draw every Mesh
-    for (auto mesh : model.meshes)
+    // Draw every mesh, skinned copy when pre-pass made one
+    for (int i = 0; i < model.meshes.size(); i++)
     {
-        glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        glBindVertexArray(modelData.skinned ? modelData.skinnedMeshes[i].VAO : model.meshes[i].VAO);
+        glDrawElements(GL_TRIANGLES, model.meshes[i].indices.size(), GL_UNSIGNED_INT, 0);
     }
 
     glBindVertexArray(0);
 }
 
-void Render::renderToonTerrain(Mesh mesh)
+void Render::renderToonTerrain(GridData &grid)
 {
     Texture heightmap = LoadStandaloneTexture("heightmap.jpg");
 
@@ -457,17 +679,13 @@ void Render::renderToonTerrain(Mesh mesh)
 
     Shader *shader = Shader::load("toon-terrain");
 
-    shader->setMat4("u_camXY", Camera::u_camXY);
     shader->setInt("heightmap", 0);
 
     // Unload texture
     glActiveTexture(GL_TEXTURE0);
 
-    // Draw Mesh
-    glBindVertexArray(mesh.VAO);
-    glDrawElements(GL_TRIANGLES, mesh.indices.size(), GL_UNSIGNED_INT, 0);
-
-    glBindVertexArray(0);
+    // Draw visible clipmap tiles
+    grid.clipmap.render(grid.u_model);
 }
 
 void Render::renderPBR(Model &model) // FIXME : Not showing when rendered (but is shown wrong in reflection of water fsr)
@@ -5,8 +5,19 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+#include <atomic>
+
+#include "frame/frame.h"
 #include "scene/scene.h"
 
+// Ways of hiding models behind others
+enum OcclusionMode
+{
+    noOcclusion,
+    queryOcclusion,
+    rasterOcclusion
+};
+
 struct Character
 {
     glm::ivec2 Size;     // Size of the character
@@ -20,11 +31,14 @@ class Render
 public:
     static float waterHeight;
 
-    static bool debugPhysics;
-    static std::vector<std::pair<std::string, float>> debugPhysicsData;
+    // Physics overlay shown, read by simulation thread to collect its values
+    static std::atomic<bool> debugPhysics;
+    static PhysicsDebug debugPhysicsData;
     static bool debugRender;
     static std::vector<std::tuple<std::string, int, int>> debugRenderData;
 
+    static OcclusionMode occlusionMode;
+
     static glm::vec4 clipPlane;
 
     static FT_Library ft;
@@ -51,6 +65,11 @@ private:
 
     static bool WaterPass;
 
+    // Occlusion culling variables
+    static unsigned int boundsVAO;
+    static std::vector<int> modelOrder;
+    static int occludedModels;
+
     // Class renderers
     static void renderSceneModels(Scene &scene, glm::vec4 clipPlane);
     static void renderSceneUnitPlanes(Scene &scene, glm::vec4 clipPlane);
@@ -59,19 +78,22 @@ private:
     static void renderSceneTexts(Scene &scene);
 
     // Type renderers
-    static void renderModel(ModelData model);
+    static void renderModel(ModelData &model);
     static void renderModel(UnitPlaneData unitPlane);
-    static void renderModel(GridData grid);
+    static void renderModel(GridData &grid);
 
     // Shader renderers
-    static void renderDefault(Model &model);
-    static void renderToon(Model &model);
-    static void renderToonTerrain(Mesh mesh);
+    static void renderDefault(ModelData &modelData);
+    static void renderToon(ModelData &modelData);
+    static void renderToonTerrain(GridData &grid);
     static void renderPBR(Model &model);
     static void renderSimple(Mesh mesh);
     static void renderToonWater(Mesh mesh);
     static void renderWater(Mesh mesh);
 
+    // Occlusion test, returns true if a query was issued this frame
+    static bool testOcclusion(ModelData &model);
+
     // Texture renderers
     static void renderReflectRefract(Scene &scene, glm::vec4 clipPlane);
     static void renderTestQuad(GLuint texture, int x, int y);
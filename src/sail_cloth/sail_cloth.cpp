@@ -0,0 +1,365 @@
+#include "sail_cloth/sail_cloth.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "lanes/lanes.h"
+
+// Kernel is written once for lane types, instantiated for SIMD and scalar
+using namespace lanes;
+
+std::atomic<bool> SailCloth::enabled{true};
+
+namespace
+{
+    // Instances are padded to a multiple of this, so the widest lanes never read past the end
+    const int padding = 8;
+
+    // Vertex moves with sail bone only
+    bool onSail(const Vertex &vertex, int sailBone)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            if (vertex.BoneIDs[k] == sailBone && vertex.Weights[k] > 0.99f)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    glm::vec3 restPosition(const SailShape &shape, int particle)
+    {
+        float u = (float)(particle % SailCloth::columns) / (SailCloth::columns - 1);
+        float v = (float)(particle / SailCloth::columns) / (SailCloth::rows - 1);
+        return shape.corner + shape.alongFoot * u + shape.alongLuff * v;
+    }
+}
+
+SailShape SailCloth::fit(std::vector<Mesh> &meshes, const Skeleton &skeleton, int sailBone)
+{
+    SailShape shape;
+    if (sailBone < 0)
+    {
+        return shape;
+    }
+
+    // Bounds of sail in bind pose
+    glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+    for (const Mesh &mesh : meshes)
+    {
+        for (const Vertex &vertex : mesh.vertices)
+        {
+            if (onSail(vertex, sailBone))
+            {
+                boxMin = glm::min(boxMin, vertex.Position);
+                boxMax = glm::max(boxMax, vertex.Position);
+            }
+        }
+    }
+    if (boxMin.x > boxMax.x)
+    {
+        return shape;
+    }
+
+    // Thinnest axis is across the sail, luff runs up unless the sail lies flat
+    glm::vec3 size = boxMax - boxMin;
+    int normalAxis = size.x <= size.y && size.x <= size.z ? 0 : (size.y <= size.z ? 1 : 2);
+    int luffAxis = normalAxis == 2 ? 1 : 2;
+    int footAxis = 3 - normalAxis - luffAxis;
+
+    // Luff is the edge nearest the sail bone, which turns around the mast
+    glm::vec3 pivot = glm::vec3(skeleton.offsets[sailBone][3]);
+    bool luffAtMax = std::abs(pivot[footAxis] - boxMax[footAxis]) < std::abs(pivot[footAxis] - boxMin[footAxis]);
+
+    shape.corner[normalAxis] = 0.5f * (boxMin[normalAxis] + boxMax[normalAxis]);
+    shape.corner[luffAxis] = boxMin[luffAxis];
+    shape.corner[footAxis] = luffAtMax ? boxMax[footAxis] : boxMin[footAxis];
+    shape.alongFoot[footAxis] = luffAtMax ? -size[footAxis] : size[footAxis];
+    shape.alongLuff[luffAxis] = size[luffAxis];
+    shape.normal[normalAxis] = 1.0f;
+    if (size[footAxis] <= 0.0f || size[luffAxis] <= 0.0f)
+    {
+        return shape;
+    }
+    shape.valid = true;
+
+    // Place of each sail vertex on shape, weight 0 leaves the others rigid
+    for (Mesh &mesh : meshes)
+    {
+        for (Vertex &vertex : mesh.vertices)
+        {
+            if (onSail(vertex, sailBone))
+            {
+                glm::vec3 relative = vertex.Position - shape.corner;
+                vertex.Cloth = glm::vec3(glm::dot(relative, shape.alongFoot) / glm::dot(shape.alongFoot, shape.alongFoot),
+                                         glm::dot(relative, shape.alongLuff) / glm::dot(shape.alongLuff, shape.alongLuff), 1.0f);
+            }
+        }
+    }
+    return shape;
+}
+
+std::vector<std::vector<float> *> SailCloth::instanceArrays()
+{
+    return {&windX, &windY, &windZ, &gravityX, &gravityY, &gravityZ, &active, &normalX, &normalY, &normalZ, &settle};
+}
+
+std::vector<std::vector<float> *> SailCloth::particleArrays()
+{
+    return {&restX, &restY, &restZ, &positionX, &positionY, &positionZ, &previousX, &previousY, &previousZ, &springLength};
+}
+
+void SailCloth::resize(int newStride)
+{
+    for (std::vector<float> *array : instanceArrays())
+    {
+        array->resize(newStride, 0.0f);
+    }
+
+    // Rows of particles or springs, each stride long
+    for (std::vector<float> *array : particleArrays())
+    {
+        int rowCount = stride > 0 ? array->size() / stride : (array == &springLength ? springA.size() : particles);
+        std::vector<float> laidOut(rowCount * newStride, 0.0f);
+        for (int row = 0; row < rowCount && stride > 0; row++)
+        {
+            std::copy(array->begin() + row * stride, array->begin() + row * stride + count, laidOut.begin() + row * newStride);
+        }
+        array->swap(laidOut);
+    }
+    stride = newStride;
+}
+
+void SailCloth::clear()
+{
+    for (std::vector<float> *array : instanceArrays())
+    {
+        array->clear();
+    }
+    for (std::vector<float> *array : particleArrays())
+    {
+        array->clear();
+    }
+    count = 0;
+    stride = 0;
+    stepped = 0;
+}
+
+int SailCloth::add(const SailShape &shape)
+{
+    // Grid is the same for every instance, made with the first
+    if (inverseMass.empty())
+    {
+        // Luff column and foot row hang on mast and boom. Sheet holds leech near the chord, so cloth is deepest
+        // between luff and leech and more so higher up away from the boom
+        for (int particle = 0; particle < particles; particle++)
+        {
+            float u = (float)(particle % columns) / (columns - 1);
+            float v = (float)(particle / columns) / (rows - 1);
+            inverseMass.push_back(particle % columns == 0 || particle / columns == 0 ? 0.0f : 1.0f);
+            draft.push_back(std::sin((float)M_PI * u) * std::sin(0.5f * (float)M_PI * v));
+        }
+
+        // Neighbours along and across, diagonals against shear, and every second one against bending
+        auto link = [&](int column, int row, int toColumn, int toRow)
+        {
+            if (toColumn >= 0 && toColumn < columns && toRow < rows && inverseMass[row * columns + column] + inverseMass[toRow * columns + toColumn] > 0.0f)
+            {
+                springA.push_back(row * columns + column);
+                springB.push_back(toRow * columns + toColumn);
+            }
+        };
+        for (int row = 0; row < rows; row++)
+        {
+            for (int column = 0; column < columns; column++)
+            {
+                link(column, row, column + 1, row);
+                link(column, row, column, row + 1);
+                link(column, row, column + 1, row + 1);
+                link(column, row, column - 1, row + 1);
+                link(column, row, column + 2, row);
+                link(column, row, column, row + 2);
+            }
+        }
+    }
+
+    if (count == stride)
+    {
+        resize(std::max(padding, stride * 2));
+    }
+    int index = count++;
+
+    // At rest, with springs slack by fullness
+    for (int particle = 0; particle < particles; particle++)
+    {
+        glm::vec3 rest = restPosition(shape, particle);
+        int at = particle * stride + index;
+        restX[at] = positionX[at] = previousX[at] = rest.x;
+        restY[at] = positionY[at] = previousY[at] = rest.y;
+        restZ[at] = positionZ[at] = previousZ[at] = rest.z;
+    }
+    for (int spring = 0; spring < springA.size(); spring++)
+    {
+        springLength[spring * stride + index] = glm::distance(restPosition(shape, springA[spring]), restPosition(shape, springB[spring])) * fullness;
+    }
+
+    normalX[index] = shape.normal.x;
+    normalY[index] = shape.normal.y;
+    normalZ[index] = shape.normal.z;
+    settle[index] = 0.0f;
+    active[index] = 0.0f;
+    return index;
+}
+
+template <typename L>
+void SailCloth::stepLanes(int i, float deltaTime, float time)
+{
+    typename L::Mask simulated = L::load(&active[i]) > 0.5f;
+    L gravityAX = L::load(&gravityX[i]), gravityAY = L::load(&gravityY[i]), gravityAZ = L::load(&gravityZ[i]);
+    L nX = L::load(&normalX[i]), nY = L::load(&normalY[i]), nZ = L::load(&normalZ[i]);
+
+    // Pressure of wind across cloth, and flutter of wind along it that grows towards the leech
+    L wX = L::load(&windX[i]), wY = L::load(&windY[i]), wZ = L::load(&windZ[i]);
+    L speed = sqrt(wX * wX + wY * wY + wZ * wZ);
+    L across = wX * nX + wY * nY + wZ * nZ;
+    L pressure = speed * across * (0.5f * airDensity * pressureCoefficient / areaDensity);
+    L luffing = (L(1.0f) - abs(across) / max(speed, L(1e-3f))) * speed * speed * (0.5f * airDensity * flutter / areaDensity);
+
+    // Move free particles on, cloth not simulated eases back to rest
+    float dt2 = deltaTime * deltaTime;
+    for (int particle = 0; particle < particles; particle++)
+    {
+        if (inverseMass[particle] == 0.0f)
+        {
+            continue;
+        }
+
+        int at = particle * stride + i;
+        L x = L::load(&positionX[at]), y = L::load(&positionY[at]), z = L::load(&positionZ[at]);
+        L restPX = L::load(&restX[at]), restPY = L::load(&restY[at]), restPZ = L::load(&restZ[at]);
+
+        // Wave running aft from luff, same phase for every instance, and tension of cloth against its depth
+        float u = (float)(particle % columns) / (columns - 1);
+        float v = (float)(particle / columns) / (rows - 1);
+        L depth = (x - restPX) * nX + (y - restPY) * nY + (z - restPZ) * nZ;
+        L normalForce = pressure * draft[particle] + luffing * (std::sin(time * 12.0f - u * 6.0f - v * 2.0f) * u) - depth * stiffness;
+
+        L newX = x + (x - L::load(&previousX[at])) * damping + (gravityAX + nX * normalForce) * dt2;
+        L newY = y + (y - L::load(&previousY[at])) * damping + (gravityAY + nY * normalForce) * dt2;
+        L newZ = z + (z - L::load(&previousZ[at])) * damping + (gravityAZ + nZ * normalForce) * dt2;
+
+        // Halyard and outhaul hold cloth in the plane of the sail, it only moves across it freely
+        L offsetX = newX - restPX, offsetY = newY - restPY, offsetZ = newZ - restPZ;
+        L newDepth = offsetX * nX + offsetY * nY + offsetZ * nZ;
+        newX = restPX + nX * newDepth + (offsetX - nX * newDepth) * (1.0f - tension);
+        newY = restPY + nY * newDepth + (offsetY - nY * newDepth) * (1.0f - tension);
+        newZ = restPZ + nZ * newDepth + (offsetZ - nZ * newDepth) * (1.0f - tension);
+        L relaxedX = restPX + (x - restPX) * relax;
+        L relaxedY = restPY + (y - restPY) * relax;
+        L relaxedZ = restPZ + (z - restPZ) * relax;
+
+        select(simulated, x, relaxedX).store(&previousX[at]);
+        select(simulated, y, relaxedY).store(&previousY[at]);
+        select(simulated, z, relaxedZ).store(&previousZ[at]);
+        select(simulated, newX, relaxedX).store(&positionX[at]);
+        select(simulated, newY, relaxedY).store(&positionY[at]);
+        select(simulated, newZ, relaxedZ).store(&positionZ[at]);
+    }
+
+    // Springs only pull, cloth shorter than rest length is slack
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        for (int spring = 0; spring < springA.size(); spring++)
+        {
+            int a = springA[spring] * stride + i, b = springB[spring] * stride + i;
+            float massA = inverseMass[springA[spring]], massB = inverseMass[springB[spring]];
+
+            L aX = L::load(&positionX[a]), aY = L::load(&positionY[a]), aZ = L::load(&positionZ[a]);
+            L bX = L::load(&positionX[b]), bY = L::load(&positionY[b]), bZ = L::load(&positionZ[b]);
+            L dX = bX - aX, dY = bY - aY, dZ = bZ - aZ;
+            L length = sqrt(dX * dX + dY * dY + dZ * dZ);
+            L stretch = max(length - L::load(&springLength[spring * stride + i]), L(0.0f)) / (max(length, L(1e-6f)) * (massA + massB));
+
+            (aX + dX * stretch * massA).store(&positionX[a]);
+            (aY + dY * stretch * massA).store(&positionY[a]);
+            (aZ + dZ * stretch * massA).store(&positionZ[a]);
+            (bX - dX * stretch * massB).store(&positionX[b]);
+            (bY - dY * stretch * massB).store(&positionY[b]);
+            (bZ - dZ * stretch * massB).store(&positionZ[b]);
+        }
+    }
+
+    // Largest offset from rest, tells when eased back cloth can stop
+    L largest(0.0f);
+    for (int particle = 0; particle < particles; particle++)
+    {
+        int at = particle * stride + i;
+        largest = max(largest, abs(L::load(&positionX[at]) - L::load(&restX[at])));
+        largest = max(largest, abs(L::load(&positionY[at]) - L::load(&restY[at])));
+        largest = max(largest, abs(L::load(&positionZ[at]) - L::load(&restZ[at])));
+    }
+    largest.store(&settle[i]);
+}
+
+void SailCloth::step(float deltaTime, float time)
+{
+    // Batches with nothing to simulate or ease back are skipped
+    auto idle = [&](int i, int width)
+    {
+        return std::all_of(&active[i], &active[i] + width, [](float a)
+                           { return a == 0.0f; }) &&
+               std::all_of(&settle[i], &settle[i] + width, [](float s)
+                           { return s == 0.0f; });
+    };
+
+    int i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // Full SIMD batches, padding instances are idle so these cover every one
+    for (; i + SimdLanes::width <= stride; i += SimdLanes::width)
+    {
+        if (!idle(i, SimdLanes::width))
+        {
+            stepLanes<SimdLanes>(i, deltaTime, time);
+        }
+    }
+#endif
+
+    // Remaining instances
+    for (; i < count; i++)
+    {
+        if (!idle(i, 1))
+        {
+            stepLanes<ScalarLanes>(i, deltaTime, time);
+        }
+    }
+
+    // Cloth eased back close enough snaps to rest, then costs nothing
+    stepped = 0;
+    for (i = 0; i < count; i++)
+    {
+        stepped += active[i] > 0.0f;
+        if (active[i] == 0.0f && settle[i] > 0.0f && settle[i] < 1e-4f)
+        {
+            for (int particle = 0; particle < particles; particle++)
+            {
+                int at = particle * stride + i;
+                positionX[at] = previousX[at] = restX[at];
+                positionY[at] = previousY[at] = restY[at];
+                positionZ[at] = previousZ[at] = restZ[at];
+            }
+            settle[i] = 0.0f;
+        }
+    }
+}
+
+void SailCloth::offsets(int instance, glm::vec3 *out) const
+{
+    for (int particle = 0; particle < particles; particle++)
+    {
+        int at = particle * stride + instance;
+        out[particle] = glm::vec3(positionX[at] - restX[at], positionY[at] - restY[at], positionZ[at] - restZ[at]);
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef SAIL_CLOTH_H
+#define SAIL_CLOTH_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include "mesh/mesh.h"
+#include "skeleton/skeleton.h"
+
+// Rectangle around the sail of a model in bind pose, luff along the mast edge and foot along the boom edge.
+// Corner is where they meet, axes run the full width and height of the sail
+struct SailShape
+{
+    bool valid = false;
+    glm::vec3 corner = glm::vec3(0.0f);
+    glm::vec3 alongFoot = glm::vec3(0.0f);
+    glm::vec3 alongLuff = glm::vec3(0.0f);
+    glm::vec3 normal = glm::vec3(0.0f);
+};
+
+// Low resolution cloth for the sails of every yacht near the camera, stepped together. Particles are a
+// columns by rows grid over the sail shape, in bind space of the sail bone so the rigid pose still swings
+// the sail and cloth only adds billow and flutter. State is particle major with instances side by side,
+// so each particle and spring is one SIMD operation over several yachts
+class SailCloth
+{
+public:
+    // Grid size, shaders read offsets of the same grid
+    static const int columns = 8;
+    static const int rows = 6;
+    static const int particles = columns * rows;
+
+    // Simulated at all, written by main thread
+    static std::atomic<bool> enabled;
+
+    // Fit shape to vertices rigid on sail bone, and mark them with their place on it in Vertex::Cloth.
+    // Invalid shape if model has no such bone or no vertices on it
+    static SailShape fit(std::vector<Mesh> &meshes, const Skeleton &skeleton, int sailBone);
+
+    // Add instance of shape at rest, returns its index
+    int add(const SailShape &shape);
+    void clear();
+    int size() const { return count; }
+
+    // Per instance before step. Apparent wind and gravity in bind space of sail, and whether cloth is simulated.
+    // Instances not simulated ease back to their rest shape
+    std::vector<float> windX, windY, windZ;
+    std::vector<float> gravityX, gravityY, gravityZ;
+    std::vector<float> active;
+
+    // Advance instances that are simulated or still easing back by one tick
+    void step(float deltaTime, float time);
+
+    // Instance is off its rest shape, and offset of every particle from rest, particles long
+    bool moving(int instance) const { return settle[instance] > 0.0f; }
+    void offsets(int instance, glm::vec3 *out) const;
+
+    // Cloth spring length over rest distance, slack is what lets the sail fill, and constraint passes per tick
+    float fullness = 1.04f;
+    int iterations = 4;
+
+    // Sail cloth mass per area, air density and pressure coefficient of wind normal to cloth, share of velocity
+    // kept per tick, and flutter strength when wind runs along cloth
+    float areaDensity = 0.3f;
+    float airDensity = 1.225f;
+    float pressureCoefficient = 1.2f;
+    float damping = 0.96f;
+    float flutter = 0.3f;
+
+    // Share of offset in the plane of the sail taken out per tick, and pull back of depth across it per depth
+    float tension = 0.8f;
+    float stiffness = 800.0f;
+
+    // Share of offset kept per tick while easing back
+    float relax = 0.85f;
+
+    // Instances stepped last tick
+    int stepped = 0;
+
+private:
+    int count = 0;
+
+    // Instances rounded up to widest lanes, padding instances are never active
+    int stride = 0;
+
+    // Per particle times stride, rest position and current and last position
+    std::vector<float> restX, restY, restZ;
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> previousX, previousY, previousZ;
+
+    // Per instance, normal of sail at rest, and largest offset of any particle after last step, 0 at rest
+    std::vector<float> normalX, normalY, normalZ;
+    std::vector<float> settle;
+
+    // Springs shared by all instances, rest length per spring times stride
+    std::vector<int> springA, springB;
+    std::vector<float> springLength;
+
+    // 0 for particles pinned to luff and foot, 1 for free ones, and share of wind pressure taken per particle
+    std::vector<float> inverseMass;
+    std::vector<float> draft;
+
+    // Arrays with a value per instance, and those with one per particle or spring and instance
+    std::vector<std::vector<float> *> instanceArrays();
+    std::vector<std::vector<float> *> particleArrays();
+
+    // Lay arrays out again for more instances, keeping those added
+    void resize(int newStride);
+
+    // Step L::width instances starting at i
+    template <typename L>
+    void stepLanes(int i, float deltaTime, float time);
+};
+
+#endif
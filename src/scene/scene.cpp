@@ -1,7 +1,9 @@
 #include <scene/scene.h>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <jsoncons/json.hpp>
 #include <jsoncons/json_traits_macros.hpp>
 #include <glm/glm.hpp>
@@ -10,17 +12,18 @@
 #include "model/model.h"
 #include "mesh/mesh.h"
 #include "event_handler/event_handler.h"
+#include "animation/animation.h"
 #include "frame_buffer/frame_buffer.h"
 #include "file_manager/file_manager.h"
 #include "scene_manager/scene_manager.h"
 
 // Json mappings
-JSONCONS_N_MEMBER_TRAITS(JSONModel, 1, name, scale, angle, rotationAxis, translation, shader, animated, controlled);
+JSONCONS_N_MEMBER_TRAITS(JSONModel, 1, name, scale, angle, rotationAxis, translation, shader, animated, controlled, palette, clip, clipWeight);
 JSONCONS_N_MEMBER_TRAITS(JSONUnitPlane, 0, color, scale, angle, rotationAxis, translation, shader);
 JSONCONS_N_MEMBER_TRAITS(JSONGrid, 0, gridSize, scale, lod, color, angle, rotationAxis, translation, shader);
 JSONCONS_N_MEMBER_TRAITS(JSONSkybox, 6, up, down, left, right, front, back);
 JSONCONS_N_MEMBER_TRAITS(JSONText, 1, text, color, position, scale);
-JSONCONS_N_MEMBER_TRAITS(JSONScene, 0, models, unitPlanes, grids, skyBox, texts, bgColor);
+JSONCONS_N_MEMBER_TRAITS(JSONScene, 0, models, unitPlanes, grids, skyBox, texts, bgColor, waypoints);
 
 Scene::Scene(std::string jsonPath, std::string sceneName)
 {
@@ -48,6 +51,12 @@ Scene::Scene(std::string jsonPath, std::string sceneName)
     // Set background color from scene
     bgColor = glm::vec3(jsonScene.bgColor[0], jsonScene.bgColor[1], jsonScene.bgColor[2]);
 
+    // Course waypoints from scene
+    for (const std::vector<float> &waypoint : jsonScene.waypoints)
+    {
+        waypoints.push_back(glm::vec2(waypoint[0], waypoint[1]));
+    }
+
     SceneManager::loadingState++;
     SceneManager::loadingProgress = {0, jsonScene.texts.size()};
 
@@ -68,6 +77,15 @@ Scene::Scene(std::string jsonPath, std::string sceneName)
         SceneManager::loadingProgress.first++;
     }
 
+    // Poses do not grow after this, point models at their slice
+    for (ModelData &modelData : structModels)
+    {
+        if (modelData.poseStart >= 0)
+        {
+            modelData.boneTransforms = poses.globals.data() + modelData.poseStart;
+        }
+    }
+
     SceneManager::loadingState++;
     SceneManager::loadingProgress = {0, jsonScene.unitPlanes.size()};
 
@@ -84,12 +102,7 @@ Scene::Scene(std::string jsonPath, std::string sceneName)
     // Generate Grids form scene
     for (JSONGrid grid : jsonScene.grids)
     {
-        for (int i = 0; i <= grid.lod; i++)
-        {
-            JSONGrid loadGrid = grid;
-            loadGrid.lod = i;
-            loadGridToScene(loadGrid);
-        }
+        loadGridToScene(grid);
         SceneManager::loadingProgress.first++;
     }
 
@@ -105,6 +118,47 @@ Scene::Scene(std::string jsonPath, std::string sceneName)
     SceneManager::loadingState++;
 };
 
+Scene::~Scene()
+{
+    // Release clipmap meshes, others are released by their owners
+    for (auto &grid : grids)
+    {
+        grid.clipmap.unload();
+    }
+
+    // Release occlusion queries and skinned buffers
+    for (auto &modelData : structModels)
+    {
+        if (modelData.occlusionQuery != 0)
+        {
+            glDeleteQueries(1, &modelData.occlusionQuery);
+        }
+        Skinning::release(modelData);
+    }
+}
+
+void ModelData::getWorldBounds(glm::vec3 &boxMin, glm::vec3 &boxMax) const
+{
+    // Use sphere around local bounds, stays conservative when bones rotate parts
+    glm::vec3 center = 0.5f * (model->boundsMin + model->boundsMax);
+    float radius = 0.5f * glm::length(model->boundsMax - model->boundsMin);
+
+    // Animated models are moved by their body bone
+    glm::mat4 transform = u_model;
+    int body = animated && !boneHandles.empty() ? boneHandles[bodyBone] : -1;
+    if (body >= 0 && body < boneCount)
+    {
+        transform = u_model * boneTransforms[body] * model->skeleton.inverseOffsets[body];
+    }
+
+    // Largest axis scale of transform
+    float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+    glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+    boxMin = worldCenter - glm::vec3(radius * scale);
+    boxMax = worldCenter + glm::vec3(radius * scale);
+}
+
 void Scene::loadModelToScene(JSONModel model)
 {
     // Setup empty structModel unit
@@ -140,10 +194,51 @@ void Scene::loadModelToScene(JSONModel model)
     // Model shader
     loadModel.shader = model.shader;
 
-    // Model animation data
+    // Model animation data, only models with a valid skeleton can be posed
     loadModel.animated = model.animated;
+    if (loadModel.animated && !loadModel.model->skeletonValid)
+    {
+        std::cerr << "Model " << model.name << " has no valid skeleton, not animated" << std::endl;
+        loadModel.animated = false;
+    }
     loadModel.controlled = model.controlled;
 
+    // Own slice of poses in bind pose until simulation sends one, and find bones to drive once
+    if (loadModel.animated)
+    {
+        loadModel.poseStart = poses.add(loadModel.model->skeleton);
+        loadModel.boneCount = loadModel.model->skeleton.size();
+        loadModel.boneHandles = Animation::resolveBones(loadModel.model->skeleton);
+
+        // Palette encoding of scene file, or one skeleton fits in
+        PaletteEncoding requested = affinePalette;
+        if (!BonePalette::parse(model.palette, requested))
+        {
+            std::cerr << "Unknown bone palette " << model.palette << " for model " << model.name << ", using affine" << std::endl;
+        }
+        loadModel.paletteEncoding = BonePalette::choose(requested, loadModel.model->skeleton);
+        BonePalette::encode(loadModel.paletteEncoding, poses.globals.data() + loadModel.poseStart, loadModel.model->skeleton.inverseOffsets,
+                            loadModel.boneCount, loadModel.bonePalette);
+
+        // Cloth at rest for sail, simulation lays out its instances in the same order
+        if (loadModel.model->sail.valid)
+        {
+            loadModel.clothInstance = cloth.size() / SailCloth::particles;
+            cloth.resize(cloth.size() + SailCloth::particles, glm::vec3(0.0f));
+        }
+
+        // Clip layer by name
+        if (!model.clip.empty())
+        {
+            loadModel.clip = loadModel.model->findClip(model.clip);
+            loadModel.clipWeight = std::clamp(model.clipWeight, 0.0f, 1.0f);
+            if (loadModel.clip < 0)
+            {
+                std::cerr << "No animation clip " << model.clip << " in model " << model.name << std::endl;
+            }
+        }
+    }
+
     // Save model
     this->structModels.push_back(loadModel);
 
@@ -196,6 +291,13 @@ void Scene::loadUnitPlaneToScene(JSONUnitPlane unitPlane)
 
 void Scene::loadGridToScene(JSONGrid grid)
 {
+    // Clipmap tiles hold small integer positions and levels, other shaders would draw them as garbage
+    if (grid.shader != "toon-terrain")
+    {
+        std::cerr << "Grid shader " << grid.shader << " can not draw clipmap tiles, grid skipped" << std::endl;
+        return;
+    }
+
     // Empty grid for loading
     GridData loadGrid;
 
@@ -205,23 +307,21 @@ void Scene::loadGridToScene(JSONGrid grid)
     loadGrid.lod = grid.lod;
     loadGrid.gridSize = glm::vec2(grid.gridSize[0], grid.gridSize[1]);
 
-    // Generate grid mesh
-    loadGrid.grid = Mesh::genGrid(loadGrid.gridSize[0], loadGrid.gridSize[1], loadGrid.lod, loadGrid.color, loadGrid.shader);
+    // Generate clipmap, one level for base grid and every lod
+    loadGrid.clipmap = Clipmap(loadGrid.gridSize[0], loadGrid.lod + 1, grid.scale);
 
-    // Generate u_model
-    glm::mat4 u_model_i =
-        glm::rotate(
-            glm::scale(
-                glm::translate(
-                    glm::mat4(1.0f),
-                    glm::vec3(grid.translation[0], grid.translation[1], grid.translation[2])),
-                glm::vec3(grid.scale * pow(2, loadGrid.lod), grid.scale * pow(2, loadGrid.lod), 1.0f)),
-            glm::radians((float)grid.angle), glm::vec3(grid.rotationAxis[0], grid.rotationAxis[1], grid.rotationAxis[2]));
+    // Generate u_model, clipmap is world aligned so only translation applies
+    glm::mat4 u_model_i = glm::translate(
+        glm::mat4(1.0f),
+        glm::vec3(grid.translation[0], grid.translation[1], grid.translation[2]));
 
     // Save model and normal matrices
     loadGrid.u_model = u_model_i;
     loadGrid.u_normal = glm::transpose(glm::inverse(u_model_i));
 
+    // Terrain keeps heightmap on the CPU too, for physics and occlusion
+    loadGrid.heightfield.load(FileManager::getPath("resources/textures/heightmap.jpg"), glm::vec3(u_model_i[3]), loadGrid.clipmap.heightScale);
+
     // Push loaded grid to scene
     this->grids.push_back(loadGrid);
 }
@@ -272,7 +372,7 @@ void Scene::uploadToGPU()
     }
     for (auto &grid : grids)
     {
-        grid.grid.uploadToGPU();
+        grid.clipmap.uploadToGPU();
     }
     if (hasSkyBox)
     {
@@ -8,6 +8,11 @@
 #include <string>
 
 #include "model/model.h"
+#include "bone_palette/bone_palette.h"
+#include "clipmap/clipmap.h"
+#include "heightfield/heightfield.h"
+#include "pose_arena/pose_arena.h"
+#include "skinning/skinning.h"
 
 struct JSONModel
 {
@@ -19,6 +24,9 @@ struct JSONModel
     std::string shader = "default";
     bool animated = false;
     bool controlled = false;
+    std::string palette = "affine";
+    std::string clip = "";
+    float clipWeight = 1.0f;
 };
 
 struct JSONUnitPlane
@@ -28,7 +36,9 @@ struct JSONUnitPlane
     float angle = 0;
     std::vector<float> rotationAxis = {0, 1, 0};
     std::vector<float> translation = {0, 0, 0};
-    std::string shader = "simple";
+
+    // Grids are clipmaps of instanced tiles, only toon-terrain reads that layout
+    std::string shader = "toon-terrain";
 };
 
 struct JSONGrid
@@ -40,7 +50,9 @@ struct JSONGrid
     float angle = 0;
     std::vector<float> rotationAxis = {0, 0, 1};
     std::vector<float> translation = {0, 0, 0};
-    std::string shader = "simple";
+
+    // Grids are clipmaps of instanced tiles, only toon-terrain reads that layout
+    std::string shader = "toon-terrain";
 };
 
 struct JSONSkybox
@@ -69,6 +81,7 @@ struct JSONScene
     std::vector<JSONSkybox> skyBox = {};
     std::vector<JSONText> texts = {};
     std::vector<float> bgColor = {0, 0, 0};
+    std::vector<std::vector<float>> waypoints = {};
 };
 
 class Physics;
@@ -82,6 +95,45 @@ struct ModelData
     bool animated;
     bool controlled;
     std::vector<Physics *> physics;
+    int fleetIndex = -1;
+
+    // Slice of scene poses this instance owns, -1 if not animated. Globals of slice, blended from
+    // latest simulation frames, are what render reads
+    int poseStart = -1;
+    int boneCount = 0;
+    const glm::mat4 *boneTransforms = nullptr;
+
+    // Simulation pose version slice holds as is, 0 while it is blended between two
+    unsigned int poseVersion = 0;
+
+    // Skeleton handles of bones animation drives, resolved at load, empty if not animated
+    std::vector<int> boneHandles;
+
+    // Sail cloth of instance in scene cloth and simulation, -1 for yachts without a sail and other models
+    int clothInstance = -1;
+
+    // Baked clip of model played on top of procedural pose, -1 for none, and how strongly
+    int clip = -1;
+    float clipWeight = 1.0f;
+
+    // Skinning transforms of slice as shaders take them, encoded once per frame for all passes
+    PaletteEncoding paletteEncoding = affinePalette;
+    std::vector<glm::vec4> bonePalette;
+    unsigned int paletteVersion = 1;
+
+    // Meshes skinned by pre-pass, drawn instead of model meshes while skinned is set for this frame.
+    // Skinned again only when palette changed since
+    std::vector<SkinnedMesh> skinnedMeshes;
+    bool skinned = false;
+    unsigned int skinnedVersion = 0;
+
+    // Occlusion query state
+    unsigned int occlusionQuery = 0;
+    bool occlusionPending = false;
+    bool occluded = false;
+
+    // World space box around model in its current pose
+    void getWorldBounds(glm::vec3 &boxMin, glm::vec3 &boxMax) const;
 };
 
 struct UnitPlaneData
@@ -109,7 +161,10 @@ struct GridData
     std::string shader;
     glm::vec2 gridSize;
     float lod;
-    Mesh grid = Mesh::genGrid(gridSize.x, gridSize.y, lod, color, shader);
+    Clipmap clipmap;
+
+    // Heights on the CPU, only for grids drawn with a heightmap
+    Heightfield heightfield;
 };
 
 struct SkyBoxData
@@ -136,6 +191,7 @@ class Scene
 {
 public:
     Scene(std::string jsonPath, std::string sceneName);
+    ~Scene();
     void uploadToGPU();
 
     // Local scene data
@@ -151,6 +207,17 @@ public:
     std::vector<TextData> texts;
     glm::vec3 bgColor;
 
+    // Course for yachts on autopilot, world XY
+    std::vector<glm::vec2> waypoints;
+
+    // Bone poses of animated models, as shown this frame
+    PoseArena poses;
+
+    // Sail cloth offsets from rest of animated yachts, SailCloth::particles per cloth instance, as shown this frame.
+    // Version counts changes, so the buffer shaders read them from is only filled when they moved
+    std::vector<glm::vec3> cloth;
+    unsigned int clothVersion = 1;
+
 private:
     // Load-functions for each type
     void loadModelToScene(JSONModel model);
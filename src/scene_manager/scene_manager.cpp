@@ -2,8 +2,11 @@
 
 #include <jsoncons/json.hpp>
 
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
+#include <utility>
 #include <windows.h>
 
 #include "physics/physics.h"
@@ -11,10 +14,23 @@
 #include "render/render.h"
 #include "shader/shader.h"
 #include "camera/camera.h"
+#include "input_recorder/input_recorder.h"
 
 // Global Scene variables
 std::shared_ptr<Scene> SceneManager::currentScene = nullptr;
 std::future<std::shared_ptr<Scene>> SceneManager::pendingScene;
+unsigned int SceneManager::sceneId = 0;
+std::mutex SceneManager::sceneMutex;
+
+// Simulation thread variables
+FrameMailbox SceneManager::frames;
+float SceneManager::simulationRate = 120.0f;
+int SceneManager::maxSimulationSteps = 5;
+int SceneManager::droppedSteps = 0;
+FrameState SceneManager::lastState;
+unsigned int SceneManager::lastStateScene = 0;
+std::thread SceneManager::simulationThread;
+std::atomic<bool> SceneManager::simulationRunning = false;
 
 // Scenemap and paths
 std::map<std::string, std::string> SceneManager::sceneMap;
@@ -22,7 +38,7 @@ std::string sceneMapPath = "resources/scenes.json";
 
 // Global loading variables
 bool SceneManager::onTitleScreen = false;
-int SceneManager::loadingState = 0;
+std::atomic<int> SceneManager::loadingState = 0;
 std::pair<int, int> SceneManager::loadingProgress = {0, 0};
 
 // Load scene on main, causes freezing
@@ -31,6 +47,9 @@ void SceneManager::load(const std::string &sceneName)
     // unload current scene
     unload();
 
+    // Keep simulation out until scene is set up
+    std::lock_guard<std::mutex> lock(sceneMutex);
+
     // Check if going to title
     if (sceneName == "title")
     {
@@ -39,6 +58,7 @@ void SceneManager::load(const std::string &sceneName)
 
     // Load scene from file
     currentScene = std::make_shared<Scene>(sceneMap[sceneName], sceneName);
+    sceneId++;
 
     // Upload scene to GPU
     currentScene->uploadToGPU();
@@ -79,8 +99,12 @@ void SceneManager::update()
     // If background loading scene is complete
     if (loadingState > 0 && pendingScene.valid() && pendingScene.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready)
     {
+        // Keep simulation out until scene is set up
+        std::lock_guard<std::mutex> lock(sceneMutex);
+
         // Retrieve the loaded scene
         currentScene = pendingScene.get();
+        sceneId++;
 
         // Render final loading screen frame
         SceneManager::renderLoading();
@@ -102,23 +126,219 @@ void SceneManager::update()
         loadingState = 0;
         Sleep(500);
     }
-    // If not loading, aka running normally
-    else if (loadingState == 0)
-    {
-        Physics::update(*currentScene);
-        Animation::updateBones(*currentScene);
-    }
 }
 
 void SceneManager::render()
 {
+    // Take newest simulation frame
+    applyFrame(frames.acquire());
+
     // Update cam, render scene
     Camera::update();
+    Physics::lod.setView(Camera::getPosition(), Camera::frustumPlanes);
     Render::render(*currentScene);
 }
 
+void SceneManager::applyFrame(const Frame &frame)
+{
+    const FrameState &current = frame.current;
+    const FrameState &previous = frame.previous;
+
+    // Frame of previous scene, or none yet
+    std::vector<ModelData> &models = currentScene->structModels;
+    std::vector<glm::mat4> &poses = currentScene->poses.globals;
+    if (frame.sceneId != sceneId || current.poses.size() != poses.size() || current.poseVersions.size() != models.size())
+    {
+        return;
+    }
+
+    // Render lags one step behind simulation, blend towards newest state
+    float t = frame.blendFactor(std::chrono::steady_clock::now());
+    bool blend = previous.poses.size() == current.poses.size() && previous.poseVersions.size() == current.poseVersions.size();
+
+    // Cloth of frame laid out as scene's, blended only when previous one is too
+    std::vector<glm::vec3> &cloth = currentScene->cloth;
+    bool hasCloth = current.cloth.size() == cloth.size();
+    bool blendCloth = blend && previous.cloth.size() == cloth.size();
+
+    for (int i = 0; i < models.size(); i++)
+    {
+        ModelData &model = models[i];
+        if (model.poseStart < 0)
+        {
+            continue;
+        }
+
+        // Pose unchanged over both steps and already shown, nothing to do for parked yachts
+        unsigned int version = current.poseVersions[i];
+        bool settled = !blend || previous.poseVersions[i] == version;
+        if (settled && model.poseVersion == version)
+        {
+            continue;
+        }
+
+        // Pose of slice for this frame
+        int end = model.poseStart + model.boneCount;
+        for (int j = model.poseStart; j < end; j++)
+        {
+            poses[j] = settled ? current.poses[j] : interpolateTransform(previous.poses[j], current.poses[j], t);
+        }
+        model.poseVersion = settled ? version : 0;
+
+        // Sail cloth moves with pose
+        if (model.clothInstance >= 0 && hasCloth)
+        {
+            int clothEnd = (model.clothInstance + 1) * SailCloth::particles;
+            for (int j = model.clothInstance * SailCloth::particles; j < clothEnd; j++)
+            {
+                cloth[j] = settled || !blendCloth ? current.cloth[j] : glm::mix(previous.cloth[j], current.cloth[j], t);
+            }
+            currentScene->clothVersion++;
+        }
+
+        // Encode skinning palette once, every pass draws with it
+        BonePalette::encode(model.paletteEncoding, model.boneTransforms, model.model->skeleton.inverseOffsets, model.boneCount, model.bonePalette);
+        model.paletteVersion++;
+    }
+
+    // Camera follows controlled yacht
+    if (current.cameraFollow)
+    {
+        if (previous.cameraFollow)
+        {
+            // Take short way around for yaw
+            float yawChange = std::remainder(current.cameraYaw - previous.cameraYaw, 2.0f * (float)M_PI);
+
+            Camera::cameraPosition = glm::mix(previous.cameraPosition, current.cameraPosition, t);
+            Camera::yaw = previous.cameraYaw + t * yawChange;
+        }
+        else
+        {
+            Camera::cameraPosition = current.cameraPosition;
+            Camera::yaw = current.cameraYaw;
+        }
+    }
+
+    Render::debugPhysicsData = frame.debugPhysicsData;
+}
+
+void SceneManager::startSimulation()
+{
+    simulationRunning = true;
+    simulationThread = std::thread(simulate);
+}
+
+void SceneManager::stopSimulation()
+{
+    simulationRunning = false;
+    if (simulationThread.joinable())
+    {
+        simulationThread.join();
+    }
+}
+
+void SceneManager::simulate()
+{
+    float stepTime = 1.0f / simulationRate;
+    float accumulator = 0.0f;
+    auto lastTime = std::chrono::steady_clock::now();
+
+    while (simulationRunning)
+    {
+        auto now = std::chrono::steady_clock::now();
+        accumulator += std::chrono::duration<float>(now - lastTime).count();
+        lastTime = now;
+
+        // Take fixed steps for elapsed time
+        int steps = 0;
+        while (accumulator >= stepTime && steps < maxSimulationSteps)
+        {
+            accumulator -= stepTime;
+            steps++;
+
+            // Time this step's state belongs to
+            auto stepEnd = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(accumulator));
+            step(stepTime, stepEnd);
+        }
+
+        // Too far behind, drop time instead of spiralling into ever more steps
+        if (steps == maxSimulationSteps && accumulator >= stepTime)
+        {
+            droppedSteps += (int)(accumulator / stepTime);
+            accumulator = std::fmod(accumulator, stepTime);
+        }
+
+        // Sleep until next step is due
+        std::this_thread::sleep_for(std::chrono::duration<float>(stepTime - accumulator));
+    }
+}
+
+void SceneManager::step(float stepTime, std::chrono::steady_clock::time_point time)
+{
+    std::lock_guard<std::mutex> lock(sceneMutex);
+
+    // Only simulate loaded scenes, keys are still taken so none pile up for the next one
+    if (!currentScene || loadingState != 0)
+    {
+        Physics::takeInput(time);
+        return;
+    }
+
+    // Start interpolating fresh in new scene
+    if (lastStateScene != sceneId)
+    {
+        lastState = FrameState();
+        lastStateScene = sceneId;
+        InputRecorder::beginScene(currentScene->name);
+        Animation::setup(*currentScene);
+    }
+
+    // Frame written for an old scene holds none of this one's poses
+    Frame &frame = frames.back();
+    if (frame.sceneId != sceneId)
+    {
+        frame.current.poseVersions.clear();
+    }
+    frame.sceneId = sceneId;
+    frame.step++;
+    frame.time = time;
+    frame.stepTime = stepTime;
+
+    // Inputs of this step, recorded or replaced by replay
+    Physics::takeInput(time);
+    InputRecorder::step(Physics::input);
+
+    // Overlay values only while overlay is shown, fresh every step
+    Physics::debug = Render::debugPhysics;
+    if (Physics::debug)
+    {
+        Physics::debugData = PhysicsDebug();
+    }
+
+    // Move yachts with fixed step and pose their bones into frame
+    Physics::deltaTime = stepTime;
+    Physics::update(*currentScene);
+
+    // Last step's state moves into frame as start of interpolation, its old storage is kept for this step's
+    std::swap(frame.previous, lastState);
+    Animation::updateBones(*currentScene, frame.current);
+
+    // Keep state for next frame to interpolate from, only slices posed since that storage last held it
+    Animation::copyState(*currentScene, frame.current, lastState);
+
+    if (Physics::debug)
+    {
+        Physics::debugData.droppedSteps = droppedSteps;
+        frame.debugPhysicsData = Physics::debugData;
+    }
+
+    frames.publish();
+}
+
 void SceneManager::unload()
 {
+    std::lock_guard<std::mutex> lock(sceneMutex);
+
     // Reset scene variable. Calls destructors
     currentScene.reset();
 
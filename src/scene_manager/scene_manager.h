@@ -2,8 +2,12 @@
 #define SCENE_MANAGER_H
 
 #include "scene/scene.h"
+#include "frame/frame.h"
 
+#include <atomic>
 #include <future>
+#include <mutex>
+#include <thread>
 
 class SceneManager
 {
@@ -11,6 +15,10 @@ public:
     // Global Scene variables
     static std::shared_ptr<Scene> currentScene;
     static std::future<std::shared_ptr<Scene>> pendingScene;
+    static unsigned int sceneId;
+
+    // Held by simulation while stepping, and by anything replacing or changing the scene from main
+    static std::mutex sceneMutex;
 
     // Scenemap and paths
     static std::map<std::string, std::string> sceneMap;
@@ -18,7 +26,7 @@ public:
 
     // Global loading variables
     static bool onTitleScreen;
-    static int loadingState;
+    static std::atomic<int> loadingState;
     static std::pair<int, int> loadingProgress;
 
     // Load scene
@@ -30,6 +38,26 @@ public:
     static void update();
     static void render();
     static void renderLoading();
+
+    // Simulation thread, produces frames for render at fixed rate
+    static FrameMailbox frames;
+    static float simulationRate;
+    static int maxSimulationSteps;
+    static int droppedSteps;
+    static void startSimulation();
+    static void stopSimulation();
+
+private:
+    static std::thread simulationThread;
+    static std::atomic<bool> simulationRunning;
+
+    // State of last step, start of interpolation for next frame
+    static FrameState lastState;
+    static unsigned int lastStateScene;
+
+    static void simulate();
+    static void step(float stepTime, std::chrono::steady_clock::time_point time);
+    static void applyFrame(const Frame &frame);
 };
 
 #endif
\ No newline at end of file
@@ -34,6 +34,19 @@ Shader *Shader::load(const std::string &shaderName)
     return shaderPtr;
 }
 
+Shader *Shader::loadFeedback(const std::string &shaderName, const std::vector<std::string> &varyings)
+{
+    if (loadedShaders.find(shaderName) == loadedShaders.end())
+    {
+        Shader shader;
+        shader.m_feedbackVaryings = varyings;
+        shader.init(FileManager::read("shaders/" + shaderName + ".vs"), "");
+        loadedShaders.emplace(shaderName, shader);
+    }
+
+    return load(shaderName);
+}
+
 void Shader::init(const std::string &vertexCode, const std::string &fragmentCode)
 {
     m_vertexCode = vertexCode;
@@ -112,6 +125,11 @@ void Shader::setMat4Array(const std::string &name, const std::vector<glm::mat4>
     glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), mats.size(), GL_FALSE, glm::value_ptr(mats[0]));
 }
 
+void Shader::setVec4Array(const std::string &name, const std::vector<glm::vec4> &values) const
+{
+    glUniform4fv(glGetUniformLocation(m_id, name.c_str()), values.size(), glm::value_ptr(values[0]));
+}
+
 void Shader::compile()
 {
     const char *vsCode = m_vertexCode.c_str();
@@ -120,6 +138,12 @@ void Shader::compile()
     glCompileShader(m_vertexId);
     checkCompileError(m_vertexId, "Vertex Shader");
 
+    // Transform feedback shaders have no fragment stage
+    if (m_fragmentCode.empty())
+    {
+        return;
+    }
+
     const char *fsCode = m_fragmentCode.c_str();
     m_fragmentId = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(m_fragmentId, 1, &fsCode, NULL);
@@ -131,11 +155,29 @@ void Shader::link()
 {
     m_id = glCreateProgram();
     glAttachShader(m_id, m_vertexId);
-    glAttachShader(m_id, m_fragmentId);
+    if (!m_fragmentCode.empty())
+    {
+        glAttachShader(m_id, m_fragmentId);
+    }
+
+    // Outputs to capture have to be known before linking
+    if (!m_feedbackVaryings.empty())
+    {
+        std::vector<const char *> varyings;
+        for (const std::string &varying : m_feedbackVaryings)
+        {
+            varyings.push_back(varying.c_str());
+        }
+        glTransformFeedbackVaryings(m_id, varyings.size(), varyings.data(), GL_INTERLEAVED_ATTRIBS);
+    }
+
     glLinkProgram(m_id);
     checkLinkingError();
     glDeleteShader(m_vertexId);
-    glDeleteShader(m_fragmentId);
+    if (!m_fragmentCode.empty())
+    {
+        glDeleteShader(m_fragmentId);
+    }
 }
 
 void Shader::checkCompileError(unsigned int shader, const std::string type)
@@ -17,6 +17,9 @@ class Shader
 {
 public:
     static Shader *load(const std::string &shaderName);
+
+    // Vertex only shader whose outputs are captured interleaved by transform feedback
+    static Shader *loadFeedback(const std::string &shaderName, const std::vector<std::string> &varyings);
     static void unload();
     void use();
 
@@ -35,6 +38,7 @@ public:
     void setMat3(const std::string &name, const glm::mat3 &mat) const;
     void setMat4(const std::string &name, const glm::mat4 &mat) const;
     void setMat4Array(const std::string &name, const std::vector<glm::mat4> &mats) const;
+    void setVec4Array(const std::string &name, const std::vector<glm::vec4> &values) const;
 
     static std::unordered_map<std::string, Shader> loadedShaders;
 
@@ -49,6 +53,7 @@ private:
 
     std::string m_vertexCode;
     std::string m_fragmentCode;
+    std::vector<std::string> m_feedbackVaryings;
 
     void compile();
     void link();
@@ -0,0 +1,9 @@
+#version 410 core
+
+out vec4 FragColor;
+
+void main()
+{
+    // Only used for occlusion queries, color is never written
+    FragColor = vec4(1.0);
+}
@@ -0,0 +1,12 @@
+#version 410 core
+
+layout(location = 0) in vec3 aPos;
+
+uniform mat4 u_model;
+uniform mat4 u_view;
+uniform mat4 u_projection;
+
+void main()
+{
+    gl_Position = u_projection * u_view * u_model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,119 @@
+#version 410 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 3) in ivec4 aBoneIDs;
+layout(location = 4) in vec4 aWeights;
+layout(location = 5) in vec3 aCloth;
+
+// Skinned vertex in model space, captured by transform feedback
+out vec3 skinnedPosition;
+out vec3 skinnedNormal;
+
+const int maxBoneInfluence = 4;
+
+// Skinning transforms, encoded as in BonePalette: 0 matrix, 1 affine rows, 2 dual quaternion
+const int maxPaletteVectors = 200;
+uniform int paletteEncoding;
+uniform vec4 u_bonePalette[maxPaletteVectors];
+
+mat4 boneMatrix(int bone)
+{
+    if(paletteEncoding == 0)
+    {
+        return mat4(u_bonePalette[4 * bone], u_bonePalette[4 * bone + 1], u_bonePalette[4 * bone + 2], u_bonePalette[4 * bone + 3]);
+    }
+    return transpose(mat4(u_bonePalette[3 * bone], u_bonePalette[3 * bone + 1], u_bonePalette[3 * bone + 2], vec4(0, 0, 0, 1)));
+}
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+// Sail cloth offsets of instance from clothStart, grid as in SailCloth, -1 for a rigid sail
+const int clothColumns = 8;
+const int clothRows = 6;
+uniform samplerBuffer u_cloth;
+uniform int clothStart;
+
+vec3 clothOffset()
+{
+    // Vertex off sail, or instance without cloth
+    if(clothStart < 0 || aCloth.z == 0.0)
+    {
+        return vec3(0);
+    }
+
+    // Bilinear between grid particles around vertex
+    vec2 cell = clamp(aCloth.xy, 0.0, 1.0) * vec2(clothColumns - 1, clothRows - 1);
+    ivec2 corner = min(ivec2(cell), ivec2(clothColumns - 2, clothRows - 2));
+    vec2 f = cell - vec2(corner);
+    int k = clothStart + corner.y * clothColumns + corner.x;
+    vec3 bottom = mix(texelFetch(u_cloth, k).xyz, texelFetch(u_cloth, k + 1).xyz, f.x);
+    vec3 top = mix(texelFetch(u_cloth, k + clothColumns).xyz, texelFetch(u_cloth, k + clothColumns + 1).xyz, f.x);
+    return mix(bottom, top, f.y) * aCloth.z;
+}
+
+void main()
+{
+    // Bind pose position with sail cloth billow, skinned as usual after
+    vec3 position = aPos + clothOffset();
+
+    // Initialize the final position of the vertex
+    vec4 finalPosition = vec4(0);
+    vec3 finalNormal = vec3(0);
+
+    if(paletteEncoding == 2)
+    {
+        // Blend dual quaternions, flipped onto hemisphere of first bone so rotations take the short way
+        vec4 real = vec4(0);
+        vec4 dual = vec4(0);
+        vec4 pivot = u_bonePalette[2 * aBoneIDs[0]];
+        for(int i = 0; i < maxBoneInfluence; i++)
+        {
+            int boneID = aBoneIDs[i];
+            float weight = aWeights[i];
+
+            if(weight > 0.0)
+            {
+                vec4 boneReal = u_bonePalette[2 * boneID];
+                float signedWeight = dot(boneReal, pivot) < 0.0 ? -weight : weight;
+                real += boneReal * signedWeight;
+                dual += u_bonePalette[2 * boneID + 1] * signedWeight;
+            }
+        }
+
+        float len = length(real);
+        if(len > 0.0)
+        {
+            real /= len;
+            dual /= len;
+
+            // Translation is 2 * dual * conjugate(real)
+            vec3 translation = 2.0 * (real.w * dual.xyz - dual.w * real.xyz + cross(real.xyz, dual.xyz));
+            finalPosition = vec4(rotate(real, position) + translation, 1.0);
+            finalNormal = rotate(real, aNormal);
+        }
+    }
+    else
+    {
+        // Apply the bone transforms based on the weights and bone IDs
+        for(int i = 0; i < maxBoneInfluence; i++)
+        {
+            int boneID = aBoneIDs[i];
+            float weight = aWeights[i];
+
+            if(weight > 0.0)
+            {
+                // Skinning transform to the vertex position and normal
+                mat4 skin = boneMatrix(boneID);
+
+                finalPosition += skin * vec4(position, 1.0) * weight;
+                finalNormal += transpose(inverse(mat3(skin))) * aNormal * weight; // Use the rotation part of the matrix for normal
+            }
+        }
+    }
+
+    skinnedPosition = finalPosition.xyz;
+    skinnedNormal = finalNormal;
+}
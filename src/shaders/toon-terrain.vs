@@ -1,25 +1,38 @@
 #version 410 core
 
-layout(location = 0) in vec3 aPosition;
+layout(location = 0) in vec2 aPosition;
+layout(location = 1) in vec4 aTile; // origin xy, spacing, level
 
 out vec2 TexCoord;
 
 uniform mat4 u_model;
 uniform mat4 u_view;
 uniform mat4 u_projection;
-uniform mat4 u_camXY;
 
 uniform sampler2D heightmap;
 
-uniform float lod;
+uniform vec2 cameraXY;
+uniform float morphStart;
+uniform float morphWidth;
+uniform float heightScale;
 
 const float scale = 1024;
 
 void main()
 {
-    vec4 worldPos = u_camXY * u_model * vec4(aPosition, 1.0);
+    // Integer grid position of vertex in its level
+    float spacing = aTile.z;
+    vec2 gridPos = round(aTile.xy / spacing) + aPosition;
+    vec2 localPos = gridPos * spacing;
+
+    // Near outer edge of level, morph odd vertices onto coarser grid to hide seams
+    vec2 distance = abs(localPos - cameraXY) / spacing;
+    float morph = clamp((max(distance.x, distance.y) - morphStart) / morphWidth, 0.0, 1.0);
+    localPos -= mod(gridPos, 2.0) * spacing * morph;
+
+    vec4 worldPos = u_model * vec4(localPos, 0.0, 1.0);
     TexCoord = worldPos.xy / (scale) + vec2(0.5);
-    float height = texture(heightmap, TexCoord).r;
-    worldPos.z = 3 * height - lod / 24;
+    float height = textureLod(heightmap, TexCoord, 0.0).r;
+    worldPos.z += heightScale * height;
     gl_Position = u_projection * u_view * worldPos;
-}
\ No newline at end of file
+}
@@ -0,0 +1,169 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sim/sim.h"
+#include "physics/physics.h"
+
+// Image loader for heightfield, the game has it in model.cpp
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// Split comma separated list of numbers
+static std::vector<float> parseList(const std::string &text)
+{
+    std::vector<float> values;
+    std::stringstream stream(text);
+    std::string value;
+    while (std::getline(stream, value, ','))
+    {
+        values.push_back(std::stof(value));
+    }
+    return values;
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: marama_sim <scene> [options]\n"
+              << "  --script <file>          Key inputs as time,up,down,left,right,p lines\n"
+              << "  --duration <s>           Simulated seconds per scenario (default 60)\n"
+              << "  --speed <n>              Run at n times realtime, 0 for as fast as possible (default 0)\n"
+              << "  --wind-angle <a,b,..>    Wind angles in degrees to sweep (default 0)\n"
+              << "  --wind-strength <a,b,..> Wind strengths to sweep (default 10)\n"
+              << "  --param <name=a,b,..>    Yacht property to sweep, repeatable\n"
+              << "  --gusts <n>              Scale of wind field gusts, 0 for uniform wind (default 1)\n"
+              << "  --polars <mode>          Sail coefficients from on: tables, off: analytic, validate: compare (default on)\n"
+              << "  --autopilot <on|off>     Sail yachts without script around scene waypoints (default on)\n"
+              << "  --telemetry <file>       Record every tick, one file per scenario with its number appended\n"
+              << "  --threads <n>            Worker threads (default all cores)\n"
+              << "  --serve <port>           Multiplayer server for scene instead of a sweep, runs until stopped\n"
+              << "  --out <file>             Result CSV (default sim.csv)\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return -1;
+    }
+
+    std::string sceneName = argv[1];
+    std::string scriptPath;
+    std::string outPath = "sim.csv";
+    std::vector<float> windAngles = {0.0f};
+    std::vector<float> windStrengths = {Physics::windStrength};
+    std::vector<std::pair<std::string, std::vector<float>>> parameters;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    bool validatePolars = false;
+    int servePort = 0;
+
+    try
+    {
+        // Read options
+        for (int i = 2; i < argc; i++)
+        {
+            std::string option = argv[i];
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error("Missing value for " + option);
+            }
+            std::string value = argv[++i];
+
+            if (option == "--script")
+                scriptPath = value;
+            else if (option == "--duration")
+                Sim::duration = std::stof(value);
+            else if (option == "--speed")
+                Sim::speed = std::stof(value);
+            else if (option == "--wind-angle")
+                windAngles = parseList(value);
+            else if (option == "--wind-strength")
+                windStrengths = parseList(value);
+            else if (option == "--polars")
+            {
+                if (value != "on" && value != "off" && value != "validate")
+                {
+                    throw std::runtime_error("Unknown polar mode: " + value);
+                }
+                Sim::usePolars = value != "off";
+                validatePolars = value == "validate";
+            }
+            else if (option == "--gusts")
+                Sim::gusts = std::stof(value);
+            else if (option == "--autopilot")
+                Sim::useAutopilot = value != "off";
+            else if (option == "--telemetry")
+                Sim::telemetryPath = value;
+            else if (option == "--threads")
+                threads = std::stoi(value);
+            else if (option == "--serve")
+                servePort = std::stoi(value);
+            else if (option == "--out")
+                outPath = value;
+            else if (option == "--param")
+            {
+                size_t split = value.find('=');
+                std::string name = value.substr(0, split);
+                if (split == std::string::npos || !Sim::isParameter(name))
+                {
+                    throw std::runtime_error("Unknown yacht property: " + name);
+                }
+                parameters.push_back({name, parseList(value.substr(split + 1))});
+            }
+            else
+            {
+                throw std::runtime_error("Unknown option: " + option);
+            }
+        }
+
+        // Load scene and script
+        std::vector<SimYacht> yachts = Sim::loadScene(sceneName);
+
+        // Server runs instead of sweep
+        if (servePort > 0)
+        {
+            Sim::serve(sceneName, yachts, servePort);
+            return 0;
+        }
+
+        std::vector<SimInput> script;
+        if (!scriptPath.empty())
+        {
+            script = Sim::loadScript(scriptPath);
+        }
+
+        // Report polar table error per yacht type
+        if (validatePolars)
+        {
+            for (const SimYacht &yacht : yachts)
+            {
+                float liftError, dragError, driveError;
+                Physics(yacht.path).polar->validate(liftError, dragError, driveError);
+                std::cout << yacht.name << " polar error, lift " << liftError << ", drag " << dragError << ", drive " << driveError << std::endl;
+            }
+        }
+
+        // Run sweep
+        std::vector<SimScenario> scenarios = Sim::sweep(windAngles, windStrengths, parameters);
+        std::cout << "Running " << scenarios.size() << " scenarios of " << yachts.size() << " yachts on " << threads << " threads" << std::endl;
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<SimResult> results = Sim::runAll(scenarios, yachts, script, threads);
+        float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+        Sim::writeCSV(outPath, scenarios, results);
+        std::cout << "Simulated " << scenarios.size() * Sim::duration << " s in " << seconds << " s, results in " << outPath << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,563 @@
+#include "sim/sim.h"
+
+#include <jsoncons/json.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "physics/physics.h"
+#include "autopilot/autopilot.h"
+#include "fleet/fleet.h"
+#include "clipmap/clipmap.h"
+#include "collision/collision.h"
+#include "file_manager/file_manager.h"
+#include "ground/ground.h"
+#include "heightfield/heightfield.h"
+#include "simulation_lod/simulation_lod.h"
+#include "sync_server/sync_server.h"
+#include "telemetry/telemetry.h"
+#include "wind_field/wind_field.h"
+
+// Run settings
+float Sim::duration = 60.0f;
+float Sim::speed = 0.0f;
+float Sim::stepRate = 120.0f;
+bool Sim::usePolars = true;
+float Sim::gusts = 1.0f;
+bool Sim::useAutopilot = true;
+std::vector<glm::vec2> Sim::waypoints;
+Heightfield Sim::terrain;
+std::string Sim::telemetryPath;
+
+// Yacht properties that can be swept
+static const std::map<std::string, float Physics::*> parameterMap = {
+    {"maxMastAngle", &Physics::maxMastAngle},
+    {"maxBoomAngle", &Physics::maxBoomAngle},
+    {"maxLiftCoefficient", &Physics::maxLiftCoefficient},
+    {"optimalAngle", &Physics::optimalAngle},
+    {"minDragCoefficient", &Physics::minDragCoefficient},
+    {"sailArea", &Physics::sailArea},
+    {"rollCoefficient", &Physics::rollCoefficient},
+    {"rollScaling", &Physics::rollScaling},
+    {"mass", &Physics::mass},
+    {"bodyDragCoefficient", &Physics::bodyDragCoefficient},
+    {"bodyArea", &Physics::bodyArea},
+    {"steeringSmoothness", &Physics::steeringSmoothness},
+    {"maxSteeringAngle", &Physics::maxSteeringAngle},
+    {"steeringAttenuation", &Physics::steeringAttenuation}};
+
+static jsoncons::json loadJSON(const std::string &path)
+{
+    // Check if the file exists
+    if (!std::filesystem::exists(path))
+    {
+        throw std::runtime_error("File not found: " + path);
+    }
+
+    // Open the file
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    // Parse the JSON
+    try
+    {
+        return jsoncons::json::parse(file);
+    }
+    catch (const std::exception &e)
+    {
+        throw std::runtime_error("Failed to parse JSON: " + std::string(e.what()));
+    }
+}
+
+// Value of attribute in XML tag starting at tag, empty if tag has none
+static std::string attribute(const std::string &text, size_t tag, const std::string &name)
+{
+    size_t end = text.find('>', tag);
+    size_t at = text.find(" " + name + "=\"", tag);
+    if (at == std::string::npos || at > end)
+    {
+        return "";
+    }
+    at += name.size() + 3;
+    return text.substr(at, text.find('"', at) - at);
+}
+
+// Bounds of all mesh vertices, same as Model finds on import. Read straight from the position sources of the
+// COLLADA file, so the sim needs no model importer
+static void loadBounds(const std::string &path, glm::vec3 &boundsMin, glm::vec3 &boundsMax)
+{
+    std::ifstream file(FileManager::getPath(path));
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not load model: " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    boundsMin = glm::vec3(INFINITY);
+    boundsMax = glm::vec3(-INFINITY);
+    bool found = false;
+
+    // Vertices of every mesh name their position source
+    for (size_t vertices = text.find("<vertices"); vertices != std::string::npos; vertices = text.find("<vertices", vertices + 1))
+    {
+        size_t position = text.find("semantic=\"POSITION\"", vertices);
+        if (position == std::string::npos || position > text.find("</vertices>", vertices))
+        {
+            continue;
+        }
+        std::string id = attribute(text, text.rfind("<input", position), "source");
+        size_t source = id.empty() ? std::string::npos : text.find("<source id=\"" + id.substr(1) + "\"");
+        if (source == std::string::npos)
+        {
+            continue;
+        }
+
+        // Accessor gives count and stride of values in array, xyz first
+        size_t array = text.find("<float_array", source);
+        size_t accessor = text.find("<accessor", source);
+        std::string stride = attribute(text, accessor, "stride");
+        int count = std::stoi(attribute(text, accessor, "count"));
+        std::vector<float> values(std::max(stride.empty() ? 3 : std::stoi(stride), 3));
+
+        size_t start = text.find('>', array) + 1;
+        std::istringstream stream(text.substr(start, text.find("</float_array>", array) - start));
+        for (int i = 0; i < count; i++)
+        {
+            for (float &value : values)
+            {
+                stream >> value;
+            }
+            glm::vec3 point(values[0], values[1], values[2]);
+            boundsMin = glm::min(boundsMin, point);
+            boundsMax = glm::max(boundsMax, point);
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        throw std::runtime_error("Could not load model: " + path);
+    }
+}
+
+bool Sim::isParameter(const std::string &name)
+{
+    return parameterMap.find(name) != parameterMap.end();
+}
+
+std::vector<SimYacht> Sim::loadScene(const std::string &sceneName)
+{
+    // Scene name from scene map, or path to scene file
+    std::string scenePath = sceneName;
+    jsoncons::json sceneMap = loadJSON("../resources/scenes.json");
+    if (sceneMap["scenes"].contains(sceneName))
+    {
+        scenePath = "../" + sceneMap["scenes"][sceneName].as<std::string>();
+    }
+
+    // Yacht paths by name
+    std::map<std::string, std::string> yachtPaths;
+    jsoncons::json modelMap = loadJSON("../resources/models.json");
+    for (const auto &yacht : modelMap["yachts"].array_range())
+    {
+        yachtPaths[yacht["name"].as<std::string>()] = yacht["path"].as<std::string>();
+    }
+
+    // Animated yachts of scene get physics, same as in game
+    std::vector<SimYacht> yachts;
+    jsoncons::json scene = loadJSON(scenePath);
+    for (const auto &model : scene["models"].array_range())
+    {
+        std::string name = model["name"].as<std::string>();
+        bool animated = model.get_value_or<bool>("animated", false);
+
+        if (animated && yachtPaths.find(name) != yachtPaths.end())
+        {
+            SimYacht yacht;
+            yacht.name = name;
+            yacht.path = yachtPaths[name];
+            yacht.controlled = model.get_value_or<bool>("controlled", false);
+
+            // Placement as in Scene::loadModelToScene, with JSONModel defaults
+            std::vector<float> translation = model.get_value_or<std::vector<float>>("translation", {0.0f, 0.0f, 0.0f});
+            std::vector<float> rotationAxis = model.get_value_or<std::vector<float>>("rotationAxis", {0.0f, 1.0f, 0.0f});
+            std::vector<float> scale = model.get_value_or<std::vector<float>>("scale", {1.0f, 1.0f, 1.0f});
+            float angle = model.get_value_or<float>("angle", 0.0f);
+            yacht.placement = glm::scale(
+                glm::rotate(
+                    glm::translate(glm::mat4(1.0f), glm::vec3(translation[0], translation[1], translation[2])),
+                    glm::radians(angle),
+                    glm::vec3(rotationAxis[0], rotationAxis[1], rotationAxis[2])),
+                glm::vec3(scale[0], scale[1], scale[2]));
+
+            loadBounds(yacht.path, yacht.boundsMin, yacht.boundsMax);
+            yachts.push_back(yacht);
+        }
+    }
+
+    // Yachts stand on first terrain grid, heightmap loaded as Scene::loadGridToScene does
+    terrain = Heightfield();
+    if (scene.contains("grids"))
+    {
+        for (const auto &grid : scene["grids"].array_range())
+        {
+            if (grid.get_value_or<std::string>("shader", "toon-terrain") == "toon-terrain")
+            {
+                std::vector<float> translation = grid.get_value_or<std::vector<float>>("translation", {0.0f, 0.0f, 0.0f});
+                terrain.load(FileManager::getPath("resources/textures/heightmap.jpg"), glm::vec3(translation[0], translation[1], translation[2]), Clipmap().heightScale);
+                break;
+            }
+        }
+    }
+
+    // Course, same as Scene reads it
+    waypoints.clear();
+    if (scene.contains("waypoints"))
+    {
+        for (const auto &waypoint : scene["waypoints"].array_range())
+        {
+            std::vector<float> point = waypoint.as<std::vector<float>>();
+            waypoints.push_back(glm::vec2(point[0], point[1]));
+        }
+    }
+
+    return yachts;
+}
+
+std::vector<SimInput> Sim::loadScript(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    // Lines of time,up,down,left,right,p with 0 or 1 per key
+    std::vector<SimInput> script;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#' || !(std::isdigit(line[0]) || line[0] == '.'))
+        {
+            continue;
+        }
+
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream stream(line);
+
+        SimInput input;
+        stream >> input.time;
+        for (bool &key : input.keys)
+        {
+            int value = 0;
+            stream >> value;
+            key = value != 0;
+        }
+
+        script.push_back(input);
+    }
+
+    // Inputs in time order
+    std::stable_sort(script.begin(), script.end(), [](const SimInput &a, const SimInput &b)
+                     { return a.time < b.time; });
+
+    return script;
+}
+
+std::vector<SimScenario> Sim::sweep(const std::vector<float> &windAngles, const std::vector<float> &windStrengths,
+                                    const std::vector<std::pair<std::string, std::vector<float>>> &parameters)
+{
+    std::vector<SimScenario> scenarios;
+
+    // Count combinations of parameter values
+    int parameterCombinations = 1;
+    for (const auto &parameter : parameters)
+    {
+        parameterCombinations *= parameter.second.size();
+    }
+
+    for (float windAngle : windAngles)
+    {
+        for (float windStrength : windStrengths)
+        {
+            for (int combination = 0; combination < parameterCombinations; combination++)
+            {
+                SimScenario scenario;
+                scenario.id = scenarios.size();
+                scenario.windAngle = windAngle;
+                scenario.windStrength = windStrength;
+
+                // Pick value of each parameter from combination index
+                int rest = combination;
+                for (const auto &parameter : parameters)
+                {
+                    int values = parameter.second.size();
+                    scenario.parameters.push_back({parameter.first, parameter.second[rest % values]});
+                    rest /= values;
+                }
+
+                scenarios.push_back(scenario);
+            }
+        }
+    }
+
+    return scenarios;
+}
+
+std::vector<SimResult> Sim::runAll(const std::vector<SimScenario> &scenarios, const std::vector<SimYacht> &yachts,
+                                   const std::vector<SimInput> &script, int threads)
+{
+    std::vector<std::vector<SimResult>> results(scenarios.size());
+    std::atomic<int> next = 0;
+
+    // Each worker takes next scenario until none left
+    auto worker = [&]()
+    {
+        for (int i = next++; i < scenarios.size(); i = next++)
+        {
+            results[i] = run(scenarios[i], yachts, script);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::max(threads, 1); i++)
+    {
+        workers.emplace_back(worker);
+    }
+    for (std::thread &thread : workers)
+    {
+        thread.join();
+    }
+
+    // Flatten in scenario order
+    std::vector<SimResult> flat;
+    for (const auto &scenarioResults : results)
+    {
+        flat.insert(flat.end(), scenarioResults.begin(), scenarioResults.end());
+    }
+
+    return flat;
+}
+
+std::vector<SimResult> Sim::run(const SimScenario &scenario, const std::vector<SimYacht> &yachts, const std::vector<SimInput> &script)
+{
+    // Fleet of scene yachts with swept properties, controlled ones follow script
+    Fleet fleet;
+    Collision collision;
+    Ground ground;
+    SimulationLod lod;
+    Autopilot autopilot;
+    autopilot.enabled = useAutopilot;
+    std::vector<int> controlled;
+    for (const SimYacht &yacht : yachts)
+    {
+        Physics physics(yacht.path);
+        for (const auto &parameter : scenario.parameters)
+        {
+            physics.*parameterMap.at(parameter.first) = parameter.second;
+        }
+        physics.buildPolar();
+        if (yacht.controlled)
+        {
+            controlled.push_back(fleet.size());
+        }
+        fleet.add(physics, yacht.placement);
+        collision.add(yacht.boundsMin, yacht.boundsMax, yacht.placement);
+        ground.add(yacht.boundsMin, yacht.boundsMax, yacht.placement);
+        lod.add(yacht.boundsMin, yacht.boundsMax, yacht.placement);
+        autopilot.add();
+    }
+    autopilot.setCourse(waypoints);
+    fleet.usePolars = usePolars;
+
+    // Wind blowing towards angle, 0 is along -Y like the default wind
+    float angle = glm::radians(scenario.windAngle);
+    glm::vec3 windDirection(std::sin(angle), -std::cos(angle), 0.0f);
+
+    // Same gusts in every scenario, made inline since scenarios already run in parallel
+    WindField wind;
+    wind.gustStrength *= gusts;
+    wind.gustShift *= gusts;
+    wind.start(windDirection, scenario.windStrength, false);
+
+    // Stepped as the game steps its scene. No camera, so every yacht stays near
+    PhysicsWorld world = {wind, fleet, collision, terrain, ground, lod, autopilot};
+    SimulationView view;
+
+    float stepTime = 1.0f / stepRate;
+    int steps = (int)std::ceil(duration * stepRate);
+
+    // Record to given path, scenario number before extension
+    Telemetry telemetry;
+    if (!telemetryPath.empty())
+    {
+        std::filesystem::path path = telemetryPath;
+        path.replace_filename(path.stem().string() + "-" + std::to_string(scenario.id) + path.extension().string());
+        if (!telemetry.start(path.string()))
+        {
+            std::cerr << "Could not open file: " << path.string() << ", scenario " << scenario.id << " runs without telemetry" << std::endl;
+        }
+    }
+
+    std::vector<float> velocitySum(yachts.size(), 0.0f);
+    std::vector<float> maxVelocity(yachts.size(), 0.0f);
+
+    auto start = std::chrono::steady_clock::now();
+    int nextInput = 0;
+    SimInput held;
+
+    for (int step = 0; step < steps; step++)
+    {
+        // Take inputs that are due
+        float time = step * stepTime;
+        while (nextInput < script.size() && script[nextInput].time <= time)
+        {
+            held = script[nextInput++];
+        }
+
+        Physics::stepWorld(world, time, stepTime, controlled, held.keys, view);
+        telemetry.record(fleet, (step + 1) * stepTime);
+
+        for (int i = 0; i < yachts.size(); i++)
+        {
+            velocitySum[i] += fleet.velocity[i];
+            maxVelocity[i] = std::max(maxVelocity[i], fleet.velocity[i]);
+        }
+
+        // Hold back to speed times realtime, 0 runs as fast as possible
+        if (speed > 0.0f)
+        {
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>((step + 1) * stepTime / speed)));
+        }
+    }
+
+    // Collect results per yacht
+    std::vector<SimResult> results;
+    for (int i = 0; i < yachts.size(); i++)
+    {
+        SimResult result;
+        result.scenario = scenario.id;
+        result.yacht = yachts[i].name;
+        result.finalX = fleet.positionX[i];
+        result.finalY = fleet.positionY[i];
+        result.distance = glm::length(glm::vec2(result.finalX, result.finalY));
+        result.heading = glm::degrees(std::atan2(fleet.headingX[i], fleet.headingY[i]));
+        result.averageVelocity = steps > 0 ? velocitySum[i] / steps : 0.0f;
+        result.maxVelocity = maxVelocity[i];
+        results.push_back(result);
+    }
+
+    return results;
+}
+
+void Sim::serve(const std::string &sceneName, const std::vector<SimYacht> &yachts, uint16_t port)
+{
+    // Fleet of scene yachts, same as game sets up
+    Fleet fleet;
+    Collision collision;
+    Ground ground;
+    SimulationLod lod;
+    Autopilot autopilot;
+    autopilot.enabled = useAutopilot;
+    for (const SimYacht &yacht : yachts)
+    {
+        fleet.add(Physics(yacht.path), yacht.placement);
+        collision.add(yacht.boundsMin, yacht.boundsMax, yacht.placement);
+        ground.add(yacht.boundsMin, yacht.boundsMax, yacht.placement);
+        lod.add(yacht.boundsMin, yacht.boundsMax, yacht.placement);
+        autopilot.add();
+    }
+    autopilot.setCourse(waypoints);
+    fleet.usePolars = usePolars;
+
+    // Default wind of game, so gusts match what clients sail in
+    WindField wind;
+    wind.gustStrength *= gusts;
+    wind.gustShift *= gusts;
+    wind.start(Physics::windDirection, Physics::windStrength, true);
+
+    // Stepped as the game steps its scene, no yacht takes keys here
+    PhysicsWorld world = {wind, fleet, collision, terrain, ground, lod, autopilot};
+    std::vector<int> controlled;
+    bool keys[5] = {false, false, false, false, false};
+    SimulationView view;
+
+    SyncServer server;
+    if (!server.start(port, sceneName, fleet.size()))
+    {
+        throw std::runtime_error("Could not open port " + std::to_string(port));
+    }
+    std::cout << "Serving " << sceneName << " with " << fleet.size() << " yachts on port " << port << std::endl;
+
+    float stepTime = 1.0f / stepRate;
+    auto start = std::chrono::steady_clock::now();
+    float nextReport = 5.0f;
+
+    // Realtime until stopped
+    for (int step = 0;; step++)
+    {
+        // Client yachts as reported, sent on before the step moves them, autopilot sails the rest
+        float time = step * stepTime;
+        server.receive(fleet, time);
+        server.broadcast(fleet, time);
+        Physics::stepWorld(world, time, stepTime, controlled, keys, view);
+
+        if (time >= nextReport)
+        {
+            std::cout << "t " << (int)time << " s, " << server.clientCount() << " clients, " << (int)server.bytesPerClient << " B/s per client" << std::endl;
+            nextReport += 5.0f;
+        }
+
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>((step + 1) * stepTime)));
+    }
+}
+
+void Sim::writeCSV(const std::string &path, const std::vector<SimScenario> &scenarios, const std::vector<SimResult> &results)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    // Header, one column per swept parameter
+    file << "scenario,windAngle,windStrength";
+    if (!scenarios.empty())
+    {
+        for (const auto &parameter : scenarios[0].parameters)
+        {
+            file << "," << parameter.first;
+        }
+    }
+    file << ",yacht,distance,finalX,finalY,heading,averageVelocity,maxVelocity\n";
+
+    for (const SimResult &result : results)
+    {
+        const SimScenario &scenario = scenarios[result.scenario];
+
+        file << scenario.id << "," << scenario.windAngle << "," << scenario.windStrength;
+        for (const auto &parameter : scenario.parameters)
+        {
+            file << "," << parameter.second;
+        }
+        file << "," << result.yacht << "," << result.distance << "," << result.finalX << "," << result.finalY << ","
+             << result.heading << "," << result.averageVelocity << "," << result.maxVelocity << "\n";
+    }
+}
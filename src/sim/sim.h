@@ -0,0 +1,97 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "heightfield/heightfield.h"
+
+// Yacht of a scene, simulated without its model
+struct SimYacht
+{
+    std::string name;
+    std::string path;
+    bool controlled = false;
+
+    // Scene placement and bind pose bounds, for collisions
+    glm::mat4 placement = glm::mat4(1.0f);
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// Keys held from time on, same order and meaning as StepInput::keys
+struct SimInput
+{
+    float time = 0.0f;
+    bool keys[5] = {false, false, false, false, false};
+};
+
+// One combination of swept values
+struct SimScenario
+{
+    int id = 0;
+    float windAngle = 0.0f;
+    float windStrength = 0.0f;
+    std::vector<std::pair<std::string, float>> parameters;
+};
+
+// Outcome for one yacht in one scenario
+struct SimResult
+{
+    int scenario;
+    std::string yacht;
+    float distance;
+    float finalX, finalY;
+    float heading;
+    float averageVelocity;
+    float maxVelocity;
+};
+
+// Headless fast forward runs of scenes, for tuning yacht handling
+class Sim
+{
+public:
+    // Run settings
+    static float duration;
+    static float speed;
+    static float stepRate;
+    static bool usePolars;
+    static float gusts;
+    static bool useAutopilot;
+
+    // Telemetry file per scenario, none when empty
+    static std::string telemetryPath;
+
+    // Course of loaded scene, for yachts on autopilot
+    static std::vector<glm::vec2> waypoints;
+
+    // Terrain of loaded scene, flat without one
+    static Heightfield terrain;
+
+    // Load yachts, waypoints and terrain of a scene, and a key script
+    static std::vector<SimYacht> loadScene(const std::string &sceneName);
+    static std::vector<SimInput> loadScript(const std::string &path);
+
+    // Every combination of sweep values
+    static std::vector<SimScenario> sweep(const std::vector<float> &windAngles, const std::vector<float> &windStrengths,
+                                          const std::vector<std::pair<std::string, std::vector<float>>> &parameters);
+
+    // Run scenarios spread over threads, results in scenario order
+    static std::vector<SimResult> runAll(const std::vector<SimScenario> &scenarios, const std::vector<SimYacht> &yachts,
+                                         const std::vector<SimInput> &script, int threads);
+    static std::vector<SimResult> run(const SimScenario &scenario, const std::vector<SimYacht> &yachts, const std::vector<SimInput> &script);
+
+    // Multiplayer server for a scene in realtime, autopilot sails yachts no client has, runs until stopped
+    static void serve(const std::string &sceneName, const std::vector<SimYacht> &yachts, uint16_t port);
+
+    static void writeCSV(const std::string &path, const std::vector<SimScenario> &scenarios, const std::vector<SimResult> &results);
+
+    // Check parameter name can be swept
+    static bool isParameter(const std::string &name);
+};
+
+#endif
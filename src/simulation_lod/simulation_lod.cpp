@@ -0,0 +1,114 @@
+#include "simulation_lod/simulation_lod.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "fleet/fleet.h"
+#include "snapshot/snapshot.h"
+
+int SimulationLod::add(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4 &placement)
+{
+    // Placement itself is kept by fleet, its scale goes into bounds
+    glm::vec3 scale = glm::vec3(glm::length(glm::vec3(placement[0])), glm::length(glm::vec3(placement[1])), glm::length(glm::vec3(placement[2])));
+
+    glm::vec3 center = 0.5f * (boundsMin + boundsMax) * scale;
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    radius.push_back(0.5f * glm::length((boundsMax - boundsMin) * scale));
+
+    tiers.push_back(nearTier);
+    visible.push_back(true);
+    return centerX.size() - 1;
+}
+
+void SimulationLod::clear()
+{
+    for (std::vector<float> *array : {&centerX, &centerY, &centerZ, &radius})
+    {
+        array->clear();
+    }
+    tiers.clear();
+    visible.clear();
+    tierCounts = {0, 0, 0};
+}
+
+void SimulationLod::setView(glm::vec3 position, const std::array<glm::vec4, 6> &frustumPlanes)
+{
+    std::lock_guard<std::mutex> lock(viewMutex);
+    latestView.position = position;
+    latestView.planes = frustumPlanes;
+    latestView.valid = true;
+}
+
+SimulationView SimulationLod::takeView()
+{
+    std::lock_guard<std::mutex> lock(viewMutex);
+    return latestView;
+}
+
+void SimulationLod::save(Snapshot &snapshot) const
+{
+    snapshot.write(tiers);
+}
+
+bool SimulationLod::restore(Snapshot &snapshot)
+{
+    return snapshot.read(tiers);
+}
+
+void SimulationLod::plan(Fleet &fleet, int controlled, const SimulationView &view)
+{
+    if (!view.valid)
+    {
+        return;
+    }
+
+    int count = std::min((int)centerX.size(), fleet.size());
+    tierCounts = {0, 0, 0};
+
+    for (int i = 0; i < count; i++)
+    {
+        // Bounds centre in world, right of hull is (heading.y, -heading.x)
+        float c = fleet.originCos[i], s = fleet.originSin[i];
+        float hx = fleet.headingX[i], hy = fleet.headingY[i];
+        float localX = fleet.positionX[i] + hy * centerX[i] + hx * centerY[i];
+        float localY = fleet.positionY[i] - hx * centerX[i] + hy * centerY[i];
+        glm::vec3 center = glm::vec3(fleet.originX[i] + c * localX - s * localY,
+                                     fleet.originY[i] + s * localX + c * localY,
+                                     fleet.originZ[i] + fleet.groundHeight[i] + centerZ[i]);
+
+        // Tier by distance, leaving current tier only some way past its edge
+        float distance = glm::length(center - view.position);
+        int tier = distance < midDistance ? nearTier : (distance < farDistance ? midTier : farTier);
+        if (tier > tiers[i] && distance < (tiers[i] == nearTier ? midDistance : farDistance) * (1.0f + hysteresis))
+        {
+            tier = tiers[i];
+        }
+
+        // Bounding sphere outside any frustum plane is off screen, one tier lower
+        visible[i] = true;
+        for (const glm::vec4 &plane : view.planes)
+        {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius[i] * glm::length(glm::vec3(plane)))
+            {
+                visible[i] = false;
+                break;
+            }
+        }
+        if (!visible[i])
+        {
+            tier = std::min(tier + 1, (int)farTier);
+        }
+
+        if (i == controlled)
+        {
+            tier = nearTier;
+        }
+
+        // New interval counts from last full step, so changing tier never jumps
+        tiers[i] = tier;
+        tierCounts[tier]++;
+        fleet.stepInterval[i] = (float)intervals[tier];
+    }
+}
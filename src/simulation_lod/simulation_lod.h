@@ -0,0 +1,73 @@
+#ifndef SIMULATION_LOD_H
+#define SIMULATION_LOD_H
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+class Fleet;
+class Snapshot;
+
+// How closely a yacht is simulated
+enum SimulationTier
+{
+    nearTier,
+    midTier,
+    farTier
+};
+
+// Camera tiers are picked for, as of some rendered frame
+struct SimulationView
+{
+    bool valid = false;
+    glm::vec3 position = glm::vec3(0.0f);
+    std::array<glm::vec4, 6> planes = {};
+};
+
+// Picks a simulation tier per fleet yacht from camera distance and visibility. Near yachts take a
+// full step every tick, mid and far ones every few ticks and move on in a straight turn in between
+class SimulationLod
+{
+public:
+    // Add yacht from model bounds and scene placement, returns its index, same order as fleet
+    int add(glm::vec3 boundsMin, glm::vec3 boundsMax, const glm::mat4 &placement);
+    void clear();
+
+    // Camera of last rendered frame, written by main thread, and taken by simulation at start of a step
+    void setView(glm::vec3 position, const std::array<glm::vec4, 6> &frustumPlanes);
+    SimulationView takeView();
+
+    // Tier and step interval of every yacht for view, controlled yacht is always near. Keeps tiers without a view
+    void plan(Fleet &fleet, int controlled, const SimulationView &view);
+
+    // Tiers to snapshot, and back, hysteresis depends on them
+    void save(Snapshot &snapshot) const;
+    bool restore(Snapshot &snapshot);
+
+    // Distances where tiers start, and how far past its edge a yacht goes before leaving its tier
+    float midDistance = 80.0f;
+    float farDistance = 300.0f;
+    float hysteresis = 0.1f;
+
+    // Ticks between full steps per tier
+    std::array<int, 3> intervals = {1, 4, 16};
+
+    // Tier per yacht, and yachts per tier, of last plan
+    std::vector<int> tiers;
+
+    // Yacht was in view at last plan, yachts start visible
+    std::vector<bool> visible;
+    std::array<int, 3> tierCounts = {0, 0, 0};
+
+private:
+    // Centre and radius of bounds in model space after scale
+    std::vector<float> centerX, centerY, centerZ, radius;
+
+    // Copy of camera, guarded as main thread writes it while simulation takes it
+    std::mutex viewMutex;
+    SimulationView latestView;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "skeleton/skeleton.h"
+
+#include <algorithm>
+
+#include "mesh/mesh.h"
+
+bool Skeleton::build(const std::map<std::string, Bone *> &bones, std::vector<int> &remap)
+{
+    // Palette is as long as the largest index, bones are numbered as the tree is walked
+    int count = 0;
+    for (const auto &[name, bone] : bones)
+    {
+        if (bone)
+        {
+            count = std::max(count, bone->index + 1);
+        }
+    }
+
+    // Bones at their imported index first
+    std::vector<std::string> importNames(count);
+    std::vector<int> importParents(count, -1);
+    std::vector<glm::mat4> importOffsets(count, glm::mat4(1.0f));
+    for (const auto &[name, bone] : bones)
+    {
+        if (!bone || bone->index < 0)
+        {
+            continue;
+        }
+
+        int index = bone->index;
+        importNames[index] = name;
+        importParents[index] = bone->parent ? bone->parent->index : -1;
+        importOffsets[index] = bone->offsetMatrix;
+    }
+
+    // Depth of each bone in tree, a walk longer than count bones is a cycle
+    std::vector<int> depths(count, 0);
+    for (int i = 0; i < count; i++)
+    {
+        for (int parent = importParents[i]; parent >= 0; parent = importParents[parent])
+        {
+            if (++depths[i] > count)
+            {
+                names.clear();
+                parents.clear();
+                offsets.clear();
+                inverseOffsets.clear();
+                parentOffsets.clear();
+                remap.clear();
+                return false;
+            }
+        }
+    }
+
+    // Parents first, so one pass in order has every parent posed before its children. Stable, so a
+    // skeleton already in order keeps its indices
+    std::vector<int> order(count);
+    for (int i = 0; i < count; i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+                     { return depths[a] < depths[b]; });
+
+    remap.assign(count, -1);
+    for (int i = 0; i < count; i++)
+    {
+        remap[order[i]] = i;
+    }
+
+    names.assign(count, std::string());
+    parents.assign(count, -1);
+    offsets.assign(count, glm::mat4(1.0f));
+    inverseOffsets.assign(count, glm::mat4(1.0f));
+    parentOffsets.assign(count, glm::mat4(1.0f));
+    for (int i = 0; i < count; i++)
+    {
+        int from = order[i];
+        names[i] = importNames[from];
+        parents[i] = importParents[from] >= 0 ? remap[importParents[from]] : -1;
+        offsets[i] = importOffsets[from];
+        inverseOffsets[i] = glm::inverse(importOffsets[from]);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        parentOffsets[i] = parents[i] >= 0 ? inverseOffsets[parents[i]] * offsets[i] : offsets[i];
+    }
+
+    return true;
+}
+
+int Skeleton::find(const std::string &name) const
+{
+    for (int i = 0; i < size(); i++)
+    {
+        if (names[i] == name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void Skeleton::pose(const glm::mat4 *locals, glm::mat4 *globals) const
+{
+    for (int i = 0; i < size(); i++)
+    {
+        globals[i] = parents[i] >= 0 ? globals[parents[i]] * parentOffsets[i] * locals[i] : parentOffsets[i] * locals[i];
+    }
+}
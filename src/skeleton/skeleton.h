@@ -0,0 +1,38 @@
+#ifndef SKELETON_H
+#define SKELETON_H
+
+#include <glm/glm.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct Bone;
+
+// Bones of a model as flat arrays in palette order, parents before children, so a pose is one
+// pass over them. Built once from the bone tree of the import, bones are found by name only then
+class Skeleton
+{
+public:
+    // From imported bones, sorted so parents come before children. Remap takes imported index to
+    // palette index, for bone IDs of vertices. False and empty if bones do not form a tree
+    bool build(const std::map<std::string, Bone *> &bones, std::vector<int> &remap);
+    int size() const { return parents.size(); }
+
+    // Handle of named bone, -1 if there is none. Resolve once at load, not per frame
+    int find(const std::string &name) const;
+
+    // Global transform per bone from local ones, both size() long
+    void pose(const glm::mat4 *locals, glm::mat4 *globals) const;
+
+    // Per bone, palette index is position. Parent is -1 for roots and unused indices
+    std::vector<std::string> names;
+    std::vector<int> parents;
+
+    // Bind pose transform and its inverse, and bind pose relative to parent bind pose
+    std::vector<glm::mat4> offsets;
+    std::vector<glm::mat4> inverseOffsets;
+    std::vector<glm::mat4> parentOffsets;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "skinning/skinning.h"
+
+#include "scene/scene.h"
+#include "camera/camera.h"
+
+bool Skinning::reuse = true;
+int Skinning::skinnedModels = 0;
+unsigned int Skinning::clothBuffer = 0, Skinning::clothTexture = 0;
+const Scene *Skinning::clothScene = nullptr;
+unsigned int Skinning::clothVersion = 0;
+
+void Skinning::setup(ModelData &model)
+{
+    for (Mesh &mesh : model.model->meshes)
+    {
+        SkinnedMesh skinned;
+        glGenVertexArrays(1, &skinned.VAO);
+        glGenBuffers(1, &skinned.VBO);
+        glBindVertexArray(skinned.VAO);
+
+        // Skinned positions and normals, interleaved as transform feedback writes them
+        glBindBuffer(GL_ARRAY_BUFFER, skinned.VBO);
+        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * 6 * sizeof(float), nullptr, GL_DYNAMIC_COPY);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *)(3 * sizeof(float)));
+
+        // Texture coords and indices are those of the mesh
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *)offsetof(Vertex, TexCoords));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+
+        glBindVertexArray(0);
+        model.skinnedMeshes.push_back(skinned);
+    }
+}
+
+void Skinning::release(ModelData &model)
+{
+    for (SkinnedMesh &skinned : model.skinnedMeshes)
+    {
+        glDeleteVertexArrays(1, &skinned.VAO);
+        glDeleteBuffers(1, &skinned.VBO);
+    }
+    model.skinnedMeshes.clear();
+    model.skinned = false;
+}
+
+void Skinning::uploadCloth(Scene &scene)
+{
+    if (clothBuffer == 0)
+    {
+        glGenBuffers(1, &clothBuffer);
+        glGenTextures(1, &clothTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, clothTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, clothBuffer);
+    }
+
+    // Whole scene at once, only when some cloth moved
+    if (clothScene != &scene || clothVersion != scene.clothVersion)
+    {
+        glBindBuffer(GL_TEXTURE_BUFFER, clothBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, scene.cloth.size() * sizeof(glm::vec3), scene.cloth.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        clothScene = &scene;
+        clothVersion = scene.clothVersion;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + clothUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, clothTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void Skinning::bindCloth(Shader *shader, const ModelData &model)
+{
+    shader->setInt("u_cloth", clothUnit);
+    shader->setInt("clothStart", model.clothInstance >= 0 ? model.clothInstance * SailCloth::particles : -1);
+}
+
+bool Skinning::skins(const ModelData &model)
+{
+    return model.animated && (model.shader == "default" || model.shader == "toon");
+}
+
+void Skinning::skin(Scene &scene, float waterHeight)
+{
+    skinnedModels = 0;
+    Shader *shader = nullptr;
+
+    // Cloth offsets for pre-pass
+    uploadCloth(scene);
+
+    for (ModelData &model : scene.structModels)
+    {
+        model.skinned = false;
+        if (!skins(model) || model.bonePalette.empty())
+        {
+            continue;
+        }
+
+        // Only models in view, reflection camera sees what main camera sees mirrored in water plane
+        glm::vec3 boxMin, boxMax;
+        model.getWorldBounds(boxMin, boxMax);
+        glm::vec3 mirrorMin(boxMin.x, boxMin.y, 2 * waterHeight - boxMax.z);
+        glm::vec3 mirrorMax(boxMax.x, boxMax.y, 2 * waterHeight - boxMin.z);
+        bool mirrorInView = Camera::boxInFrustum(mirrorMin, mirrorMax);
+        if (!mirrorInView && !Camera::boxInFrustum(boxMin, boxMax))
+        {
+            continue;
+        }
+
+        // Hidden from main camera last frame and not seen in reflection, buffers catch up with palette once it shows again
+        if (model.occluded && !mirrorInView)
+        {
+            continue;
+        }
+
+        skinModel(model, shader);
+    }
+
+    if (shader)
+    {
+        endSkinning();
+    }
+}
+
+bool Skinning::skinLate(Scene &scene, ModelData &model)
+{
+    if (model.bonePalette.empty())
+    {
+        return false;
+    }
+
+    // Only models the main camera sees, the rest stay out of this frame
+    glm::vec3 boxMin, boxMax;
+    model.getWorldBounds(boxMin, boxMax);
+    if (!Camera::boxInFrustum(boxMin, boxMax))
+    {
+        return false;
+    }
+
+    Shader *shader = nullptr;
+    uploadCloth(scene);
+    skinModel(model, shader);
+    if (shader)
+    {
+        endSkinning();
+    }
+    return true;
+}
+
+void Skinning::skinModel(ModelData &model, Shader *&shader)
+{
+    // Buffers still hold this palette, parked yachts are not skinned again
+    if (reuse && !model.skinnedMeshes.empty() && model.skinnedVersion == model.paletteVersion)
+    {
+        model.skinned = true;
+        skinnedModels++;
+        return;
+    }
+
+    if (model.skinnedMeshes.empty())
+    {
+        setup(model);
+    }
+
+    if (!shader)
+    {
+        shader = Shader::loadFeedback("skin", {"skinnedPosition", "skinnedNormal"});
+        glEnable(GL_RASTERIZER_DISCARD);
+    }
+    shader->setInt("paletteEncoding", model.paletteEncoding);
+    shader->setVec4Array("u_bonePalette", model.bonePalette);
+    bindCloth(shader, model);
+
+    // Every vertex once, as points straight into skinned buffer
+    for (int i = 0; i < model.model->meshes.size(); i++)
+    {
+        Mesh &mesh = model.model->meshes[i];
+        glBindVertexArray(mesh.VAO);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, model.skinnedMeshes[i].VBO);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, mesh.vertices.size());
+        glEndTransformFeedback();
+    }
+
+    model.skinned = true;
+    model.skinnedVersion = model.paletteVersion;
+    skinnedModels++;
+}
+
+void Skinning::endSkinning()
+{
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+}
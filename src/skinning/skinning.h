@@ -0,0 +1,58 @@
+#ifndef SKINNING_H
+#define SKINNING_H
+
+#include <vector>
+
+class Scene;
+class Shader;
+struct ModelData;
+
+// Skinned copy of one mesh of a model instance, position and normal per vertex in model space
+struct SkinnedMesh
+{
+    unsigned int VAO = 0;
+    unsigned int VBO = 0;
+};
+
+// Pre-pass that skins animated models once per frame with transform feedback, skin.vs is the only shader
+// that applies bone palettes and sail cloth. Reflection, refraction and main pass draw the skinned buffers
+class Skinning
+{
+public:
+    // Keep skinned buffers of models whose palette did not change, off skins every model every frame
+    static bool reuse;
+    static int skinnedModels;
+
+    // Animated model is drawn from skinned buffers only, its shader takes vertices as they are
+    static bool skins(const ModelData &model);
+
+    // Skin models the camera or its reflection in the water sees and that were not occluded last frame,
+    // marks them skinned for this frame. Those left out are not drawn
+    static void skin(Scene &scene, float waterHeight);
+
+    // Skin model the main pass finds visible after pre-pass left it out, false if it is outside of view
+    static bool skinLate(Scene &scene, ModelData &model);
+
+    // Free skinned buffers of model
+    static void release(ModelData &model);
+
+private:
+    static void setup(ModelData &model);
+
+    // Skin one model, loads feedback shader into shader on first use. endSkinning restores state after
+    static void skinModel(ModelData &model, Shader *&shader);
+    static void endSkinning();
+
+    // Sail cloth offsets of whole scene in one buffer texture on clothUnit, filled when they changed.
+    // Pre-pass reads slice of each model
+    static const int clothUnit = 15;
+    static void uploadCloth(Scene &scene);
+    static void bindCloth(Shader *shader, const ModelData &model);
+
+    // Cloth buffer and its texture, and scene and version it holds
+    static unsigned int clothBuffer, clothTexture;
+    static const Scene *clothScene;
+    static unsigned int clothVersion;
+};
+
+#endif
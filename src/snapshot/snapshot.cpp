@@ -0,0 +1,123 @@
+#include "snapshot/snapshot.h"
+
+#include <algorithm>
+
+namespace
+{
+    template <typename T>
+    void put(std::vector<uint8_t> &out, T value)
+    {
+        const uint8_t *bytes = (const uint8_t *)&value;
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    bool take(const std::vector<uint8_t> &in, size_t &position, T &value)
+    {
+        if (position + sizeof(T) > in.size())
+        {
+            return false;
+        }
+        std::memcpy(&value, &in[position], sizeof(T));
+        position += sizeof(T);
+        return true;
+    }
+}
+
+void Snapshot::begin()
+{
+    data.clear();
+    readPosition = 0;
+    data.insert(data.end(), magic, magic + sizeof(magic));
+    write(version);
+}
+
+bool Snapshot::open()
+{
+    readPosition = 0;
+
+    char blobMagic[4];
+    uint32_t blobVersion;
+    return read(blobMagic) && std::memcmp(blobMagic, magic, sizeof(magic)) == 0 && read(blobVersion) && blobVersion == version;
+}
+
+void Snapshot::delta(const Snapshot &previous, const Snapshot &current, std::vector<uint8_t> &out)
+{
+    // Previous of another size shares nothing, all of current goes in
+    uint32_t size = current.data.size();
+    uint32_t base = previous.data.size() == size ? size : 0;
+    out.clear();
+    put(out, size);
+    put(out, base);
+
+    // Words of 4 bytes, last one may be short
+    uint32_t words = (size + 3) / 4;
+    auto same = [&](uint32_t word)
+    {
+        uint32_t start = word * 4, length = std::min(size - start, 4u);
+        return base != 0 && std::memcmp(previous.data.data() + start, current.data.data() + start, length) == 0;
+    };
+
+    // Runs of unchanged words, then changed words and their bytes
+    uint32_t word = 0;
+    while (word < words)
+    {
+        uint32_t sameStart = word;
+        while (word < words && same(word))
+        {
+            word++;
+        }
+        uint32_t changedStart = word;
+        while (word < words && !same(word))
+        {
+            word++;
+        }
+
+        put(out, changedStart - sameStart);
+        put(out, word - changedStart);
+        uint32_t start = std::min(changedStart * 4, size), end = std::min(word * 4, size);
+        out.insert(out.end(), current.data.begin() + start, current.data.begin() + end);
+    }
+}
+
+bool Snapshot::applyDelta(const Snapshot &previous, const std::vector<uint8_t> &delta, Snapshot &out)
+{
+    size_t position = 0;
+    uint32_t size, base;
+    if (!take(delta, position, size) || !take(delta, position, base) || (base != 0 && previous.data.size() != base))
+    {
+        return false;
+    }
+
+    out.data.resize(size);
+    out.readPosition = 0;
+
+    uint32_t word = 0, words = (size + 3) / 4;
+    while (word < words)
+    {
+        uint32_t sameWords, changedWords;
+        if (!take(delta, position, sameWords) || !take(delta, position, changedWords) || word + sameWords + changedWords > words ||
+            (sameWords > 0 && base == 0))
+        {
+            return false;
+        }
+
+        // Unchanged bytes from previous
+        uint32_t start = word * 4, end = std::min((word + sameWords) * 4, size);
+        std::memcpy(out.data.data() + start, previous.data.data() + start, end - start);
+        word += sameWords;
+
+        // Changed bytes from delta
+        start = std::min(word * 4, size);
+        end = std::min((word + changedWords) * 4, size);
+        if (position + (end - start) > delta.size())
+        {
+            return false;
+        }
+        std::memcpy(out.data.data() + start, delta.data() + position, end - start);
+        position += end - start;
+        word += changedWords;
+    }
+
+    return true;
+}
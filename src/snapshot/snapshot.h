@@ -0,0 +1,77 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Flat binary copy of simulation state, without pointers, so it can be kept, compared and sent as is.
+// Values follow in the order they are written, so blobs of one scene have the same layout and size
+// and differ only where state changed
+class Snapshot
+{
+public:
+    // Format
+    static constexpr char magic[4] = {'M', 'R', 'S', 'S'};
+    static constexpr uint32_t version = 1;
+
+    // Blob, header then values
+    std::vector<uint8_t> data;
+
+    // Empty blob with header, keeps memory for the next capture
+    void begin();
+
+    // Read from start, false if header is not this format
+    bool open();
+
+    // Values and arrays of plain values, arrays carry their length
+    template <typename T>
+    void write(const T &value)
+    {
+        const uint8_t *bytes = (const uint8_t *)&value;
+        data.insert(data.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void write(const std::vector<T> &values)
+    {
+        write((uint32_t)values.size());
+        const uint8_t *bytes = (const uint8_t *)values.data();
+        data.insert(data.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+    // False past end, or for an array of another length than the one read into
+    template <typename T>
+    bool read(T &value)
+    {
+        if (readPosition + sizeof(T) > data.size())
+        {
+            return false;
+        }
+        std::memcpy(&value, &data[readPosition], sizeof(T));
+        readPosition += sizeof(T);
+        return true;
+    }
+
+    template <typename T>
+    bool read(std::vector<T> &values)
+    {
+        uint32_t size;
+        if (!read(size) || size != values.size() || readPosition + size * sizeof(T) > data.size())
+        {
+            return false;
+        }
+        std::memcpy(values.data(), &data[readPosition], size * sizeof(T));
+        readPosition += size * sizeof(T);
+        return true;
+    }
+
+    // Runs of changed words of current against previous, and current made back from previous and those runs
+    static void delta(const Snapshot &previous, const Snapshot &current, std::vector<uint8_t> &out);
+    static bool applyDelta(const Snapshot &previous, const std::vector<uint8_t> &delta, Snapshot &out);
+
+private:
+    size_t readPosition = 0;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#include "sync_client/sync_client.h"
+
+#include <algorithm>
+
+#include "fleet/fleet.h"
+
+bool SyncClient::connect(const std::string &host, uint16_t port)
+{
+    if (!UdpAddress::parse(host, port, server) || !socket.open(0))
+    {
+        return false;
+    }
+
+    start = std::chrono::steady_clock::now();
+    slot = -1;
+    waiting = false;
+    return true;
+}
+
+void SyncClient::disconnect()
+{
+    // Server frees yacht now rather than after its timeout
+    if (connected() && joined())
+    {
+        uint8_t leave = leavePacket;
+        socket.send(server, &leave, 1);
+    }
+    socket.close();
+    slot = -1;
+}
+
+double SyncClient::now() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SyncClient::join(const std::string &sceneName, int yachts)
+{
+    // Yacht of last scene is given back
+    if (connected() && joined())
+    {
+        uint8_t leave = leavePacket;
+        socket.send(server, &leave, 1);
+    }
+
+    scene = sceneName;
+    yachtCount = yachts;
+    slot = -1;
+    waiting = true;
+    nextJoin = 0.0;
+    nextSend = 0.0;
+
+    history.assign(historySize, Received());
+    newest = YachtSync::noBaseline;
+    hasClock = false;
+    lost = 0;
+}
+
+void SyncClient::readSnapshot(const uint8_t *data, size_t size, size_t position, double time)
+{
+    uint16_t sequence, baseline, count;
+    float serverTime;
+    uint32_t echo;
+    if (!YachtSync::take(data, size, position, sequence) || !YachtSync::take(data, size, position, baseline) ||
+        !YachtSync::take(data, size, position, serverTime) || !YachtSync::take(data, size, position, echo) ||
+        !YachtSync::take(data, size, position, count) || count != yachtCount)
+    {
+        return;
+    }
+
+    // Late packets are of no use once a newer one is in
+    if (newest != YachtSync::noBaseline && (int16_t)(sequence - newest) <= 0)
+    {
+        return;
+    }
+
+    // Baseline has to be one still kept, otherwise wait for the server to send a full one
+    static const std::vector<SyncState> none;
+    const Received &base = history[baseline % historySize];
+    if (baseline != YachtSync::noBaseline && base.sequence != baseline)
+    {
+        lost++;
+        return;
+    }
+
+    Received &received = history[sequence % historySize];
+    received.states.resize(count);
+    if (!YachtSync::readDelta(baseline == YachtSync::noBaseline ? none : base.states, data, size, position, received.states))
+    {
+        received.sequence = YachtSync::noBaseline;
+        return;
+    }
+    received.sequence = sequence;
+    received.time = serverTime;
+
+    if (newest != YachtSync::noBaseline)
+    {
+        lost += (uint16_t)(sequence - newest) - 1;
+    }
+    newest = sequence;
+
+    // Round trip from report clock the server sends back, server clock ahead of this one without the one way delay
+    float sample = time * 1000.0 - echo;
+    roundTrip = roundTrip == 0.0f ? sample : roundTrip + (sample - roundTrip) * 0.1f;
+
+    double offset = serverTime - time;
+    clockOffset = hasClock ? clockOffset + (offset - clockOffset) * 0.05 : offset;
+    hasClock = true;
+}
+
+void SyncClient::update(Fleet &fleet)
+{
+    if (!connected())
+    {
+        return;
+    }
+    double time = now();
+
+    UdpAddress from;
+    while (socket.receive(from, buffer) > 0)
+    {
+        if (!(from == server))
+        {
+            continue;
+        }
+
+        const uint8_t *data = buffer.data();
+        size_t size = buffer.size(), position = 0;
+        uint8_t type;
+        YachtSync::take(data, size, position, type);
+
+        // Yacht to sail, or -1 when server has none for this scene
+        int16_t given;
+        uint16_t count;
+        float rate;
+        if (type == acceptPacket && waiting && YachtSync::take(data, size, position, given) && YachtSync::take(data, size, position, count) &&
+            YachtSync::take(data, size, position, rate))
+        {
+            slot = count == yachtCount ? given : -1;
+            waiting = false;
+        }
+        else if (type == snapshotPacket && joined())
+        {
+            readSnapshot(data, size, position, time);
+        }
+    }
+
+    // Ask again until server answers
+    if (waiting && time >= nextJoin)
+    {
+        packet.clear();
+        YachtSync::put(packet, (uint8_t)joinPacket);
+        YachtSync::put(packet, (uint8_t)std::min(scene.size(), (size_t)255));
+        packet.insert(packet.end(), scene.begin(), scene.begin() + std::min(scene.size(), (size_t)255));
+        socket.send(server, packet.data(), packet.size());
+        nextJoin = time + 0.5;
+    }
+
+    if (!joined() || slot >= fleet.size())
+    {
+        return;
+    }
+
+    // Own yacht to server, with newest snapshot as baseline for the next one
+    if (time >= nextSend)
+    {
+        nextSend = std::max(nextSend + 1.0 / sendRate, time);
+
+        packet.clear();
+        YachtSync::put(packet, (uint8_t)statePacket);
+        YachtSync::put(packet, (int16_t)slot);
+        YachtSync::put(packet, newest);
+        YachtSync::put(packet, (uint32_t)(time * 1000.0));
+        YachtSync::putState(packet, YachtSync::capture(fleet, slot));
+        socket.send(server, packet.data(), packet.size());
+    }
+
+    // Snapshots either side of render time, held at the nearest one when there is none on a side
+    if (hasClock)
+    {
+        float renderTime = time + clockOffset - interpolationDelay;
+        const Received *before = nullptr, *after = nullptr;
+        for (const Received &received : history)
+        {
+            if (received.sequence == YachtSync::noBaseline || received.states.size() != (size_t)fleet.size())
+            {
+                continue;
+            }
+            if (received.time <= renderTime && (!before || received.time > before->time))
+            {
+                before = &received;
+            }
+            if (received.time > renderTime && (!after || received.time < after->time))
+            {
+                after = &received;
+            }
+        }
+
+        const Received *a = before ? before : after;
+        const Received *b = after ? after : before;
+        float t = before && after ? (renderTime - a->time) / (b->time - a->time) : 0.0f;
+        if (a)
+        {
+            for (int i = 0; i < fleet.size(); i++)
+            {
+                if (i != slot)
+                {
+                    YachtSync::apply(a->states[i], b->states[i], t, fleet, i);
+                }
+            }
+        }
+    }
+
+    // Traffic per second
+    if (time - statsTime >= 1.0)
+    {
+        bytesIn = (socket.bytesReceived - statsIn) / (time - statsTime);
+        bytesOut = (socket.bytesSent - statsOut) / (time - statsTime);
+        statsIn = socket.bytesReceived;
+        statsOut = socket.bytesSent;
+        statsTime = time;
+    }
+}
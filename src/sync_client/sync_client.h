@@ -0,0 +1,81 @@
+#ifndef SYNC_CLIENT_H
+#define SYNC_CLIENT_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "udp_socket/udp_socket.h"
+#include "yacht_sync/yacht_sync.h"
+
+class Fleet;
+
+// Sails the yacht the server hands out locally and reports it, other yachts are set from server
+// snapshots, interpolated interpolationDelay seconds behind the newest so there are two to blend between
+class SyncClient
+{
+public:
+    // Open socket towards server, false if host is not an address or no socket could be opened
+    bool connect(const std::string &host, uint16_t port);
+    void disconnect();
+    bool connected() const { return socket.isOpen(); }
+
+    // Ask for a yacht of a newly loaded scene, resent until the server answers
+    void join(const std::string &sceneName, int yachts);
+
+    // Server gave this client a yacht of current scene
+    bool joined() const { return slot >= 0; }
+
+    // Simulation thread, after fleet step. Read snapshots, report own yacht at sendRate, and put remote yachts in fleet
+    void update(Fleet &fleet);
+
+    // Yacht of this client, -1 while it has none
+    int slot = -1;
+
+    // Seconds remote yachts are shown behind server, and reports per second
+    float interpolationDelay = 0.1f;
+    float sendRate = 20.0f;
+
+    // Stats, smoothed round trip in ms including the wait for the next snapshot, bytes per second each way,
+    // snapshots lost or without baseline
+    float roundTrip = 0.0f;
+    float bytesIn = 0.0f, bytesOut = 0.0f;
+    int lost = 0;
+
+private:
+    UdpSocket socket;
+    UdpAddress server;
+    std::chrono::steady_clock::time_point start;
+
+    std::string scene;
+    int yachtCount = 0;
+    bool waiting = false;
+    double nextJoin = 0.0, nextSend = 0.0;
+
+    // Last snapshots received, by sequence modulo size, with server time
+    static const int historySize = 32;
+    struct Received
+    {
+        uint16_t sequence = YachtSync::noBaseline;
+        float time = 0.0f;
+        std::vector<SyncState> states;
+    };
+    std::vector<Received> history;
+    uint16_t newest = YachtSync::noBaseline;
+
+    // Server clock less local one, smoothed
+    double clockOffset = 0.0;
+    bool hasClock = false;
+
+    // Traffic at last stats update
+    uint64_t statsIn = 0, statsOut = 0;
+    double statsTime = 0.0;
+
+    std::vector<uint8_t> buffer, packet;
+
+    double now() const;
+    void readSnapshot(const uint8_t *data, size_t size, size_t position, double time);
+};
+
+#endif
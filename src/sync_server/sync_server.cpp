@@ -0,0 +1,192 @@
+#include "sync_server/sync_server.h"
+
+#include <algorithm>
+
+#include "fleet/fleet.h"
+
+bool SyncServer::start(uint16_t port, const std::string &sceneName, int yachts)
+{
+    scene = sceneName;
+    yachtCount = yachts;
+    clients.clear();
+    history.assign(historySize, std::vector<SyncState>());
+    historySequence.assign(historySize, YachtSync::noBaseline);
+    sequence = 0;
+    nextSend = 0.0f;
+    reportBytes = 0;
+    reportTime = 0.0f;
+    return socket.open(port);
+}
+
+void SyncServer::stop()
+{
+    socket.close();
+    clients.clear();
+}
+
+bool SyncServer::owned(int index) const
+{
+    for (const Client &client : clients)
+    {
+        if (client.slot == index)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+SyncServer::Client *SyncServer::find(const UdpAddress &address)
+{
+    for (Client &client : clients)
+    {
+        if (client.address == address)
+        {
+            return &client;
+        }
+    }
+    return nullptr;
+}
+
+void SyncServer::accept(const UdpAddress &address, int slot)
+{
+    packet.clear();
+    YachtSync::put(packet, (uint8_t)acceptPacket);
+    YachtSync::put(packet, (int16_t)slot);
+    YachtSync::put(packet, (uint16_t)yachtCount);
+    YachtSync::put(packet, sendRate);
+    socket.send(address, packet.data(), packet.size());
+}
+
+void SyncServer::receive(Fleet &fleet, float time)
+{
+    UdpAddress from;
+    while (socket.receive(from, buffer) > 0)
+    {
+        const uint8_t *data = buffer.data();
+        size_t size = buffer.size(), position = 0;
+        uint8_t type;
+        YachtSync::take(data, size, position, type);
+        Client *client = find(from);
+
+        if (type == joinPacket)
+        {
+            // Join again after a lost accept gets the same yacht
+            if (client)
+            {
+                accept(from, client->slot);
+                continue;
+            }
+
+            // Client of another scene gets no yacht
+            uint8_t length = 0;
+            YachtSync::take(data, size, position, length);
+            if (position + length > size || std::string((const char *)data + position, length) != scene)
+            {
+                accept(from, -1);
+                continue;
+            }
+
+            // First yacht no client sails, none when all are taken
+            int slot = 0;
+            while (slot < yachtCount && owned(slot))
+            {
+                slot++;
+            }
+            if (slot == yachtCount)
+            {
+                accept(from, -1);
+                continue;
+            }
+
+            clients.push_back({from, slot, time});
+            accept(from, slot);
+        }
+        else if (type == statePacket && client)
+        {
+            int16_t slot;
+            uint16_t ack;
+            uint32_t echo;
+            SyncState state;
+            if (YachtSync::take(data, size, position, slot) && slot == client->slot && YachtSync::take(data, size, position, ack) &&
+                YachtSync::take(data, size, position, echo) && YachtSync::takeState(data, size, position, state))
+            {
+                client->ack = ack;
+                client->echo = echo;
+                client->state = state;
+                client->hasState = true;
+                client->lastHeard = time;
+            }
+        }
+        else if (type == leavePacket && client)
+        {
+            client->lastHeard = -timeout;
+        }
+    }
+
+    // Drop silent clients, their yachts go back to autopilot
+    clients.erase(std::remove_if(clients.begin(), clients.end(), [&](const Client &client)
+                                 { return time - client.lastHeard > timeout; }),
+                  clients.end());
+
+    // Reported yachts as client last saw them
+    for (const Client &client : clients)
+    {
+        if (client.hasState && client.slot < fleet.size())
+        {
+            YachtSync::apply(client.state, client.state, 0.0f, fleet, client.slot);
+        }
+    }
+}
+
+void SyncServer::broadcast(const Fleet &fleet, float time)
+{
+    if (time < nextSend)
+    {
+        return;
+    }
+    nextSend = std::max(nextSend + 1.0f / sendRate, time);
+
+    // Quantize fleet into history, sequence skips the one that means no baseline
+    sequence = sequence + 1 == YachtSync::noBaseline ? 0 : sequence + 1;
+    int index = sequence % historySize;
+    std::vector<SyncState> &states = history[index];
+    states.resize(fleet.size());
+    for (int i = 0; i < fleet.size(); i++)
+    {
+        states[i] = YachtSync::capture(fleet, i);
+    }
+    historySequence[index] = sequence;
+
+    static const std::vector<SyncState> none;
+    for (const Client &client : clients)
+    {
+        // Delta against newest snapshot client has, when it is still in history
+        uint16_t baseline = client.ack;
+        int baselineIndex = baseline % historySize;
+        bool hasBaseline = baseline != YachtSync::noBaseline && historySequence[baselineIndex] == baseline &&
+                           (uint16_t)(sequence - baseline) < historySize;
+        if (!hasBaseline)
+        {
+            baseline = YachtSync::noBaseline;
+        }
+
+        packet.clear();
+        YachtSync::put(packet, (uint8_t)snapshotPacket);
+        YachtSync::put(packet, sequence);
+        YachtSync::put(packet, baseline);
+        YachtSync::put(packet, time);
+        YachtSync::put(packet, client.echo);
+        YachtSync::put(packet, (uint16_t)states.size());
+        YachtSync::writeDelta(hasBaseline ? history[baselineIndex] : none, states, packet);
+        socket.send(client.address, packet.data(), packet.size());
+    }
+
+    // Bandwidth per client over last second
+    if (time - reportTime >= 1.0f)
+    {
+        bytesPerClient = clients.empty() ? 0.0f : (socket.bytesSent - reportBytes) / (time - reportTime) / clients.size();
+        reportBytes = socket.bytesSent;
+        reportTime = time;
+    }
+}
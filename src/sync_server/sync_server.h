@@ -0,0 +1,78 @@
+#ifndef SYNC_SERVER_H
+#define SYNC_SERVER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "udp_socket/udp_socket.h"
+#include "yacht_sync/yacht_sync.h"
+
+class Fleet;
+
+// Hands each client a yacht of the scene, takes the state clients report for it, and sends all yachts
+// to every client at a fixed rate, as a delta against the last snapshot that client acknowledged
+class SyncServer
+{
+public:
+    // Listen on port for clients of scene with this many yachts, false if port is taken
+    bool start(uint16_t port, const std::string &sceneName, int yachts);
+    void stop();
+
+    // Read client packets, reported yachts are put into fleet. Clients silent for timeout seconds are dropped
+    void receive(Fleet &fleet, float time);
+
+    // Snapshot of fleet to every client, when one is due at sendRate
+    void broadcast(const Fleet &fleet, float time);
+
+    // Yacht is sailed by a client
+    bool owned(int index) const;
+
+    // Snapshots per second, and seconds without packets before a client is dropped
+    float sendRate = 20.0f;
+    float timeout = 5.0f;
+
+    // Stats, clients connected and bytes per second sent to each of them since last broadcast report
+    int clientCount() const { return clients.size(); }
+    float bytesPerClient = 0.0f;
+
+    UdpSocket socket;
+
+private:
+    struct Client
+    {
+        UdpAddress address;
+        int slot;
+        float lastHeard;
+
+        // Newest snapshot client has, and client clock of its last report to send back for round trip
+        uint16_t ack = YachtSync::noBaseline;
+        uint32_t echo = 0;
+
+        // Last reported state, held between reports
+        SyncState state;
+        bool hasState = false;
+    };
+    std::vector<Client> clients;
+
+    std::string scene;
+    int yachtCount = 0;
+
+    // Last historySize snapshots sent, by sequence modulo size
+    static const int historySize = 32;
+    std::vector<std::vector<SyncState>> history;
+    std::vector<uint16_t> historySequence;
+    uint16_t sequence = 0;
+    float nextSend = 0.0f;
+
+    // Bytes sent at last report, for rate
+    uint64_t reportBytes = 0;
+    float reportTime = 0.0f;
+
+    std::vector<uint8_t> buffer, packet;
+
+    Client *find(const UdpAddress &address);
+    void accept(const UdpAddress &address, int slot);
+};
+
+#endif
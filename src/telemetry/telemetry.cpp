@@ -0,0 +1,269 @@
+#include "telemetry/telemetry.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "fleet/fleet.h"
+
+Telemetry::~Telemetry()
+{
+    stop();
+}
+
+bool Telemetry::start(const std::string &path)
+{
+    stop();
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    file = (intptr_t)handle;
+#else
+    file = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (file == invalidFile)
+    {
+        return false;
+    }
+
+    // First chunk up front, so recording never starts without somewhere to write
+    if (!mapChunk(0))
+    {
+        stop();
+        return false;
+    }
+
+    ring.resize(ringSize);
+    head = 0;
+    tail = 0;
+    dropped = 0;
+
+    running = true;
+    writer = std::thread(&Telemetry::write, this);
+    return true;
+}
+
+void Telemetry::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        running = false;
+    }
+    writerCondition.notify_all();
+
+    // Writer flushes what is left before it ends
+    if (writer.joinable())
+    {
+        writer.join();
+    }
+
+    unmapChunk();
+    if (file != invalidFile)
+    {
+#ifdef _WIN32
+        CloseHandle((HANDLE)file);
+#else
+        close(file);
+#endif
+        file = invalidFile;
+    }
+}
+
+void Telemetry::record(const Fleet &fleet, float time)
+{
+    if (!recording())
+    {
+        return;
+    }
+
+    // Room up to slots the writer has not taken yet
+    uint64_t position = head.load(std::memory_order_relaxed);
+    uint64_t space = ringSize - (position - tail.load(std::memory_order_acquire));
+    int count = (int)std::min<uint64_t>(fleet.size(), space);
+
+    for (int i = 0; i < count; i++)
+    {
+        TelemetryRecord &record = ring[(position + i) & (ringSize - 1)];
+        record.time = time;
+        record.yacht = i;
+        record.positionX = fleet.positionX[i];
+        record.positionY = fleet.positionY[i];
+        record.heading = glm::degrees(std::atan2(fleet.headingX[i], fleet.headingY[i]));
+        record.velocity = fleet.velocity[i];
+        record.acceleration = fleet.acceleration[i];
+        record.windSpeed = std::sqrt(fleet.windX[i] * fleet.windX[i] + fleet.windY[i] * fleet.windY[i]);
+        record.apparentWindSpeed = fleet.apparentWindSpeed[i];
+        record.angleToWind = glm::degrees(fleet.angleToWind[i]);
+        record.angleToApparentWind = glm::degrees(fleet.angleToApparentWind[i]);
+        record.sailAngle = glm::degrees(fleet.sailAngle[i]);
+        record.steeringAngle = fleet.steeringAngle[i];
+        record.sailControl = fleet.sailControl[i];
+        record.liftCoefficient = fleet.liftCoefficient[i];
+        record.dragCoefficient = fleet.dragCoefficient[i];
+    }
+
+    // Whole tick becomes visible to writer at once
+    head.store(position + count, std::memory_order_release);
+    if (count < fleet.size())
+    {
+        dropped += fleet.size() - count;
+    }
+}
+
+void Telemetry::write()
+{
+    while (true)
+    {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            writerCondition.wait_for(lock, std::chrono::duration<float>(flushInterval), [this]()
+                                     { return !running; });
+            stopping = !running;
+        }
+
+        flush();
+
+        if (stopping)
+        {
+            return;
+        }
+    }
+}
+
+void Telemetry::flush()
+{
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t position = tail.load(std::memory_order_relaxed);
+
+    while (position < end)
+    {
+        // Next chunk when this one is full, records are lost if file can not grow
+        if (chunkFill == chunkRecords)
+        {
+            unmapChunk();
+            if (!mapChunk(chunkIndex + 1))
+            {
+                dropped += end - position;
+                position = end;
+                break;
+            }
+        }
+
+        // Run of records contiguous in ring and fitting in chunk
+        size_t slot = position & (ringSize - 1);
+        size_t count = std::min({(size_t)(end - position), (size_t)(chunkRecords - chunkFill), ringSize - slot});
+
+        TelemetryChunk *header = (TelemetryChunk *)chunk;
+        TelemetryRecord *records = (TelemetryRecord *)(chunk + sizeof(TelemetryChunk));
+        std::memcpy(records + chunkFill, &ring[slot], count * sizeof(TelemetryRecord));
+        chunkFill += count;
+        header->recordCount = chunkFill;
+
+        position += count;
+    }
+
+    // Slots free for simulation thread again
+    tail.store(position, std::memory_order_release);
+}
+
+bool Telemetry::mapChunk(size_t index)
+{
+    uint64_t offset = (uint64_t)index * chunkSize;
+    uint64_t end = offset + chunkSize;
+
+#ifdef _WIN32
+    // Mapping past end of file grows it, view keeps mapping alive after handle is closed
+    HANDLE mapping = CreateFileMappingA((HANDLE)file, nullptr, PAGE_READWRITE, (DWORD)(end >> 32), (DWORD)end, nullptr);
+    if (!mapping)
+    {
+        return false;
+    }
+    void *view = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, chunkSize);
+    CloseHandle(mapping);
+    if (!view)
+    {
+        return false;
+    }
+#else
+    if (ftruncate(file, (off_t)end) != 0)
+    {
+        return false;
+    }
+    void *view = mmap(nullptr, chunkSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, (off_t)offset);
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+#endif
+
+    chunk = (unsigned char *)view;
+    chunkIndex = index;
+    chunkFill = 0;
+
+    // Header of empty chunk
+    TelemetryChunk header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.recordSize = sizeof(TelemetryRecord);
+    header.recordCount = 0;
+    std::memcpy(chunk, &header, sizeof(header));
+
+    return true;
+}
+
+void Telemetry::unmapChunk()
+{
+    if (!chunk)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(chunk);
+#else
+    munmap(chunk, chunkSize);
+#endif
+    chunk = nullptr;
+}
+
+bool Telemetry::readChunk(std::istream &stream, std::vector<TelemetryRecord> &records)
+{
+    std::streampos start = stream.tellg();
+
+    TelemetryChunk header;
+    if (!stream.read((char *)&header, sizeof(header)))
+    {
+        return false;
+    }
+
+    // Only this version of the format
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version ||
+        header.recordSize != sizeof(TelemetryRecord) || header.recordCount > (uint32_t)chunkRecords)
+    {
+        return false;
+    }
+
+    records.resize(header.recordCount);
+    if (!stream.read((char *)records.data(), header.recordCount * sizeof(TelemetryRecord)))
+    {
+        return false;
+    }
+
+    // Unused rest of chunk
+    stream.seekg(start + (std::streamoff)chunkSize);
+    return true;
+}
@@ -0,0 +1,101 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Fleet;
+
+// State of one yacht at one tick, fixed layout as written to file. Position relative to scene
+// placement, heading in degrees clockwise from +Y, other angles in degrees as in debug overlay
+struct TelemetryRecord
+{
+    float time;
+    uint32_t yacht;
+    float positionX, positionY, heading;
+    float velocity, acceleration;
+    float windSpeed, apparentWindSpeed;
+    float angleToWind, angleToApparentWind;
+    float sailAngle, steeringAngle, sailControl;
+    float liftCoefficient, dragCoefficient;
+};
+static_assert(sizeof(TelemetryRecord) == 64, "Telemetry record layout changed, bump Telemetry::version");
+
+// Start of every chunk in file, records follow up to end of chunk
+struct TelemetryChunk
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t recordCount;
+    uint8_t padding[48];
+};
+static_assert(sizeof(TelemetryChunk) == sizeof(TelemetryRecord), "Chunk header keeps records aligned");
+
+// Records fleet state every tick for offline analysis. Simulation thread appends to a lock free
+// ring, a writer thread flushes it into a memory mapped file that grows in fixed size chunks
+class Telemetry
+{
+public:
+    // Default empty constructor
+    Telemetry() {};
+    ~Telemetry();
+
+    // File format
+    static constexpr char magic[4] = {'M', 'R', 'T', 'C'};
+    static const uint32_t version = 1;
+
+    // Chunk size in bytes, multiple of mapping granularity, and records per chunk
+    static const size_t chunkSize = 1 << 20;
+    static const int chunkRecords = (chunkSize - sizeof(TelemetryChunk)) / sizeof(TelemetryRecord);
+
+    // Records in ring, power of 2, and time writer sleeps between flushes
+    static const int ringSize = 1 << 16;
+    float flushInterval = 0.05f;
+
+    // Open file and start writer, stops any running recording first. False if file could not be made
+    bool start(const std::string &path);
+    void stop();
+    bool recording() const { return file != invalidFile; }
+
+    // Append state of every yacht, from simulation thread only. Records that do not fit are dropped
+    void record(const Fleet &fleet, float time);
+
+    // Records dropped since start because the writer fell behind
+    std::atomic<uint64_t> dropped = 0;
+
+    // Read next chunk of a telemetry file, false at end of file or on a chunk of another format
+    static bool readChunk(std::istream &stream, std::vector<TelemetryRecord> &records);
+
+private:
+    // Ring positions only count up, slot is position modulo ring size. Head written by simulation thread, tail by writer
+    std::vector<TelemetryRecord> ring;
+    alignas(64) std::atomic<uint64_t> head = 0;
+    alignas(64) std::atomic<uint64_t> tail = 0;
+
+    // File handle or descriptor, and view of chunk being filled
+    static const intptr_t invalidFile = -1;
+    intptr_t file = invalidFile;
+    unsigned char *chunk = nullptr;
+    size_t chunkIndex = 0;
+    int chunkFill = 0;
+
+    // Writer flushing ring
+    std::thread writer;
+    std::mutex writerMutex;
+    std::condition_variable writerCondition;
+    bool running = false;
+
+    void write();
+    void flush();
+    bool mapChunk(size_t index);
+    void unmapChunk();
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "telemetry/telemetry.h"
+
+static void printUsage()
+{
+    std::cout << "Usage: marama_telemetry <file> [options]\n"
+              << "  --yacht <n>              Only records of fleet yacht n (default all)\n"
+              << "  --from <s>               Only records from time on (default 0)\n"
+              << "  --to <s>                 Only records up to time (default end)\n"
+              << "  --out <file>             Result CSV (default telemetry.csv)\n";
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printUsage();
+        return -1;
+    }
+
+    std::string inPath = argv[1];
+    std::string outPath = "telemetry.csv";
+    int yacht = -1;
+    float from = 0.0f;
+    float to = -1.0f;
+
+    try
+    {
+        // Read options
+        for (int i = 2; i < argc; i++)
+        {
+            std::string option = argv[i];
+            if (i + 1 >= argc)
+            {
+                throw std::runtime_error("Missing value for " + option);
+            }
+            std::string value = argv[++i];
+
+            if (option == "--yacht")
+                yacht = std::stoi(value);
+            else if (option == "--from")
+                from = std::stof(value);
+            else if (option == "--to")
+                to = std::stof(value);
+            else if (option == "--out")
+                outPath = value;
+            else
+            {
+                throw std::runtime_error("Unknown option: " + option);
+            }
+        }
+
+        std::ifstream in(inPath, std::ios::binary);
+        if (!in.is_open())
+        {
+            throw std::runtime_error("Could not open file: " + inPath);
+        }
+        std::ofstream out(outPath);
+        if (!out.is_open())
+        {
+            throw std::runtime_error("Could not open file: " + outPath);
+        }
+
+        out << "time,yacht,positionX,positionY,heading,velocity,acceleration,windSpeed,apparentWindSpeed,"
+            << "angleToWind,angleToApparentWind,sailAngle,steeringAngle,sailControl,liftCoefficient,dragCoefficient\n";
+
+        // One chunk in memory at a time, files of long sessions do not fit otherwise
+        std::vector<TelemetryRecord> records;
+        size_t chunks = 0, written = 0;
+        while (Telemetry::readChunk(in, records))
+        {
+            chunks++;
+            for (const TelemetryRecord &r : records)
+            {
+                if ((yacht >= 0 && r.yacht != (uint32_t)yacht) || r.time < from || (to >= 0.0f && r.time > to))
+                {
+                    continue;
+                }
+
+                out << r.time << "," << r.yacht << "," << r.positionX << "," << r.positionY << "," << r.heading << ","
+                    << r.velocity << "," << r.acceleration << "," << r.windSpeed << "," << r.apparentWindSpeed << ","
+                    << r.angleToWind << "," << r.angleToApparentWind << "," << r.sailAngle << "," << r.steeringAngle << ","
+                    << r.sailControl << "," << r.liftCoefficient << "," << r.dragCoefficient << "\n";
+                written++;
+            }
+        }
+
+        if (chunks == 0)
+        {
+            throw std::runtime_error("Not a telemetry file: " + inPath);
+        }
+        std::cout << "Wrote " << written << " records from " << chunks << " chunks to " << outPath << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "udp_socket/udp_socket.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+bool UdpAddress::parse(const std::string &host, uint16_t port, UdpAddress &address)
+{
+    in_addr parsed;
+    if (inet_pton(AF_INET, host == "localhost" ? "127.0.0.1" : host.c_str(), &parsed) != 1)
+    {
+        return false;
+    }
+
+    address.ip = ntohl(parsed.s_addr);
+    address.port = port;
+    return true;
+}
+
+UdpSocket::~UdpSocket()
+{
+    close();
+}
+
+bool UdpSocket::open(uint16_t port)
+{
+    close();
+
+#ifdef _WIN32
+    // Winsock needs starting once per process
+    static bool started = false;
+    if (!started)
+    {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+        {
+            return false;
+        }
+        started = true;
+    }
+
+    SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s == INVALID_SOCKET)
+    {
+        return false;
+    }
+    handle = (intptr_t)s;
+
+    u_long nonBlocking = 1;
+    ioctlsocket(s, FIONBIO, &nonBlocking);
+#else
+    int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (s < 0)
+    {
+        return false;
+    }
+    handle = s;
+
+    fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+#endif
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(s, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close();
+        return false;
+    }
+
+    bytesSent = bytesReceived = 0;
+    packetsSent = packetsReceived = 0;
+    return true;
+}
+
+void UdpSocket::close()
+{
+    if (handle == invalidHandle)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    closesocket((SOCKET)handle);
+#else
+    ::close((int)handle);
+#endif
+    handle = invalidHandle;
+}
+
+bool UdpSocket::send(const UdpAddress &to, const uint8_t *data, int size)
+{
+    if (handle == invalidHandle)
+    {
+        return false;
+    }
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(to.ip);
+    address.sin_port = htons(to.port);
+
+#ifdef _WIN32
+    int sent = sendto((SOCKET)handle, (const char *)data, size, 0, (sockaddr *)&address, sizeof(address));
+#else
+    int sent = sendto((int)handle, data, size, 0, (sockaddr *)&address, sizeof(address));
+#endif
+    if (sent != size)
+    {
+        return false;
+    }
+
+    bytesSent += size;
+    packetsSent++;
+    return true;
+}
+
+int UdpSocket::receive(UdpAddress &from, std::vector<uint8_t> &buffer)
+{
+    if (handle == invalidHandle)
+    {
+        return 0;
+    }
+
+    buffer.resize(maxPacketSize);
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+
+#ifdef _WIN32
+    int received = recvfrom((SOCKET)handle, (char *)buffer.data(), maxPacketSize, 0, (sockaddr *)&address, &length);
+#else
+    int received = recvfrom((int)handle, buffer.data(), maxPacketSize, 0, (sockaddr *)&address, &length);
+#endif
+
+    // Nothing waiting, or an error that leaves nothing to read
+    if (received <= 0)
+    {
+        buffer.clear();
+        return 0;
+    }
+
+    buffer.resize(received);
+    from.ip = ntohl(address.sin_addr.s_addr);
+    from.port = ntohs(address.sin_port);
+    bytesReceived += received;
+    packetsReceived++;
+    return received;
+}
@@ -0,0 +1,51 @@
+#ifndef UDP_SOCKET_H
+#define UDP_SOCKET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// IPv4 address and port, host byte order
+struct UdpAddress
+{
+    uint32_t ip = 0;
+    uint16_t port = 0;
+
+    bool operator==(const UdpAddress &other) const { return ip == other.ip && port == other.port; }
+
+    // From dotted quad or localhost, false if it is neither
+    static bool parse(const std::string &host, uint16_t port, UdpAddress &address);
+};
+
+// Non blocking UDP socket, counts traffic for bandwidth stats
+class UdpSocket
+{
+public:
+    // Default empty constructor
+    UdpSocket() {};
+    ~UdpSocket();
+
+    // Bind to port on all interfaces, 0 picks a free one. False if port is taken
+    bool open(uint16_t port);
+    void close();
+    bool isOpen() const { return handle != invalidHandle; }
+
+    // Send one datagram, false if it could not go out
+    bool send(const UdpAddress &to, const uint8_t *data, int size);
+
+    // Next waiting datagram into buffer, size 0 when there is none
+    int receive(UdpAddress &from, std::vector<uint8_t> &buffer);
+
+    // Traffic since open, payload bytes only
+    uint64_t bytesSent = 0, bytesReceived = 0;
+    uint64_t packetsSent = 0, packetsReceived = 0;
+
+    // Largest datagram received, whole UDP payload
+    static const int maxPacketSize = 65507;
+
+private:
+    static const intptr_t invalidHandle = -1;
+    intptr_t handle = invalidHandle;
+};
+
+#endif
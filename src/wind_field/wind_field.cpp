@@ -0,0 +1,270 @@
+#include "wind_field/wind_field.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "lanes/lanes.h"
+
+using namespace lanes;
+
+namespace
+{
+    // Hash of lattice point to [-1, 1]
+    float latticeValue(int x, int y, int z, unsigned int seed)
+    {
+        unsigned int h = seed * 0x9E3779B9u;
+        h ^= (unsigned int)x * 0x85EBCA6Bu;
+        h = (h ^ (h >> 13)) * 0xC2B2AE35u;
+        h ^= (unsigned int)y * 0x27D4EB2Fu;
+        h = (h ^ (h >> 15)) * 0x165667B1u;
+        h ^= (unsigned int)z * 0x9E3779B1u;
+        h = (h ^ (h >> 16)) * 0x85EBCA6Bu;
+        h ^= h >> 13;
+        return (h & 0xFFFFFF) / (float)0x7FFFFF - 1.0f;
+    }
+
+    // Smooth value noise, periodic in x and y with period lattice cells
+    float valueNoise(glm::vec3 p, int period, unsigned int seed)
+    {
+        glm::vec3 cell = glm::floor(p);
+        glm::vec3 f = p - cell;
+        glm::vec3 w = f * f * (3.0f - 2.0f * f);
+
+        int x0 = ((int)cell.x % period + period) % period, x1 = (x0 + 1) % period;
+        int y0 = ((int)cell.y % period + period) % period, y1 = (y0 + 1) % period;
+        int z0 = (int)cell.z, z1 = z0 + 1;
+
+        float lower = glm::mix(glm::mix(latticeValue(x0, y0, z0, seed), latticeValue(x1, y0, z0, seed), w.x),
+                              glm::mix(latticeValue(x0, y1, z0, seed), latticeValue(x1, y1, z0, seed), w.x), w.y);
+        float upper = glm::mix(glm::mix(latticeValue(x0, y0, z1, seed), latticeValue(x1, y0, z1, seed), w.x),
+                             glm::mix(latticeValue(x0, y1, z1, seed), latticeValue(x1, y1, z1, seed), w.x), w.y);
+        return glm::mix(lower, upper, w.z);
+    }
+
+    // Bilinear sample of one keyframe component, indices of the four corners
+    template <typename L>
+    L bilinear(const float *grid, L i00, L i10, L i01, L i11, L fu, L fv)
+    {
+        L c0 = gather(grid, i00) + (gather(grid, i10) - gather(grid, i00)) * fu;
+        L c1 = gather(grid, i01) + (gather(grid, i11) - gather(grid, i01)) * fu;
+        return c0 + (c1 - c0) * fv;
+    }
+
+    // Wind at L::width positions starting at i, blended between two keyframes
+    template <typename L>
+    void sampleLanes(const float *positionX, const float *positionY, float *windX, float *windY, int i,
+                     const float *ax, const float *ay, const float *bx, const float *by, float inverseSpacing, float blend)
+    {
+        const float n = (float)WindField::gridSize;
+
+        // Grid coordinates, cells wrap around
+        L u = L::load(&positionX[i]) * inverseSpacing;
+        L v = L::load(&positionY[i]) * inverseSpacing;
+        L u0 = floor(u), v0 = floor(v);
+        L fu = u - u0, fv = v - v0;
+        u0 = u0 - floor(u0 * (1.0f / n)) * n;
+        v0 = v0 - floor(v0 * (1.0f / n)) * n;
+        L u1 = select(u0 >= n - 1.0f, L(0.0f), u0 + 1.0f);
+        L v1 = select(v0 >= n - 1.0f, L(0.0f), v0 + 1.0f);
+
+        // Indices of surrounding cells
+        L i00 = v0 * n + u0, i10 = v0 * n + u1;
+        L i01 = v1 * n + u0, i11 = v1 * n + u1;
+
+        // Blend keyframes
+        L x = bilinear(ax, i00, i10, i01, i11, fu, fv);
+        L y = bilinear(ay, i00, i10, i01, i11, fu, fv);
+        x = x + (bilinear(bx, i00, i10, i01, i11, fu, fv) - x) * blend;
+        y = y + (bilinear(by, i00, i10, i01, i11, fu, fv) - y) * blend;
+
+        x.store(&windX[i]);
+        y.store(&windY[i]);
+    }
+}
+
+WindField::~WindField()
+{
+    stop();
+}
+
+void WindField::start(glm::vec3 direction, float strength, bool threaded)
+{
+    stop();
+
+    meanWind = glm::normalize(glm::vec2(direction)) * strength;
+    for (Keyframe &key : keys)
+    {
+        key.x.assign(gridSize * gridSize, 0.0f);
+        key.y.assign(gridSize * gridSize, 0.0f);
+    }
+
+    currentKey = 0;
+    madeKeys = 0;
+    blend = 0.0f;
+    this->threaded = threaded;
+
+    if (threaded)
+    {
+        running = true;
+        worker = std::thread(&WindField::work, this);
+    }
+}
+
+void WindField::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(keyMutex);
+        running = false;
+    }
+    keyCondition.notify_all();
+
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+void WindField::work()
+{
+    while (true)
+    {
+        // Wait for a free keyframe
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(keyMutex);
+            keyCondition.wait(lock, [this]()
+                              { return !running || madeKeys < currentKey + 3; });
+            if (!running)
+            {
+                return;
+            }
+            index = madeKeys;
+        }
+
+        // Slot is not read until madeKeys passes it
+        makeKeyframe(index);
+
+        {
+            std::lock_guard<std::mutex> lock(keyMutex);
+            madeKeys = index + 1;
+        }
+        keyCondition.notify_all();
+    }
+}
+
+void WindField::seek(float time)
+{
+    int key = std::max((int)(time / keyInterval), 0);
+
+    // Keyframes from current on are already there or made next by update
+    {
+        std::lock_guard<std::mutex> lock(keyMutex);
+        if (key >= currentKey && key <= madeKeys)
+        {
+            return;
+        }
+    }
+
+    // Keyframes are only made in order, start over at key
+    bool restart = threaded && running;
+    stop();
+    currentKey = key;
+    madeKeys = key;
+
+    if (restart)
+    {
+        running = true;
+        worker = std::thread(&WindField::work, this);
+    }
+}
+
+void WindField::update(float time)
+{
+    int key = std::max((int)(time / keyInterval), 0);
+
+    if (threaded)
+    {
+        // Free keyframes before current, then wait for current and next
+        std::unique_lock<std::mutex> lock(keyMutex);
+        currentKey = key;
+        keyCondition.notify_all();
+        keyCondition.wait(lock, [this]()
+                          { return madeKeys >= currentKey + 2; });
+    }
+    else
+    {
+        // Make missing keyframes right here
+        currentKey = key;
+        madeKeys = std::max(madeKeys, key);
+        while (madeKeys < currentKey + 2)
+        {
+            makeKeyframe(madeKeys++);
+        }
+    }
+
+    blend = std::clamp(time / keyInterval - key, 0.0f, 1.0f);
+}
+
+void WindField::makeKeyframe(int index)
+{
+    Keyframe &key = keys[index % 3];
+    float time = index * keyInterval;
+
+    // Gust lattice fits whole times in grid, so field wraps without seams
+    int period = std::max((int)std::round(gridSize * spacing / gustSize), 1);
+    float latticeScale = period / (gridSize * spacing);
+
+    // Gust pattern drifts with mean wind and slowly changes shape
+    glm::vec2 drift = meanWind * time;
+    float shape = time * gustChange;
+
+    for (int y = 0; y < gridSize; y++)
+    {
+        for (int x = 0; x < gridSize; x++)
+        {
+            glm::vec2 position = (glm::vec2(x, y) * spacing - drift) * latticeScale;
+
+            // Two octaves, one for strength and one for direction
+            float strength = 0.7f * valueNoise(glm::vec3(position, shape), period, seed) +
+                             0.3f * valueNoise(glm::vec3(position * 2.0f, shape * 2.0f), period * 2, seed);
+            float shift = 0.7f * valueNoise(glm::vec3(position, shape), period, seed + 1) +
+                          0.3f * valueNoise(glm::vec3(position * 2.0f, shape * 2.0f), period * 2, seed + 1);
+
+            float angle = gustShift * shift;
+            float c = std::cos(angle), s = std::sin(angle);
+            glm::vec2 wind = glm::vec2(c * meanWind.x - s * meanWind.y, s * meanWind.x + c * meanWind.y) * (1.0f + gustStrength * strength);
+
+            key.x[y * gridSize + x] = wind.x;
+            key.y[y * gridSize + x] = wind.y;
+        }
+    }
+}
+
+void WindField::sample(const float *positionX, const float *positionY, float *windX, float *windY, int count) const
+{
+    const Keyframe &a = keys[currentKey % 3];
+    const Keyframe &b = keys[(currentKey + 1) % 3];
+    float inverseSpacing = 1.0f / spacing;
+    int i = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // Full SIMD batches
+    for (; i + SimdLanes::width <= count; i += SimdLanes::width)
+    {
+        sampleLanes<SimdLanes>(positionX, positionY, windX, windY, i, a.x.data(), a.y.data(), b.x.data(), b.y.data(), inverseSpacing, blend);
+    }
+#endif
+
+    // Remaining positions
+    for (; i < count; i++)
+    {
+        sampleLanes<ScalarLanes>(positionX, positionY, windX, windY, i, a.x.data(), a.y.data(), b.x.data(), b.y.data(), inverseSpacing, blend);
+    }
+}
+
+glm::vec2 WindField::sample(glm::vec2 position) const
+{
+    glm::vec2 wind;
+    sample(&position.x, &position.y, &wind.x, &wind.y, 1);
+    return wind;
+}
@@ -0,0 +1,79 @@
+#ifndef WIND_FIELD_H
+#define WIND_FIELD_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Wind over the course on a periodic grid, mean wind with gusts drifting along with it.
+// Keyframes of the grid are made ahead of time on a worker thread, sampling blends the
+// two around the current time so the field changes smoothly between them
+class WindField
+{
+public:
+    // Default empty constructor
+    WindField() {};
+    ~WindField();
+
+    // Grid size in cells per side, power of 2, and cell size in meters
+    static const int gridSize = 64;
+    float spacing = 16.0f;
+
+    // Gusts, strength and direction change relative to mean, size in meters and rate of change per second
+    float gustStrength = 0.3f;
+    float gustShift = glm::radians(12.0f);
+    float gustSize = 128.0f;
+    float gustChange = 0.05f;
+    unsigned int seed = 1;
+
+    // Time between keyframes in seconds
+    float keyInterval = 1.0f;
+
+    // Restart field for mean wind at time 0, keyframes made on worker thread or inline in update
+    void start(glm::vec3 direction, float strength, bool threaded);
+    void stop();
+
+    // Move field to time, waits for worker if it has not made the next keyframe yet
+    void update(float time);
+
+    // Jump to any time, before or far past current one. Keyframes are made again from there
+    void seek(float time);
+
+    // Wind vector at count positions
+    void sample(const float *positionX, const float *positionY, float *windX, float *windY, int count) const;
+    glm::vec2 sample(glm::vec2 position) const;
+
+private:
+    // Wind components per cell, row major
+    struct Keyframe
+    {
+        std::vector<float> x, y;
+    };
+
+    // Current keyframe, next one, and one being made
+    Keyframe keys[3];
+
+    // Index of current keyframe, and of next keyframe not made yet
+    int currentKey = 0;
+    int madeKeys = 0;
+    float blend = 0.0f;
+
+    glm::vec2 meanWind = glm::vec2(0.0f);
+
+    // Worker making keyframes ahead of current one
+    bool threaded = false;
+    std::thread worker;
+    std::mutex keyMutex;
+    std::condition_variable keyCondition;
+    std::atomic<bool> running = false;
+
+    void work();
+    void makeKeyframe(int index);
+    float gust(glm::vec2 position, float time, int period, float offset) const;
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "yacht_sync/yacht_sync.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+
+#include "fleet/fleet.h"
+
+const float YachtSync::scales[syncFieldCount] = {32.0f, 32.0f, 65536.0f / glm::two_pi<float>(), 32.0f, 16.0f, 512.0f, 512.0f, 512.0f};
+
+namespace
+{
+    // Small differences of either sign in few bytes
+    void putVarint(std::vector<uint8_t> &out, int32_t value)
+    {
+        uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+        while (zigzag >= 0x80)
+        {
+            out.push_back((uint8_t)(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        out.push_back((uint8_t)zigzag);
+    }
+
+    bool takeVarint(const uint8_t *data, size_t size, size_t &position, int32_t &value)
+    {
+        uint32_t zigzag = 0;
+        for (int shift = 0; shift < 35; shift += 7)
+        {
+            if (position >= size)
+            {
+                return false;
+            }
+            uint8_t byte = data[position++];
+            zigzag |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+int32_t YachtSync::difference(int field, int32_t from, int32_t to)
+{
+    // Heading takes the short way round
+    if (field == syncHeading)
+    {
+        return (int16_t)(uint16_t)(to - from);
+    }
+    return to - from;
+}
+
+SyncState YachtSync::capture(const Fleet &fleet, int index)
+{
+    float heading = std::atan2(fleet.headingX[index], fleet.headingY[index]);
+    float values[syncFieldCount] = {fleet.positionX[index], fleet.positionY[index], heading, fleet.velocity[index],
+                                    fleet.steeringAngle[index], fleet.mastAngle[index], fleet.boomAngle[index], fleet.sailAngle[index]};
+
+    SyncState state;
+    for (int field = 0; field < syncFieldCount; field++)
+    {
+        state.values[field] = (int32_t)std::lround(values[field] * scales[field]);
+    }
+    state.values[syncHeading] &= 0xFFFF;
+    return state;
+}
+
+void YachtSync::apply(const SyncState &a, const SyncState &b, float t, Fleet &fleet, int index)
+{
+    float values[syncFieldCount];
+    for (int field = 0; field < syncFieldCount; field++)
+    {
+        values[field] = (a.values[field] + difference(field, a.values[field], b.values[field]) * t) / scales[field];
+    }
+
+    fleet.positionX[index] = values[syncPositionX];
+    fleet.positionY[index] = values[syncPositionY];
+    fleet.headingX[index] = std::sin(values[syncHeading]);
+    fleet.headingY[index] = std::cos(values[syncHeading]);
+    fleet.velocity[index] = values[syncVelocity];
+    fleet.steeringAngle[index] = values[syncSteering];
+    fleet.mastAngle[index] = values[syncMast];
+    fleet.boomAngle[index] = values[syncBoom];
+    fleet.sailAngle[index] = values[syncSail];
+}
+
+void YachtSync::writeDelta(const std::vector<SyncState> &baseline, const std::vector<SyncState> &states, std::vector<uint8_t> &out)
+{
+    static const SyncState zero;
+    bool hasBaseline = baseline.size() == states.size();
+
+    // Bit per yacht, filled in as changes are found
+    size_t changedStart = out.size();
+    out.resize(out.size() + (states.size() + 7) / 8, 0);
+
+    for (size_t i = 0; i < states.size(); i++)
+    {
+        const SyncState &from = hasBaseline ? baseline[i] : zero;
+
+        uint8_t fields = 0;
+        for (int field = 0; field < syncFieldCount; field++)
+        {
+            if (from.values[field] != states[i].values[field])
+            {
+                fields |= 1 << field;
+            }
+        }
+        if (!fields)
+        {
+            continue;
+        }
+
+        out[changedStart + i / 8] |= 1 << (i % 8);
+        out.push_back(fields);
+        for (int field = 0; field < syncFieldCount; field++)
+        {
+            if (fields & (1 << field))
+            {
+                putVarint(out, difference(field, from.values[field], states[i].values[field]));
+            }
+        }
+    }
+}
+
+bool YachtSync::readDelta(const std::vector<SyncState> &baseline, const uint8_t *data, size_t size, size_t &position,
+                          std::vector<SyncState> &states)
+{
+    // Yacht count comes from states, baseline of another size is all zero
+    if (baseline.size() == states.size())
+    {
+        states = baseline;
+    }
+    else
+    {
+        std::fill(states.begin(), states.end(), SyncState());
+    }
+
+    size_t changedStart = position;
+    position += (states.size() + 7) / 8;
+    if (position > size)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < states.size(); i++)
+    {
+        if (!(data[changedStart + i / 8] & (1 << (i % 8))))
+        {
+            continue;
+        }
+
+        uint8_t fields;
+        if (!take(data, size, position, fields))
+        {
+            return false;
+        }
+        for (int field = 0; field < syncFieldCount; field++)
+        {
+            int32_t change;
+            if (!(fields & (1 << field)))
+            {
+                continue;
+            }
+            if (!takeVarint(data, size, position, change))
+            {
+                return false;
+            }
+            states[i].values[field] += change;
+        }
+        states[i].values[syncHeading] &= 0xFFFF;
+    }
+
+    return true;
+}
+
+void YachtSync::putState(std::vector<uint8_t> &out, const SyncState &state)
+{
+    for (int32_t value : state.values)
+    {
+        putVarint(out, value);
+    }
+}
+
+bool YachtSync::takeState(const uint8_t *data, size_t size, size_t &position, SyncState &state)
+{
+    for (int32_t &value : state.values)
+    {
+        if (!takeVarint(data, size, position, value))
+        {
+            return false;
+        }
+    }
+    state.values[syncHeading] &= 0xFFFF;
+    return true;
+}
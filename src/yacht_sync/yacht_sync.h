@@ -0,0 +1,88 @@
+#ifndef YACHT_SYNC_H
+#define YACHT_SYNC_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class Fleet;
+
+// Packet types, first byte of every datagram
+enum SyncPacket
+{
+    joinPacket = 1,
+    acceptPacket,
+    statePacket,
+    snapshotPacket,
+    leavePacket
+};
+
+// Fields of a yacht sent over the network, whole numbers of fixed steps relative to its placement
+enum SyncField
+{
+    syncPositionX,
+    syncPositionY,
+    syncHeading,
+    syncVelocity,
+    syncSteering,
+    syncMast,
+    syncBoom,
+    syncSail,
+    syncFieldCount
+};
+
+struct SyncState
+{
+    int32_t values[syncFieldCount] = {};
+};
+
+// Quantized yacht state and its delta coding against an earlier snapshot both ends have
+class YachtSync
+{
+public:
+    // Sequence for no baseline, delta is against all zero state
+    static const uint16_t noBaseline = 0xFFFF;
+
+    // Step per field, position 1/32 m, heading 1/65536 turn, velocity 1/32 m/s, steering 1/16 degree, sail angles 1/512 rad
+    static const float scales[syncFieldCount];
+
+    // Fleet state to quantized one, and back, optionally between two states by t
+    static SyncState capture(const Fleet &fleet, int index);
+    static void apply(const SyncState &a, const SyncState &b, float t, Fleet &fleet, int index);
+
+    // Fields changed against baseline as zigzag varints. A bit per yacht that changed, then per
+    // changed yacht a bit per changed field and their differences. Empty baseline is all zero
+    static void writeDelta(const std::vector<SyncState> &baseline, const std::vector<SyncState> &states, std::vector<uint8_t> &out);
+    static bool readDelta(const std::vector<SyncState> &baseline, const uint8_t *data, size_t size, size_t &position,
+                          std::vector<SyncState> &states);
+
+    // Plain values to and from packets
+    template <typename T>
+    static void put(std::vector<uint8_t> &out, T value)
+    {
+        const uint8_t *bytes = (const uint8_t *)&value;
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    static bool take(const uint8_t *data, size_t size, size_t &position, T &value)
+    {
+        if (position + sizeof(T) > size)
+        {
+            return false;
+        }
+        const uint8_t *bytes = data + position;
+        std::copy(bytes, bytes + sizeof(T), (uint8_t *)&value);
+        position += sizeof(T);
+        return true;
+    }
+
+    // Whole state as varints, for client reports
+    static void putState(std::vector<uint8_t> &out, const SyncState &state);
+    static bool takeState(const uint8_t *data, size_t size, size_t &position, SyncState &state);
+
+    // Difference of field, heading wraps around
+    static int32_t difference(int field, int32_t from, int32_t to);
+};
+
+#endif